@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+"""Rebuild the decoder benchmark corpus.
+
+A deterministic 3 s source (chords, a bass line, noise hits, a stereo pan) is
+synthesized with the standard library and encoded with ffmpeg from PATH (or
+$FFMPEG). The clips are checked in: rerun only to change the corpus, then
+record new baselines. HE-AAC (SBR) needs ffmpeg with libfdk_aac, the clip is
+skipped otherwise.
+"""
+
+import math
+import os
+import random
+import struct
+import subprocess
+import sys
+import tempfile
+import wave
+
+SECONDS = 3
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+# name, ffmpeg arguments
+CLIPS = [
+    ("mp3_128k_stereo_44k.mp3", ["-ar", "44100", "-ac", "2", "-c:a", "libmp3lame", "-b:a", "128k"]),
+    ("mp3_320k_stereo_48k.mp3", ["-ar", "48000", "-ac", "2", "-c:a", "libmp3lame", "-b:a", "320k"]),
+    ("mp3_vbr_stereo_44k.mp3", ["-ar", "44100", "-ac", "2", "-c:a", "libmp3lame", "-q:a", "4"]),
+    ("mp3_48k_mono_22k.mp3", ["-ar", "22050", "-ac", "1", "-c:a", "libmp3lame", "-b:a", "48k"]),
+    ("aac_lc_128k_stereo_44k.aac", ["-ar", "44100", "-ac", "2", "-c:a", "aac", "-b:a", "128k", "-f", "adts"]),
+    ("aac_lc_64k_mono_22k.aac", ["-ar", "22050", "-ac", "1", "-c:a", "aac", "-b:a", "64k", "-f", "adts"]),
+    ("aac_he_48k_stereo_44k.aac", ["-ar", "44100", "-ac", "2", "-c:a", "libfdk_aac", "-profile:a", "aac_he",
+                                   "-b:a", "48k", "-f", "adts"]),
+    ("flac_16bit_stereo_44k.flac", ["-ar", "44100", "-ac", "2", "-c:a", "flac", "-sample_fmt", "s16"]),
+    ("flac_24bit_stereo_48k.flac", ["-ar", "48000", "-ac", "2", "-c:a", "flac", "-sample_fmt", "s32"]),
+    ("flac_16bit_mono_22k.flac", ["-ar", "22050", "-ac", "1", "-c:a", "flac", "-sample_fmt", "s16"]),
+    ("vorbis_q4_stereo_44k.ogg", ["-ar", "44100", "-ac", "2", "-c:a", "libvorbis", "-q:a", "4"]),
+    ("vorbis_q0_mono_22k.ogg", ["-ar", "22050", "-ac", "1", "-c:a", "libvorbis", "-q:a", "0"]),
+    ("opus_96k_stereo_48k.opus", ["-ar", "48000", "-ac", "2", "-c:a", "libopus", "-b:a", "96k"]),
+    # the Opus decoder is CELT only: lowdelay keeps libopus from switching to SILK at low rates
+    ("opus_32k_mono_48k.opus", ["-ar", "48000", "-ac", "1", "-c:a", "libopus", "-b:a", "32k",
+                                "-application", "lowdelay"]),
+]
+
+
+def synthesize(path, rate=48000):
+    """24 bit stereo source, the same bytes on every run"""
+    rng = random.Random(0xC7D)
+    chords = [(220.0, 277.18, 329.63), (196.0, 246.94, 293.66), (174.61, 220.0, 261.63), (164.81, 207.65, 246.94)]
+    bass = [55.0, 49.0, 43.65, 41.2]
+    frames = []
+    for i in range(SECONDS * rate):
+        t = i / rate
+        bar = int(t * 2) % 4
+        beat = (t * 4) % 1.0
+        env = math.exp(-3.0 * beat)
+        tone = sum(math.sin(2 * math.pi * f * t) + 0.3 * math.sin(4 * math.pi * f * t) for f in chords[bar]) / 4
+        low = 0.5 * math.sin(2 * math.pi * bass[bar] * t)
+        hit = rng.uniform(-1, 1) * math.exp(-40.0 * beat) * 0.6
+        pan = 0.5 + 0.5 * math.sin(2 * math.pi * 0.25 * t)
+        left = 0.45 * (tone * env * (1 - pan) + low + hit)
+        right = 0.45 * (tone * env * pan + low + hit * 0.7)
+        frames.append(struct.pack("<ii", int(left * 8388607) << 8, int(right * 8388607) << 8))
+    with wave.open(path, "wb") as w:
+        w.setnchannels(2)
+        w.setsampwidth(4)
+        w.setframerate(rate)
+        w.writeframes(b"".join(frames))
+
+
+def main():
+    ffmpeg = os.environ.get("FFMPEG", "ffmpeg")
+    lengths = []
+    with tempfile.TemporaryDirectory() as tmp:
+        source = os.path.join(tmp, "source.wav")
+        synthesize(source)
+        for name, args in CLIPS:
+            out = os.path.join(HERE, name)
+            cmd = [ffmpeg, "-v", "error", "-y", "-i", source] + args + ["-map_metadata", "-1", "-fflags", "+bitexact", out]
+            if subprocess.call(cmd) != 0:
+                print("skipped " + name, file=sys.stderr)
+                if os.path.exists(out):
+                    os.remove(out)
+                continue
+            lengths.append((name, SECONDS * int(args[args.index("-ar") + 1])))
+    # known length of every clip at its own rate, the bench flags decodes that are off
+    with open(os.path.join(HERE, "lengths.csv"), "w") as f:
+        f.write("clip,frames\n")
+        for name, frames in sorted(lengths):
+            f.write("%s,%d\n" % (name, frames))
+
+
+if __name__ == "__main__":
+    main()
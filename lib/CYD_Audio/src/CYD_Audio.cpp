@@ -219,7 +219,6 @@ void CYD_Audio::begin(bool internalDAC /* = false */, uint8_t channelEnabled /*
                 m_f_forceMono = true;
             }
 			fillDACbuf(0x80008000);
-			rms.setBias(0x8000); // remove DC bias in rms calculation
         #endif
 
     }
@@ -323,6 +322,9 @@ CYD_Audio::~CYD_Audio() {
 //---------------------------------------------------------------------------------------------------------------------
 void CYD_Audio::setDefaults() {
     stopSong();
+    m_f_loopWindow = m_f_loopArmed; // loop points apply to this connect only
+    m_f_loopArmed = false;
+    m_decodeStats = {};
     initInBuff(); // initialize InputBuffer if not already done
     InBuff.resetBuffer();
     MP3Decoder_FreeBuffers();
@@ -537,7 +539,7 @@ bool CYD_Audio::connecttohost(const char* host, const char* user, const char* pw
         m_streamType = ST_WEBSTREAM;
 		m_fader = 0;						// start with 0 volume
 		m_play_status = FADE_IN;				
-		if(m_f_internalDAC) m_dacBias = 0;	// start with 0 bias and ramp it up
+		if(m_f_internalDAC) m_dacBias = m_blockBias = 0;	// start with 0 bias and ramp it up
     }
     else{
         AUDIO_INFO("Request %s failed!", l_host);
@@ -748,47 +750,169 @@ bool CYD_Audio::connecttoFS(fs::FS &fs, const char* path, int32_t resumeFilePos)
         return false;
     }
 
+    bool ret = startLocalFile();
+    xSemaphoreGiveRecursive(mutex_audio);
+    return ret;
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool CYD_Audio::startLocalFile() {
+    // audiofile is open, detect the codec from the file name and prepare the decoder
+
     setDatamode(AUDIO_LOCALFILE);
     m_file_size = audiofile.size();//TEST loop
 	m_fader = 0;						// start with 0 volume
 	m_play_status = FADE_IN;				
-	if(m_f_internalDAC) m_dacBias = 0;	// start with 0 bias and ramp it up
-    char* afn = NULL;  // audioFileName
+	if(m_f_internalDAC) m_dacBias = m_blockBias = 0;	// start with 0 bias and ramp it up
 
 #ifdef SDFATFS_USED
     audiofile.getName(m_chbuf, m_chbufSize); // #426
-    afn = strdup(m_chbuf);
+    m_codec = codecFromName(m_chbuf);
 #else
-    afn = strdup(audiofile.name());
+    m_codec = codecFromName(audiofile.name());
 #endif
 
+    bool ret = initializeDecoder();
+    if(ret) m_f_running = true;
+    else 
+	{
+		audiofile.close();
+		m_play_status = FADE_OFF;
+	}
+    return ret;
+}
+//---------------------------------------------------------------------------------------------------------------------
+uint8_t CYD_Audio::codecFromName(const char* name) {
+    // codec by file extension, CODEC_NONE if not supported
+    char* afn = strdup(name);  // audioFileName
+    if(!afn) return CODEC_NONE;
+    uint8_t codec = CODEC_NONE;
     uint8_t dotPos = lastIndexOf(afn, ".");
     for(uint8_t i = dotPos + 1; i < strlen(afn); i++){
         afn[i] = toLowerCase(afn[i]);
     }
 
-    if(endsWith(afn, ".mp3"))  m_codec = CODEC_MP3; // m_codec is by default CODEC_NONE
-    if(endsWith(afn, ".m4a"))  m_codec = CODEC_M4A;
-    if(endsWith(afn, ".aac"))  m_codec = CODEC_AAC;
-    if(endsWith(afn, ".wav"))  m_codec = CODEC_WAV;
-    if(endsWith(afn, ".flac")) m_codec = CODEC_FLAC;
-    if(endsWith(afn, ".opus")) m_codec = CODEC_OPUS;
-    if(endsWith(afn, ".ogg"))  m_codec = CODEC_OGG;
-    if(endsWith(afn, ".oga"))  m_codec = CODEC_OGG;
+    if(endsWith(afn, ".mp3"))  codec = CODEC_MP3;
+    if(endsWith(afn, ".m4a"))  codec = CODEC_M4A;
+    if(endsWith(afn, ".aac"))  codec = CODEC_AAC;
+    if(endsWith(afn, ".wav"))  codec = CODEC_WAV;
+    if(endsWith(afn, ".flac")) codec = CODEC_FLAC;
+    if(endsWith(afn, ".opus")) codec = CODEC_OPUS;
+    if(endsWith(afn, ".ogg"))  codec = CODEC_OGG;
+    if(endsWith(afn, ".oga"))  codec = CODEC_OGG;
 
-    if(m_codec == CODEC_NONE) AUDIO_INFO("The %s format is not supported", afn + dotPos);
+    if(codec == CODEC_NONE) AUDIO_INFO("The %s format is not supported", afn + dotPos);
 
-    if(afn) {free(afn); afn = NULL;}
+    free(afn);
+    return codec;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void CYD_Audio::freeDecoder(uint8_t codec) {
+    if(codec == CODEC_MP3)    MP3Decoder_FreeBuffers();
+    if(codec == CODEC_AAC)    AACDecoder_FreeBuffers();
+    if(codec == CODEC_M4A)    AACDecoder_FreeBuffers();
+    if(codec == CODEC_FLAC)   FLACDecoder_FreeBuffers();
+    if(codec == CODEC_OPUS)   OPUSDecoder_FreeBuffers();
+    if(codec == CODEC_VORBIS) VORBISDecoder_FreeBuffers();
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool CYD_Audio::queueSD(const char* path) {
+    return queueFS(SD, path);
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool CYD_Audio::queueFS(fs::FS &fs, const char* path) {
+    // append a local file to the sequence, played after the current file and the queued ones
 
-    bool ret = initializeDecoder();
-    if(ret) m_f_running = true;
-    else 
-	{
-		audiofile.close();
-		m_play_status = FADE_OFF;
-	}
+    xSemaphoreTakeRecursive(mutex_audio, portMAX_DELAY);
+    if(!path || strlen(path) > 254 || (!m_queue.empty() && m_queueFS != &fs)){
+        xSemaphoreGiveRecursive(mutex_audio);
+        return false;
+    }
+    char* item = (char*)malloc(strlen(path) + 2);
+    if(!item){
+        log_e("out of memory");
+        xSemaphoreGiveRecursive(mutex_audio);
+        return false;
+    }
+    item[0] = '/';
+    strcpy(item + (path[0] != '/'), path);
+    m_queueFS = &fs;
+    m_queue.push_back(item);
+    xSemaphoreGiveRecursive(mutex_audio);
+    return true;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void CYD_Audio::clearQueue() {
+    xSemaphoreTakeRecursive(mutex_audio, portMAX_DELAY);
+    vector_clear_and_shrink(m_queue);
+    if(m_nextFile) m_nextFile.close();
     xSemaphoreGiveRecursive(mutex_audio);
-    return ret;
+}
+//---------------------------------------------------------------------------------------------------------------------
+void CYD_Audio::openQueuedFile() {
+    // open the first queued file that exists, the directory lookup is done while the current file still plays
+    while(!m_nextFile && !m_queue.empty()){
+        char* path = m_queue.front();
+        m_queue.erase(m_queue.begin());
+        if(m_queueFS->exists(path)) m_nextFile = m_queueFS->open(path);
+        else {
+            UTF8toASCII(path);
+            if(m_queueFS->exists(path)) m_nextFile = m_queueFS->open(path);
+        }
+        if(!m_nextFile) AUDIO_INFO("Queued file not found: \"%s\"", path);
+        free(path);
+    }
+}
+//---------------------------------------------------------------------------------------------------------------------
+bool CYD_Audio::nextLocalFile() {
+    // end of audiofile: continue with the next queued file. Fader, DAC bias, pipeline and resampler
+    // keep running, so the first samples follow the last ones without a gap. The header and the
+    // decoder init of the next file run from here on, the DMA buffers cover them (test_gapless)
+
+    openQueuedFile();
+    if(!m_nextFile) return false;
+    audiofile.close();
+    audiofile = m_nextFile;
+    m_nextFile = File();
+
+#ifdef SDFATFS_USED
+    audiofile.getName(m_chbuf, m_chbufSize);
+    uint8_t codec = codecFromName(m_chbuf);
+#else
+    uint8_t codec = codecFromName(audiofile.name());
+#endif
+    // same codec: MP3, AAC and FLAC keep their buffers and clear the state. Opus allocates on
+    // every init, it starts over (.ogg names are always freed, m_codec holds the detected codec)
+    if(codec != m_codec || codec == CODEC_OPUS) freeDecoder(m_codec);
+
+    // per file state, as set by setDefaults()
+    InBuff.resetBuffer();
+    m_f_firstCall = true;
+    m_f_playing = false;
+    m_f_unsync = false;
+    m_f_exthdr = false;
+    m_f_m4aID3dataAreRead = false;
+    m_controlCounter = 0;
+    m_audioCurrentTime = 0;
+    m_audioFileDuration = 0;
+    m_audioDataStart = 0;
+    m_audioDataSize = 0;
+    m_avr_bitrate = 0;
+    m_bitRate = 0;
+    m_bytesNotDecoded = 0;
+    m_contentlength = 0;
+    m_curSample = 0;
+    m_validSamples = 0;
+    m_channels = 2;
+    m_ID3Size = 0;
+    m_resumeFilePos = -1;
+    m_file_size = audiofile.size();
+    m_codec = codec;
+
+    if(!initializeDecoder()){
+        audiofile.close();
+        return false;
+    }
+    return true;
 }
 //---------------------------------------------------------------------------------------------------------------------
 bool CYD_Audio::connecttospeech(const char* speech, const char* lang){
@@ -843,7 +967,7 @@ bool CYD_Audio::connecttospeech(const char* speech, const char* lang){
     m_f_tts = true;
 	m_fader = 0;						// start with 0 volume
 	m_play_status = FADE_IN;				
-	if(m_f_internalDAC) m_dacBias = 0;	// start with 0 bias and ramp it up
+	if(m_f_internalDAC) m_dacBias = m_blockBias = 0;	// start with 0 bias and ramp it up
     setDatamode(HTTP_RESPONSE_HEADER);
     xSemaphoreGiveRecursive(mutex_audio);
     return true;
@@ -2112,7 +2236,8 @@ uint32_t CYD_Audio::stopSong() {
             audiofile.close();
             AUDIO_INFO("Closing audio file");
         }
-		rms.reset();
+		m_pipeline.reset();
+		m_resampler.reset();
     }
     if(audiofile){
         // added this before putting 'm_f_localfile = false' in stopSong(); shoulf never occur....
@@ -2122,7 +2247,10 @@ uint32_t CYD_Audio::stopSong() {
     }
 		memset(m_outBuff, 0, 2048 * 2 *sizeof(uint16_t));     //Clear OutputBuffer
 		if(!m_f_internalDAC)	i2s_zero_dma_buffer((i2s_port_t) m_i2s_num);
-		rms.reset();
+		m_pipeline.reset();
+		m_resampler.reset();
+		clearQueue();
+		endLoop();
     return pos;
 }
 //---------------------------------------------------------------------------------------------------------------------
@@ -2231,7 +2359,10 @@ bool CYD_Audio::playChunk() {
 //---------------------------------------------------------------------------------------------------------------------
 void CYD_Audio::loop() {
 
-    if(!m_f_running) return;
+    if(!m_f_running) {
+        playVoicesCYD(); // sound effects while no stream plays
+        return;
+    }
 	
     xSemaphoreTake(mutex_audio, portMAX_DELAY);
 
@@ -2697,6 +2828,8 @@ bool CYD_Audio::STfromEXTINF(char* str){
 //---------------------------------------------------------------------------------------------------------------------
 void CYD_Audio::processLocalFile() {
 
+    if(m_f_loopPlay && m_f_running) {playLoopCYD(); return;} // the file is done, the window repeats from RAM
+
     if(!(audiofile && m_f_running && getDatamode() == AUDIO_LOCALFILE)) return; // guard
 
     static uint32_t ctime = 0;
@@ -2804,6 +2937,11 @@ void CYD_Audio::processLocalFile() {
             }
         }
 
+        if(m_f_loopWindow && m_loopFrames){ // the loop window ends with the file
+            m_f_loopPlay = true;
+            return;
+        }
+
         if(m_f_loop  && f_stream){  //eof
             AUDIO_INFO("loop from: %u to: %u", getFilePos(), m_audioDataStart); // loop
             setFilePos(m_audioDataStart);
@@ -2820,27 +2958,30 @@ void CYD_Audio::processLocalFile() {
 #else
         char *afn =strdup(audiofile.name()); // store temporary the name
 #endif
+        if(nextLocalFile()){ // gapless, the queued file continues the output
+            AUDIO_INFO("End of file \"%s\", next queued file follows", afn);
+            if(audio_eof_mp3) audio_eof_mp3(afn);
+            if(afn) {free(afn); afn = NULL;}
+            return;
+        }
 		if (m_f_internalDAC) genFadeOut();
         m_f_running = false;
         m_streamType = ST_NONE;
         audiofile.close();
         AUDIO_INFO("Closing audio file");
 
-        if(m_codec == CODEC_MP3)    MP3Decoder_FreeBuffers();
-        if(m_codec == CODEC_AAC)    AACDecoder_FreeBuffers();
-        if(m_codec == CODEC_M4A)    AACDecoder_FreeBuffers();
-        if(m_codec == CODEC_FLAC)   FLACDecoder_FreeBuffers();
-        if(m_codec == CODEC_OPUS)   OPUSDecoder_FreeBuffers();
-        if(m_codec == CODEC_VORBIS) VORBISDecoder_FreeBuffers();
+        freeDecoder(m_codec);
         AUDIO_INFO("End of file \"%s\"", afn);
         if(audio_eof_mp3) audio_eof_mp3(afn);
         if(afn) {free(afn); afn = NULL;}
-		rms.reset();
+		m_pipeline.reset();
+		m_resampler.reset();
         return;
     }
 
     if(byteCounter == audiofile.size())                  {f_fileDataComplete = true;}
     if(byteCounter == m_audioDataSize + m_audioDataStart){f_fileDataComplete = true;}
+    if(f_fileDataComplete && !m_f_loop && !m_f_loopWindow) openQueuedFile(); // ahead of the end, the buffer still plays
 
     // play audio data - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
     if(f_stream){
@@ -3028,7 +3169,8 @@ void CYD_Audio::processWebFile() {
             AUDIO_INFO("End of webstream: \"%s\"", m_lastHost);
             if(audio_eof_stream) audio_eof_stream(m_lastHost);
         }
-		rms.reset();
+		m_pipeline.reset();
+		m_resampler.reset();
         return;
     }
 
@@ -3960,6 +4102,7 @@ int CYD_Audio::sendBytes(uint8_t* data, size_t len) {
     bytesLeft = len;
     m_decodeError= 0;
     int bytesDecoded = 0;
+    uint32_t decodeStart = ESP.getCycleCount();
 
     switch(m_codec){
         case CODEC_WAV:      memmove(m_outBuff, data , len); //copy len data in outbuff and set validsamples and bytesdecoded=len
@@ -3974,6 +4117,10 @@ int CYD_Audio::sendBytes(uint8_t* data, size_t len) {
         case CODEC_VORBIS:   m_decodeError = VORBISDecode(data, &bytesLeft, m_outBuff);    break;
         default: {log_e("no valid codec found codec = %d", m_codec); stopSong();}
     }
+    uint32_t decodeCycles = ESP.getCycleCount() - decodeStart;
+    m_decodeStats.calls++;
+    m_decodeStats.cycles += decodeCycles;
+    if(decodeCycles > m_decodeStats.worstCycles) m_decodeStats.worstCycles = decodeCycles;
 
     // m_decodeError - possible values are:
     //                   0: okay, no error
@@ -4047,7 +4194,9 @@ int CYD_Audio::sendBytes(uint8_t* data, size_t len) {
             m_PlayingStartTime = millis();
         }
     }
+    m_decodeStats.frames += m_validSamples;
     compute_audioCurrentTime(bytesDecoded);
+    if(m_f_loopWindow) captureLoop(); // frames behind the window are cut from m_outBuff
 
     if(audio_process_extern){
         bool continueI2S = false;
@@ -4060,6 +4209,7 @@ int CYD_Audio::sendBytes(uint8_t* data, size_t len) {
         //playChunk();
 		playChunkCYD();
     }
+    if(m_f_loopWindow && m_loopDecoded >= m_loopEnd) m_f_loopPlay = true; // window complete, no more decoding
     return bytesDecoded;
 }
 //---------------------------------------------------------------------------------------------------------------------
@@ -4339,15 +4489,19 @@ bool CYD_Audio::audioFileSeek(const float speed) {
     if((speed > 1.5f) || (speed < 0.25f)) return false;
 
     uint32_t srate = getSampleRate() * speed;
-    i2s_set_sample_rates((i2s_port_t)m_i2s_num, srate);
+    if(m_outputRate) m_resampler.setRates(srate, m_outputRate, m_polyphase); // I2S stays at the output rate
+    else i2s_set_sample_rates((i2s_port_t)m_i2s_num, srate);
     return true;
 }
 //---------------------------------------------------------------------------------------------------------------------
 bool CYD_Audio::setSampleRate(uint32_t sampRate) {
     if(!sampRate) sampRate = 16000; // fuse, if there is no value -> set default #209
-    i2s_set_sample_rates((i2s_port_t)m_i2s_num, sampRate);
+    if(!m_outputRate) i2s_set_sample_rates((i2s_port_t)m_i2s_num, sampRate);
     m_sampleRate = sampRate;
+    m_resampler.setRates(sampRate, getOutputRate(), m_polyphase); // bypassed while the rates match
     IIR_calculateCoefficients(m_gain0, m_gain1, m_gain2); // must be recalculated after each samplerate change
+    m_pipeline.setSampleRate(getOutputRate());   // time constants of the output stages are per block
+    updateEQ();
     return true;
 }
 uint32_t CYD_Audio::getSampleRate(){
@@ -4534,6 +4688,7 @@ void CYD_Audio::setTone(int8_t gainLowPass, int8_t gainBandPass, int8_t gainHigh
     m_corr =  pow10f((float)db/20);
 
     IIR_calculateCoefficients(m_gain0, m_gain1, m_gain2);
+    updateEQ();                     // block EQ of the CYD output, keeps its state: no click
 
     /*
         This will cause a clicking sound when adjusting the EQ.
@@ -4640,7 +4795,8 @@ void CYD_Audio::IIR_calculateCoefficients(int8_t G0, int8_t G1, int8_t G2){  //
     // G3 - gain high shelf  set between -40 ... +6 dB
     // https://www.earlevel.com/main/2012/11/26/biquad-c-source-code/
 
-    if(getSampleRate() < 1000) return;  // fuse
+    uint32_t rate = getOutputRate(); // the filters run after the resampler
+    if(rate < 1000) return;  // fuse
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
@@ -4655,8 +4811,8 @@ void CYD_Audio::IIR_calculateCoefficients(int8_t G0, int8_t G1, int8_t G2){  //
     const float FcPKEQ = 3000;  // Frequency PeakEQ[Hz]
           float FcHS   = 6000;  // Frequency HighShelf[Hz]
 
-    if(getSampleRate() < FcHS * 2 - 100){ // Prevent HighShelf filter from clogging
-        FcHS = getSampleRate() /2 - 100;
+    if(rate < FcHS * 2 - 100){ // Prevent HighShelf filter from clogging
+        FcHS = rate /2 - 100;
         // according to the sampling theorem, the sample rate must be at least 2 * 6000 >= 12000Hz for a filter
         // frequency of 6000Hz. If this is not the case, the filter frequency (plus a reserve of 100Hz) is lowered
         AUDIO_INFO("Highshelf frequency lowered, from 6000Hz to %dHz", (uint32_t)FcHS);
@@ -4664,7 +4820,7 @@ void CYD_Audio::IIR_calculateCoefficients(int8_t G0, int8_t G1, int8_t G2){  //
     float K, norm, Q, Fc, V ;
 
     // LOWSHELF
-    Fc = (float)FcLS / (float)getSampleRate(); // Cutoff frequency
+    Fc = (float)FcLS / (float)rate; // Cutoff frequency
     K = tanf((float)PI * Fc);
     V = powf(10, fabs(G0) / 20.0);
 
@@ -4686,7 +4842,7 @@ void CYD_Audio::IIR_calculateCoefficients(int8_t G0, int8_t G1, int8_t G2){  //
     }
 
     // PEAK EQ
-    Fc = (float)FcPKEQ / (float)getSampleRate(); // Cutoff frequency
+    Fc = (float)FcPKEQ / (float)rate; // Cutoff frequency
     K = tanf((float)PI * Fc);
     V = powf(10, fabs(G1) / 20.0);
     Q = 2.5; // Quality factor
@@ -4708,7 +4864,7 @@ void CYD_Audio::IIR_calculateCoefficients(int8_t G0, int8_t G1, int8_t G2){  //
     }
 
     // HIGHSHELF
-    Fc = (float)FcHS / (float)getSampleRate(); // Cutoff frequency
+    Fc = (float)FcHS / (float)rate; // Cutoff frequency
     K = tanf((float)PI * Fc);
     V = powf(10, fabs(G2) / 20.0);
     if (G2 >= 0) {  // boost
@@ -90,7 +90,9 @@ extern __attribute__((weak)) void audio_lasthost(const char*);
 extern __attribute__((weak)) void audio_eof_speech(const char*);
 extern __attribute__((weak)) void audio_eof_stream(const char*); // The webstream comes to an end
 extern __attribute__((weak)) void audio_process_extern(int16_t* buff, uint16_t len, bool *continueI2S); // record audiodata or send via BT
-extern __attribute__((weak)) void audio_process_i2s(uint32_t* sample, bool *continueI2S); // record audiodata or send via BT
+extern __attribute__((weak)) void audio_process_i2s(uint32_t* sample, bool *continueI2S); // not called on the CYD output path, see audio_process_block
+extern __attribute__((weak)) void audio_process_block(int32_t* buf, uint16_t sz); // "custom" stage of the output pipeline, int16 L | int16 R words
+extern __attribute__((weak)) void audio_levels(uint32_t levels); // peak/RMS of every output block, see setLevelMeter()
 
 
 //----------------------------------------------------------------------------------------------------------------------
@@ -162,7 +164,7 @@ protected:
 };
 //----------------------------------------------------------------------------------------------------------------------
 
-class CYD_Audio : private AudioBuffer, CYD_rms
+class CYD_Audio : private AudioBuffer
 {
 
     AudioBuffer InBuff; // instance of input buffer
@@ -170,7 +172,7 @@ class CYD_Audio : private AudioBuffer, CYD_rms
 public:
     //CYD_Audio(bool internalDAC = false, uint8_t channelEnabled = 3, uint8_t i2sPort = I2S_NUM_0); // #99
 
-	CYD_Audio(){};
+	CYD_Audio(){ initPipeline(); };
     ~CYD_Audio();
 
 	void begin(bool internalDAC = false, uint8_t channelEnabled = 3, uint8_t i2sPort = I2S_NUM_0); // #99
@@ -183,8 +185,22 @@ public:
     bool connecttoSD(const char* path, int32_t resumeFilePos = -1);
 	
 	// +++ CYD CUSTOM FUNCTIONS +++
-	// play a sample from a byte array located in flash - useful for short samples. Fixed  to 22050Hz, 8bit 1channel
-	//bool connecttoFLASH(const int8_t* dataBuf, const uint32_t length, int32_t resumeFilePos = -1);
+	// play an encoded audio file from a byte array (e.g. memory mapped flash partition).
+	// name is used for the codec detection only, the array must stay valid until playback ends
+#ifndef SDFATFS_USED
+	bool connecttoFLASH(const uint8_t* dataBuf, const uint32_t length, const char* name, int32_t resumeFilePos = -1);
+#endif
+	// gapless sequence: queued files follow the playing local file sample-contiguous,
+	// without fade, the decoder is kept if the codec matches. stopSong() clears the queue.
+	bool queueFS(fs::FS &fs, const char* path);
+	bool queueSD(const char* path);
+	void clearQueue();
+	uint8_t queueLength() { return m_queue.size(); }
+	// sample-exact loop of the next local file: frames [start, end) at the source rate are
+	// kept as PCM while the file plays once, then repeated from RAM without the decoder.
+	// end 0 = end of file. Applies to the next connect, stopSong() ends the loop.
+	bool setLoopPoints(uint32_t startFrame, uint32_t endFrame = 0);
+	bool isLooping() { return m_f_loopPlay; }
 
 	//bool connecttoStream(const int8_t* dataBuf, const uint32_t length, int32_t resumeFilePos = -1);
 
@@ -232,8 +248,38 @@ public:
 //+++ CYD related functions ++++++++++++++++++++++++++
 	
 	#define CYDAUDIO_DAC_BUF_SIZE 64 // dac processing block size
+	#define CYD_VOICE_IDLE_BLOCKS 8 // blocks output per loop() while only voices play
+	#define CYD_VOICE_BIAS_STEP 0x400 // internal DAC bias ramp per block around idle voices, 32 blocks
+#ifndef CYD_LOOP_MAX_BYTES
+	#define CYD_LOOP_MAX_BYTES (96 * 1024) // loop window PCM, 0.55 s stereo / 1.1 s mono at 44.1 kHz
+#endif
+	#define CYD_LOOP_GROW_BYTES 16384 // window buffer growth while the end is not known
+	#define CYD_LOOP_CHUNK_FRAMES 1024 // frames replayed per loop() call
 	void setVolumeCYD(uint8_t vol); 
 	uint32_t getRMS(void) { return rms.getLast(); }	
+	// audio_levels() is called only while enabled: peakL << 24 | peakR << 16 | rmsL << 8 | rmsR, 0-255 of full scale
+	void setLevelMeter(bool enable) { rms.setLevelHook(enable ? audio_levels : nullptr); }
+	void setLowCut(uint16_t hz);		// high pass in front of the tone filters, 0 = off
+	void benchmarkEQ(uint32_t *blockCycles, uint32_t *chainCycles);
+	// I2S stays at this rate, other source rates are resampled, 0 = I2S follows the source
+	void setOutputRate(uint32_t hz, bool polyphase = true);
+	uint32_t getOutputRate() { return m_outputRate ? m_outputRate : m_sampleRate; }
+	// output stages run on every block: mixer, eq, custom, limiter, meter
+	CYD_pipeline &pipeline() { return m_pipeline; }
+	CYD_mixer &mixer() { return m_mixer; }
+	CYD_limiter &limiter() { return m_limiter; }
+	// sound effects from 16 bit PCM in memory, mixed over the stream or played alone
+	int8_t playVoice(const int16_t *pcm, uint32_t frames, uint8_t channels, uint32_t rate, float speed = 1.0f, float gain = 1.0f);
+	CYD_voices &voices() { return m_voices; }
+	// decoder cost since the last connect, CPU cycles around every decoder call
+	typedef struct
+	{
+		uint32_t calls;			// decoder calls
+		uint64_t frames;		// decoded frames, samples per channel
+		uint64_t cycles;		// cycles spent in the decoder
+		uint32_t worstCycles;	// slowest single call
+	} decodeStats_t;
+	const decodeStats_t &getDecodeStats() { return m_decodeStats; }
 private:
 
     #ifndef ESP_ARDUINO_VERSION_VAL
@@ -247,6 +293,7 @@ private:
     void setDefaults(); // free buffers and set defaults
     void initInBuff();
     bool httpPrint(const char* host);
+    bool startLocalFile();
     void processLocalFile();
     void processWebStream();
     void processWebFile();
@@ -285,6 +332,8 @@ private:
     bool parseContentType(char* ct);
     bool parseHttpResponseHeader();
     bool initializeDecoder();
+    uint8_t codecFromName(const char* name);
+    void freeDecoder(uint8_t codec);
     esp_err_t I2Sstart(uint8_t i2s_num);
     esp_err_t I2Sstop(uint8_t i2s_num);
     void urlencode(char* buff, uint16_t buffLen, bool spacesOnly = false);
@@ -360,7 +409,7 @@ private:
         const char *p = base;
         for (; startIndex > 0; startIndex--)
             if (*p++ == '\0') return -1;
-        char* pos = strstr(p, str);
+        const char* pos = strstr(p, str);
         if (pos == nullptr) return -1;
         return pos - base;
     }
@@ -370,7 +419,7 @@ private:
         const char *p = base;
         for (; startIndex > 0; startIndex--)
             if (*p++ == '\0') return -1;
-        char *pos = strchr(p, ch);
+        const char *pos = strchr(p, ch);
         if (pos == nullptr) return -1;
         return pos - base;
     }
@@ -518,6 +567,37 @@ typedef enum
 	uint32_t m_fader_step = 0x7FFFFF;		// how fast the fade happens
 	PlayStatus_e m_play_status = FADE_IN;
 	CYD_rms rms = CYD_rms(CYDAUDIO_DAC_BUF_SIZE);	// RMS detector
+	CYD_biquad m_eq;						// low cut + tone filters on the output blocks
+	CYD_mixer m_mixer;
+	CYD_voices m_voices;
+	CYD_limiter m_limiter;
+	CYD_hookStage m_custom = CYD_hookStage("custom", audio_process_block);
+	CYD_pipeline m_pipeline;
+	CYD_resampler m_resampler;				// source rate -> m_outputRate, in front of the pipeline
+	uint32_t m_outputRate = 0;
+	bool m_polyphase = true;
+	uint32_t m_blockBias = 0;				// DAC bias at the end of the last output block
+	uint16_t m_lowCutHz = 0;
+	int16_t *m_loopBuf = nullptr;			// loop window, interleaved like m_outBuff
+	uint32_t m_loopBytes = 0;				// allocated size of m_loopBuf
+	uint32_t m_loopStart = 0;				// loop window in source frames
+	uint32_t m_loopEnd = 0;					// UINT32_MAX = end of file
+	uint32_t m_loopDecoded = 0;				// frames decoded from the file so far
+	uint32_t m_loopFrames = 0;				// frames held in m_loopBuf
+	uint32_t m_loopPos = 0;					// replay position in the window
+	bool m_f_loopArmed = false;				// setLoopPoints() waits for the next connect
+	bool m_f_loopWindow = false;			// capturing the window of the playing file
+	bool m_f_loopPlay = false;				// window complete, repeated from RAM
+	decodeStats_t m_decodeStats = {};
+	void initPipeline();
+	void updateEQ();
+	void processBlock(int32_t *buf, uint16_t sz);
+	void addDACbias(int32_t *buf, uint16_t sz);
+	void playVoicesCYD();
+	void captureLoop();
+	void playLoopCYD();
+	void endLoop();
+	bool playResampledCYD(data_cfg_t cfg);
 	
 
 	bool playChunkCYD();
@@ -525,6 +605,8 @@ typedef enum
 	int32_t prepareDACdata(data_cfg_t cfg,	int32_t *outBfPtr, 
 							uint16_t sz );
 	void genFadeOut(void);						
+	void openQueuedFile();
+	bool nextLocalFile();
 	void fillDACbuf(int32_t val);	// used to fill DA  with value (internal DAC )
 	void writeDACbuf();
 //+++ CYD CUSTOM  FUNCTIOS ++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -538,6 +620,9 @@ typedef enum
     i2s_pin_config_t      m_pin_config = {};
     std::vector<char*>    m_playlistContent; // m3u8 playlist buffer
     std::vector<char*>    m_playlistURL;     // m3u8 streamURLs buffer
+    std::vector<char*>    m_queue;           // paths of the files queued after audiofile, on m_queueFS
+    fs::FS*               m_queueFS = nullptr;
+    File                  m_nextFile;        // first queued file, opened while audiofile still plays
     std::vector<uint32_t> m_hashQueue;
 
     const size_t    m_frameSizeWav    = 1024;
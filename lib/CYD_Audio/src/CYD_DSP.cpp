@@ -1,3 +1,452 @@
 #include "CYD_DSP.h"
 
-// for future add ons
\ No newline at end of file
+// -----------------------------------------------------------
+/**
+ * @brief Set the coefficients of one stage and enable it. A stage that was
+ * 		bypassed starts from a cleared state.
+ * 
+ * @param stage cascade position, 0..CYD_BIQUAD_STAGES-1
+ * @param gain scales the feed forward part, e.g. to make headroom for a boost
+ */
+void CYD_biquad::setStage(uint8_t stage, float a0, float a1, float a2, float b1, float b2, float gain)
+{
+	if (stage >= CYD_BIQUAD_STAGES) return;
+	// double: a float product would break the exact zeros of a high pass (a0 + a1 + a2 = 0)
+	const double q = (double)(1UL << CYD_BIQUAD_SHIFT);
+	coef[stage].a0 = lrint((double)a0 * gain * q);
+	coef[stage].a1 = lrint((double)a1 * gain * q);
+	coef[stage].a2 = lrint((double)a2 * gain * q);
+	coef[stage].b1 = lrint((double)b1 * q);
+	coef[stage].b2 = lrint((double)b2 * q);
+	if (!enabled[stage])
+	{
+		memset(state[stage], 0, sizeof(state[stage]));
+		enabled[stage] = true;
+		updateActive();
+	}
+}
+// -----------------------------------------------------------
+void CYD_biquad::bypassStage(uint8_t stage)
+{
+	if (stage >= CYD_BIQUAD_STAGES || !enabled[stage]) return;
+	enabled[stage] = false;
+	updateActive();
+}
+// -----------------------------------------------------------
+void CYD_biquad::updateActive()
+{
+	activeCount = 0;
+	for (uint8_t i = 0; i < CYD_BIQUAD_STAGES; i++)
+	{
+		if (enabled[i]) active_idx[activeCount++] = i;
+	}
+}
+// -----------------------------------------------------------
+/**
+ * @brief One stage over one channel, in place
+ */
+void CYD_biquad::run(int32_t *x, uint16_t n, const coef_t &c, state_t &s)
+{
+	int32_t x1 = s.x1, x2 = s.x2, y1 = s.y1, y2 = s.y2;
+	int32_t err = s.err;
+	const int32_t *end = x + n;
+	while (x < end)
+	{
+		int64_t acc = (int64_t)c.a0 * *x + (int64_t)c.a1 * x1 + (int64_t)c.a2 * x2
+					- (int64_t)c.b1 * y1 - (int64_t)c.b2 * y2 + err;
+		x2 = x1;
+		x1 = *x;
+		y2 = y1;
+		y1 = (int32_t)(acc >> CYD_BIQUAD_SHIFT);
+		err = (int32_t)acc & ((1L << CYD_BIQUAD_SHIFT) - 1);	// error feedback, the truncation bias is not amplified by the poles
+		*x++ = y1;
+	}
+	s.x1 = x1;
+	s.x2 = x2;
+	s.y1 = y1;
+	s.y2 = y2;
+	s.err = err;
+}
+// -----------------------------------------------------------
+/**
+ * @brief Filter a block in place through all enabled stages
+ * 
+ * @param buf DAC words, int16 L | int16 R
+ * @param sz number of words
+ */
+void CYD_biquad::process(int32_t *buf, uint16_t sz)
+{
+	while (activeCount && sz)
+	{
+		uint16_t n = min(sz, (uint16_t)CYD_DSP_BLOCK);
+		for (uint16_t i = 0; i < n; i++)
+		{
+			work[0][i] = (int32_t)(int16_t)(buf[i] >> 16) << CYD_BIQUAD_GUARD;
+			work[1][i] = (int32_t)(int16_t)(buf[i] & 0xFFFF) << CYD_BIQUAD_GUARD;
+		}
+		for (uint8_t k = 0; k < activeCount; k++)
+		{
+			uint8_t stage = active_idx[k];
+			run(work[0], n, coef[stage], state[stage][0]);
+			run(work[1], n, coef[stage], state[stage][1]);
+		}
+		for (uint16_t i = 0; i < n; i++)
+		{
+			buf[i] = pack_16b_16b(saturate16(work[0][i] >> CYD_BIQUAD_GUARD), saturate16(work[1][i] >> CYD_BIQUAD_GUARD));
+		}
+		buf += n;
+		sz -= n;
+	}
+}
+// -----------------------------------------------------------
+/**
+ * @brief Apply the gain, ramped from the last block's value to a new one
+ */
+void CYD_gain::process(int32_t *buf, uint16_t sz)
+{
+	int32_t end = target;
+	if (gain == 0x10000 && end == 0x10000) return;
+	int32_t step = (end - gain) / sz;
+	int32_t g = gain;
+	for (uint16_t i = 0; i < sz; i++)
+	{
+		g += step;
+		buf[i] = pack_16b_16b(saturate16(signed_multiply_32x16t(g, buf[i])), 
+							  saturate16(signed_multiply_32x16b(g, buf[i])));
+	}
+	gain = end;
+}
+// -----------------------------------------------------------
+/**
+ * @brief Limit the block peak to the threshold
+ */
+void CYD_limiter::process(int32_t *buf, uint16_t sz)
+{
+	int32_t peak = 0;
+	for (uint16_t i = 0; i < sz; i++)
+	{
+		int32_t l = (int16_t)(buf[i] >> 16);
+		int32_t r = (int16_t)(buf[i] & 0xFFFF);
+		if (l < 0) l = -l;
+		if (r < 0) r = -r;
+		if (l > peak) peak = l;
+		if (r > peak) peak = r;
+	}
+	uint32_t limit = (peak > threshold) ? ((uint32_t)threshold << 16) / peak : 0x10000;
+	uint32_t start = gain;
+	if (limit < gain)
+		start = gain = limit;				// attack at once, the whole block stays below the limit
+	else
+		gain = min(gain + (uint32_t)(((uint64_t)(0x10000 - gain) * releaseCoef) >> 16) + 1, limit);
+	if (start == 0x10000 && gain == 0x10000) return;
+	int32_t step = ((int32_t)gain - (int32_t)start) / sz;
+	int32_t g = start;
+	for (uint16_t i = 0; i < sz; i++)
+	{
+		g += step;
+		buf[i] = pack_16b_16b(signed_multiply_32x16t(g, buf[i]), signed_multiply_32x16b(g, buf[i]));
+	}
+}
+// -----------------------------------------------------------
+bool CYD_mixer::addSource(CYD_mixSource *src)
+{
+	if (count >= CYD_MIX_SOURCES) return false;
+	for (uint8_t i = 0; i < count; i++) if (sources[i] == src) return true;
+	sources[count++] = src;
+	return true;
+}
+// -----------------------------------------------------------
+bool CYD_mixer::removeSource(CYD_mixSource *src)
+{
+	for (uint8_t i = 0; i < count; i++)
+	{
+		if (sources[i] != src) continue;
+		memmove(&sources[i], &sources[i + 1], (count - i - 1) * sizeof(sources[0]));
+		count--;
+		return true;
+	}
+	return false;
+}
+// -----------------------------------------------------------
+/**
+ * @brief Start the voice from the first frame
+ * 
+ * @param pcm interleaved 16 bit samples
+ * @param frames number of frames (samples per channel)
+ * @param channels 1 or 2
+ * @param step Q16.16 source frames per output sample
+ * @param gain Q15, 32768 = unity
+ */
+void CYD_voice::play(const int16_t *pcm, uint32_t frames, uint8_t channels, uint32_t step, uint16_t gain)
+{
+	data = nullptr;
+	if (!pcm || frames < 2 || !step || channels < 1 || channels > 2) return;
+	this->frames = frames;
+	this->channels = channels;
+	this->step = min(step, (uint32_t)CYD_VOICE_MAX_STEP);
+	this->gain = gain;
+	idx = 0;
+	frac = 0;
+	data = pcm;
+}
+// -----------------------------------------------------------
+void CYD_voice::mix(int32_t *buf, uint16_t sz)
+{
+	const uint32_t last = frames - 1;			// interpolation reads idx + 1
+	for (uint16_t i = 0; i < sz; i++)
+	{
+		if (idx >= last)
+		{
+			data = nullptr;
+			return;
+		}
+		int32_t l, r;
+		if (channels == 1)
+		{
+			int32_t s0 = data[idx], s1 = data[idx + 1];
+			l = r = s0 + (((s1 - s0) * (int32_t)(frac >> 1)) >> 15);
+		}
+		else
+		{
+			const int16_t *p = &data[idx * 2];
+			l = p[0] + (((p[2] - p[0]) * (int32_t)(frac >> 1)) >> 15);
+			r = p[1] + (((p[3] - p[1]) * (int32_t)(frac >> 1)) >> 15);
+		}
+		buf[i] = mix_16b_16b(buf[i], (l * gain) >> 15, (r * gain) >> 15);
+		frac += step;
+		idx += frac >> 16;
+		frac &= 0xFFFF;
+	}
+}
+// -----------------------------------------------------------
+/**
+ * @return voice number, -1 if the data is not playable
+ */
+int8_t CYD_voices::play(const int16_t *pcm, uint32_t frames, uint8_t channels, uint32_t step, uint16_t gain)
+{
+	uint8_t v = 0;
+	for (uint8_t i = 0; i < CYD_VOICES; i++)
+	{
+		if (!voice[i].active())
+		{
+			v = i;
+			break;
+		}
+		if (started[i] < started[v]) v = i;	// oldest gets stolen
+	}
+	voice[v].play(pcm, frames, channels, step, gain);
+	if (!voice[v].active()) return -1;
+	started[v] = ++triggers;
+	return v;
+}
+// -----------------------------------------------------------
+void CYD_voices::stopSource(const int16_t *pcm)
+{
+	for (uint8_t v = 0; v < CYD_VOICES; v++)
+		if (voice[v].source() == pcm) voice[v].stop();
+}
+// -----------------------------------------------------------
+void CYD_voices::stopAll()
+{
+	for (uint8_t v = 0; v < CYD_VOICES; v++) voice[v].stop();
+}
+// -----------------------------------------------------------
+uint8_t CYD_voices::active()
+{
+	uint8_t n = 0;
+	for (uint8_t v = 0; v < CYD_VOICES; v++) n += voice[v].active();
+	return n;
+}
+// -----------------------------------------------------------
+/**
+ * @brief Insert a stage at a position of the chain
+ * 
+ * @param pos index in the chain, past the end appends
+ * @return false chain full or stage already in it
+ */
+bool CYD_pipeline::insert(CYD_dspStage *stage, uint8_t pos)
+{
+	if (!stage || stageCount >= CYD_DSP_STAGES) return false;
+	for (uint8_t i = 0; i < stageCount; i++) if (stages[i] == stage) return false;
+	if (pos > stageCount) pos = stageCount;
+	memmove(&stages[pos + 1], &stages[pos], (stageCount - pos) * sizeof(stages[0]));
+	stages[pos] = stage;
+	stageCount++;
+	return true;
+}
+// -----------------------------------------------------------
+bool CYD_pipeline::remove(CYD_dspStage *stage)
+{
+	for (uint8_t i = 0; i < stageCount; i++)
+	{
+		if (stages[i] != stage) continue;
+		memmove(&stages[i], &stages[i + 1], (stageCount - i - 1) * sizeof(stages[0]));
+		stageCount--;
+		return true;
+	}
+	return false;
+}
+// -----------------------------------------------------------
+/**
+ * @brief Run the enabled stages in order over one block
+ */
+void CYD_pipeline::process(int32_t *buf, uint16_t sz)
+{
+	for (uint8_t i = 0; i < stageCount; i++)
+	{
+		CYD_dspStage *s = stages[i];
+		if (!s->enabled) continue;
+		uint32_t t0 = ESP.getCycleCount();
+		s->process(buf, sz);
+		s->cycles += ESP.getCycleCount() - t0;
+	}
+}
+// -----------------------------------------------------------
+void CYD_pipeline::reset()
+{
+	for (uint8_t i = 0; i < stageCount; i++) stages[i]->reset();
+}
+// -----------------------------------------------------------
+void CYD_pipeline::setSampleRate(uint32_t rate)
+{
+	for (uint8_t i = 0; i < stageCount; i++) stages[i]->setSampleRate(rate);
+}
+// -----------------------------------------------------------
+/**
+ * @brief Set the conversion ratio and build the FIR table. The fill level and
+ * 		position are kept, so the ratio can change while streaming.
+ * 
+ * @param inRate source sample rate (may include a speed factor)
+ * @param outRate output sample rate
+ * @param polyphase true: 8 tap FIR, false: linear interpolation
+ */
+void CYD_resampler::setRates(uint32_t inRate, uint32_t outRate, bool polyphase)
+{
+	if (!inRate || !outRate) return;
+	step = min((uint32_t)(((uint64_t)inRate << 16) / outRate), (uint32_t)CYD_RESAMPLER_MAX_STEP);
+	fir = polyphase;
+	if (!fir || !active()) return;
+
+	// windowed sinc, cut off a little below the lower Nyquist frequency (cycles per input sample)
+	float fc = 0.45f * min(1.0f, (float)outRate / inRate);
+	const float half = CYD_RESAMPLER_TAPS / 2;
+	for (uint16_t p = 0; p <= CYD_RESAMPLER_PHASES; p++)
+	{
+		float frac = (float)p / CYD_RESAMPLER_PHASES;
+		float h[CYD_RESAMPLER_TAPS];
+		float sum = 0;
+		for (uint16_t k = 0; k < CYD_RESAMPLER_TAPS; k++)
+		{
+			float t = (float)k - history - frac;	// distance of tap k from the position
+			float x = 2 * fc * t;
+			float sinc = (fabsf(x) < 1e-6f) ? 1.0f : sinf((float)PI * x) / ((float)PI * x);
+			float w = 0.42f + 0.5f * cosf((float)PI * t / half) + 0.08f * cosf(2 * (float)PI * t / half);	// Blackman
+			h[k] = (fabsf(t) < half) ? sinc * w : 0;
+			sum += h[k];
+		}
+		int32_t total = 0;
+		for (uint16_t k = 0; k < CYD_RESAMPLER_TAPS; k++)
+		{
+			coef[p][k] = lrintf(h[k] / sum * 32768.0f);
+			total += coef[p][k];
+		}
+		coef[p][history] += 32768 - total;			// exact unity gain at DC
+	}
+}
+// -----------------------------------------------------------
+void CYD_resampler::reset()
+{
+	memset(fifo, 0, history * sizeof(fifo[0]));	// silent history in front of the first sample
+	count = history;
+	pos = history << 16;
+}
+// -----------------------------------------------------------
+uint16_t CYD_resampler::available()
+{
+	uint32_t limit = (uint32_t)(count - CYD_RESAMPLER_TAPS / 2) << 16;	// last position with all taps present
+	if (count < CYD_RESAMPLER_TAPS / 2 || pos >= limit) return 0;
+	return (limit - pos + step - 1) / step;
+}
+// -----------------------------------------------------------
+/**
+ * @brief Produce output words, then drop the input no longer needed
+ * 
+ * @return words written, up to n and up to available()
+ */
+uint16_t CYD_resampler::read(int32_t *out, uint16_t n)
+{
+	n = min(n, available());
+	for (uint16_t i = 0; i < n; i++)
+	{
+		uint32_t idx = pos >> 16;
+		uint32_t frac = pos & 0xFFFF;
+		int32_t l, r;
+		if (fir)
+		{
+			// coefficients interpolated between the two nearest phases
+			const int16_t *h0 = coef[frac >> CYD_RESAMPLER_SUB_BITS];
+			const int16_t *h1 = h0 + CYD_RESAMPLER_TAPS;
+			int32_t sub = frac & ((1 << CYD_RESAMPLER_SUB_BITS) - 1);
+			const int32_t *x = &fifo[idx - history];
+			int32_t accL = 0, accR = 0;
+			for (uint16_t k = 0; k < CYD_RESAMPLER_TAPS; k++)
+			{
+				int32_t h = h0[k] + (((h1[k] - h0[k]) * sub) >> CYD_RESAMPLER_SUB_BITS);
+				accL += h * (x[k] >> 16);
+				accR += h * (int16_t)(x[k] & 0xFFFF);
+			}
+			l = saturate16(accL >> 15);
+			r = saturate16(accR >> 15);
+		}
+		else
+		{
+			int32_t l0 = fifo[idx] >> 16, l1 = fifo[idx + 1] >> 16;
+			int32_t r0 = (int16_t)(fifo[idx] & 0xFFFF), r1 = (int16_t)(fifo[idx + 1] & 0xFFFF);
+			l = l0 + (((l1 - l0) * (int32_t)(frac >> 1)) >> 15);
+			r = r0 + (((r1 - r0) * (int32_t)(frac >> 1)) >> 15);
+		}
+		out[i] = pack_16b_16b(l, r);
+		pos += step;
+	}
+	uint32_t drop = pos >> 16;
+	if (drop > history)
+	{
+		drop -= history;
+		if (drop > count) drop = count;
+		memmove(fifo, &fifo[drop], (count - drop) * sizeof(fifo[0]));
+		count -= drop;
+		pos -= drop << 16;
+	}
+	return n;
+}
+// -----------------------------------------------------------
+/**
+ * @brief Time a conversion of a test tone
+ * 
+ * @return CPU cycles for outSamples output words
+ */
+uint32_t CYD_resampler::benchmark(uint32_t inRate, uint32_t outRate, bool polyphase, uint16_t outSamples)
+{
+	CYD_resampler rs;
+	rs.setRates(inRate, outRate, polyphase);
+	int32_t out[CYD_DSP_BLOCK];
+	uint32_t phase = 0, cycles = 0;
+	while (outSamples)
+	{
+		uint16_t space;
+		int32_t *in = rs.writeBuffer(&space);
+		for (uint16_t i = 0; i < space; i++)
+		{
+			int16_t v = 16000 * sinf(2 * (float)PI * 1000 * phase++ / inRate);
+			in[i] = pack_16b_16b(v, v);
+		}
+		rs.commit(space);
+		uint16_t n = min(outSamples, (uint16_t)CYD_DSP_BLOCK);
+		uint32_t t0 = ESP.getCycleCount();
+		n = rs.read(out, n);
+		cycles += ESP.getCycleCount() - t0;
+		outSamples -= n;
+	}
+	return cycles;
+}
+// -----------------------------------------------------------
@@ -70,100 +70,482 @@ static inline uint32_t pack_16b_16b(int32_t a, int32_t b)
 	return (a << 16) | (b & 0x0000FFFF);
 }
 
+// adds l/r to the halves of a DAC word with saturation: (a[31:16] + l) | (a[15:0] + r)
+static inline uint32_t mix_16b_16b(int32_t a, int32_t l, int32_t r) __attribute__((always_inline, unused));
+static inline uint32_t mix_16b_16b(int32_t a, int32_t l, int32_t r)
+{
+	return pack_16b_16b(saturate16((a >> 16) + l), saturate16((int16_t)(a & 0xFFFF) + r));
+}
+
 // -----------------------------------------------------------
+#define CYD_DSP_BLOCK		64		// largest block a stage is handed, words
+#define CYD_DSP_STAGES		8		// stages a pipeline can hold
+
 /**
- * @brief calculates RMS value of a stereo input block
- * 		data format u16_R u16_L
+ * @brief One stage of the output pipeline (CYD_pipeline)
+ * 		Processes a stereo block in place, data format i16_L i16_R (R in the low
+ * 		half of each word), no DC bias, at most CYD_DSP_BLOCK words.
  */
-class CYD_rms
+class CYD_dspStage
+{
+public:
+	virtual ~CYD_dspStage(){};
+	virtual const char *name() = 0;
+	virtual void process(int32_t *buf, uint16_t sz) = 0;
+	virtual void reset() {}					// new track, clear the state
+	virtual void setSampleRate(uint32_t rate) {}
+
+	bool enabled = true;					// skipped by the pipeline while false
+	uint32_t cycles = 0;					// CPU cycles spent in process() since boot
+};
+
+// -----------------------------------------------------------
+#define CYD_RMS_ATTACK_MS	10		// default RMS rise time constant
+#define CYD_RMS_RELEASE_MS	300		// default RMS and peak fall time constant
+#define CYD_RMS_HOLD_MS		1000	// default peak hold time
+
+// computes floor(sqrt(val)), bit by bit
+static inline uint32_t isqrt32(uint32_t val) __attribute__((always_inline, unused));
+static inline uint32_t isqrt32(uint32_t val)
+{
+	uint32_t res = 0;
+	uint32_t bit = 1UL << 30;
+	while (bit > val) bit >>= 2;
+	while (bit)
+	{
+		if (val >= res + bit)
+		{
+			val -= res + bit;
+			res = (res >> 1) + bit;
+		}
+		else
+			res >>= 1;
+		bit >>= 2;
+	}
+	return res;
+}
+
+/**
+ * @brief Block level detector of a stereo output block
+ * 		data format u16_L u16_R (R in the low half of each word)
+ * 
+ * 		Per block: true sum of squares and sample peak of each channel.
+ * 		The block mean squares are averaged with the attack constant, the meter
+ * 		follows a rising average at once and a falling one with the release
+ * 		constant. Averaging first keeps a steady signal at its true RMS: the
+ * 		mean square of a short block swings with the waveform, and a fast attack
+ * 		with a slow release on those swings would read high. RMS is the root of
+ * 		the meter when read. The peak rises at once, is held for the hold time and
+ * 		then falls with the release constant.
+ * 		Levels are linear, 0..32768 of full scale.
+ * 		The audio path is integer only, the coefficients are calculated by
+ * 		setBallistics() / setSampleRate().
+ */
+class CYD_rms : public CYD_dspStage
 {
 public:
 	CYD_rms(uint16_t audioBlockSampleCount = 32) : block_smpcount(audioBlockSampleCount) 
 	{
 		reset();
-		setSpan(64);
+		setBallistics(CYD_RMS_ATTACK_MS, CYD_RMS_RELEASE_MS, CYD_RMS_HOLD_MS);
 	};
 	~CYD_rms(){};
 
+	const char *name() { return "meter"; }
 	bool available() { return ready; }
 
-	void setBias(int16_t v) { bias = -v;}
+	void setBias(uint16_t v) { bias = v; }		// DC offset of the samples (internal DAC)
+	void setLevelHook(void (*hook)(uint32_t levels)) { levelHook = hook; }	// called with getLevels8() after every block
 
-	void setSpan(uint16_t blocks)	// after how many blocks of accumulating calcualte the rms
+	void setSampleRate(uint32_t rate)
 	{
-		count_cmp = blocks * block_smpcount;
+		if (!rate || rate == sampleRate) return;
+		sampleRate = rate;
+		calcCoefficients();
+	}
+	void setBallistics(uint16_t attackMs, uint16_t releaseMs, uint16_t holdMs)
+	{
+		attack_ms = attackMs;
+		release_ms = releaseMs;
+		hold_ms = holdMs;
+		calcCoefficients();
 	}
 	void getLast(uint32_t *lvlR, uint32_t *lvlL) 
 	{ 
-		*lvlR = lastResultR;
-		*lvlL = lastResultL;
+		*lvlR = isqrt32(msR);
+		*lvlL = isqrt32(msL);
 	}
-	uint32_t getLast() 
+	uint32_t getLast()		// smoothed RMS, R << 16 | L
 	{ 
-		uint32_t result = (lastResultR << 16) | (lastResultL & 0xFFFF);
+		uint32_t result = (min(isqrt32(msR), (uint32_t)0xFFFF) << 16) | min(isqrt32(msL), (uint32_t)0xFFFF);
 		ready = false;
 		return result;
 	}
+	void getPeak(uint32_t *pkR, uint32_t *pkL)
+	{
+		*pkR = peakR >> 16;
+		*pkL = peakL >> 16;
+	}
+	uint32_t getLevels8()	// 0-255 of full scale: peakL << 24 | peakR << 16 | rmsL << 8 | rmsR
+	{
+		return (level8(peakL) << 24) | (level8(peakR) << 16) | (level8(isqrt32(msL) << 16) << 8) | level8(isqrt32(msR) << 16);
+	}
 	void  reset()
 	{
-		count = 0;
-		accL = 0;
-		accR = 0;
-		lastResultL = 0;
-		lastResultR = 0;
+		msL = msR = 0;
+		avgL = avgR = 0;
+		peakL = peakR = 0;
+		holdL = holdR = 0;
+		ready = false;
 	}
 	void process(int32_t *src, uint16_t sz)
 	{
-		int16_t *src16 = (int16_t *)src;
-		int16_t *end16 = src16 + 2*sz;
-		int64_t sumL, sumR;
+		if (!sz) return;
+		const uint16_t *src16 = (const uint16_t *)src;
+		const uint16_t *end16 = src16 + 2*sz;
+		uint64_t sumL = 0, sumR = 0;
+		uint32_t pkL = 0, pkR = 0;
 		do {
-			int16_t r1 = (*src16++) - bias;
-			int16_t l1 = (*src16++) - bias;
-			int16_t r2 = (*src16++) - bias;
-			int16_t l2 = (*src16++) - bias;
-
-			sumR  = ((int32_t)r1 * r1) >> 16; // r1^2 
-			sumR += ((int32_t)r2 * r2) >> 16; // r2^2
-			sumL  = ((int32_t)l1 * l1) >> 16; // l1^2 
-			sumL += ((int32_t)l2 * l2) >> 16; // l2^2
+			int32_t r = (int16_t)(uint16_t)(*src16++ - bias);
+			int32_t l = (int16_t)(uint16_t)(*src16++ - bias);
+			sumR += (uint32_t)(r * r);
+			sumL += (uint32_t)(l * l);
+			if (r < 0) r = -r;
+			if (l < 0) l = -l;
+			if ((uint32_t)r > pkR) pkR = r;
+			if ((uint32_t)l > pkL) pkL = l;
 		} while (src16 < end16);
-		accL += sumL;
-		accR += sumR;
-		count += sz;
-		if (count >= count_cmp)
+
+		smooth(&avgL, &msL, sumL / sz);
+		smooth(&avgR, &msR, sumR / sz);
+		hold(&peakL, &holdL, pkL << 16, sz);
+		hold(&peakR, &holdR, pkR << 16, sz);
+		ready = true;
+		if (levelHook) levelHook(getLevels8());
+	}
+private:
+	const uint16_t block_smpcount; 
+	uint16_t bias = 0;
+	uint32_t sampleRate = 44100;
+	uint16_t attack_ms, release_ms, hold_ms;
+	uint32_t attackCoef, releaseCoef;	// Q16 step per block towards the target
+	uint32_t holdSamples;
+	uint32_t avgL, avgR;				// block mean squares averaged with the attack constant
+	uint32_t msL, msR;					// mean square with release ballistics
+	uint32_t peakL, peakR;				// Q16
+	uint32_t holdL, holdR;				// samples left in the peak hold
+	bool ready = false;
+	void (*levelHook)(uint32_t levels) = nullptr;
+
+	// coef = 1 - e^(-block / (rate * tau)) per block, outside the audio path
+	uint32_t blockCoef(uint16_t ms)
+	{
+		if (!ms) return 1UL << 16;
+		return (uint32_t)((1.0f - expf(-(float)block_smpcount * 1000.0f / ((float)sampleRate * ms))) * 65536.0f);
+	}
+	void calcCoefficients()
+	{
+		attackCoef = blockCoef(attack_ms);
+		releaseCoef = blockCoef(release_ms);
+		holdSamples = (uint32_t)hold_ms * sampleRate / 1000;
+	}
+	void release(uint32_t *level, uint32_t target)
+	{
+		*level += (((int64_t)target - *level) * releaseCoef) >> 16;
+	}
+	void smooth(uint32_t *avg, uint32_t *level, uint32_t target)
+	{
+		*avg += (((int64_t)target - *avg) * attackCoef) >> 16;
+		if (*avg >= *level) *level = *avg;
+		else release(level, *avg);
+	}
+	void hold(uint32_t *peak, uint32_t *holdLeft, uint32_t target, uint16_t sz)
+	{
+		if (target >= *peak)
+		{
+			*peak = target;
+			*holdLeft = holdSamples;
+		}
+		else if (*holdLeft > sz)
+			*holdLeft -= sz;
+		else
 		{
-			float rmsL, rmsR;
-			int64_t meansq = accL / count;
-			rmsL = 10.0f * sqrtf((float)meansq);
-			meansq = accR / count;
-			rmsR = 10.0f * sqrtf((float)meansq);
-
-			lastResultL = rmsL;
-			lastResultR = rmsR;
-			count = 0;
-			accL = 0;
-			accR = 0;
-			ready = true;
-			//log_i("RMSr= %d, RMSl= %d", lastResultR, lastResultL);
+			*holdLeft = 0;
+			release(peak, target);
 		}
 	}
+	static uint32_t level8(uint32_t level) { return min(level >> 23, (uint32_t)255); }
+};
+
+// -----------------------------------------------------------
+#define CYD_BIQUAD_STAGES	4		// low cut + the three tone filters
+#define CYD_BIQUAD_SHIFT	28		// coefficient fraction bits
+#define CYD_BIQUAD_GUARD	8		// extra fraction bits of the filter state
+
+/**
+ * @brief Fixed point biquad cascade, filters a stereo output block in place
+ * 		data format i16_L i16_R (R in the low half of each word), no DC bias
+ * 
+ * 		Direct form I: Q28 coefficients, samples and state with 8 guard bits,
+ * 		64 bit accumulator with first order error feedback (low corner
+ * 		frequencies need it, their poles amplify a truncation bias). Each channel is unpacked once, runs through all
+ * 		enabled stages with the coefficients and state in registers and is
+ * 		saturated and packed once.
+ * 		DF1 only holds past inputs and outputs, so coefficients may change
+ * 		between two blocks without clearing the state. setStage() must be
+ * 		called from the task that runs process().
+ * 		Coefficients use the naming of CYD_Audio::IIR_calculateCoefficients():
+ * 		y = a0*x + a1*x1 + a2*x2 - b1*y1 - b2*y2
+ */
+class CYD_biquad : public CYD_dspStage
+{
+public:
+	CYD_biquad()
+	{
+		for (uint8_t i = 0; i < CYD_BIQUAD_STAGES; i++) enabled[i] = false;
+		activeCount = 0;
+		reset();
+	};
+	~CYD_biquad(){};
+
+	const char *name() { return "eq"; }
+	bool active() { return activeCount != 0; }
+	void setStage(uint8_t stage, float a0, float a1, float a2, float b1, float b2, float gain = 1.0f);
+	void bypassStage(uint8_t stage);
+	void reset() { memset(state, 0, sizeof(state)); }
+	void process(int32_t *buf, uint16_t sz);
 private:
-	const uint16_t block_smpcount; 
-	int32_t bias = 0;
-	uint32_t count = 0;
-	uint16_t count_cmp = block_smpcount;
-	int64_t accL = 0, accR = 0;
-	uint32_t lastResultR = 0;
-	uint32_t lastResultL = 0;
+	typedef struct { int32_t a0, a1, a2, b1, b2; } coef_t;
+	typedef struct { int32_t x1, x2, y1, y2, err; } state_t;
 
-	float rmsL_last;
-	float rmsR_last;
+	coef_t coef[CYD_BIQUAD_STAGES];
+	state_t state[CYD_BIQUAD_STAGES][2];
+	bool enabled[CYD_BIQUAD_STAGES];
+	uint8_t active_idx[CYD_BIQUAD_STAGES];	// enabled stages in cascade order
+	uint8_t activeCount;
+	int32_t work[2][CYD_DSP_BLOCK];			// one channel per row, with guard bits
 
-	float attack;
-	float decay;
+	void updateActive();
+	static void run(int32_t *x, uint16_t n, const coef_t &c, state_t &s);
+};
 
-	bool ready = false;
+// -----------------------------------------------------------
+/**
+ * @brief Gain in front of or behind other stages, ramped over one block on change
+ */
+class CYD_gain : public CYD_dspStage
+{
+public:
+	const char *name() { return "gain"; }
+	void setGain(float g) { target = lrintf(g * 65536.0f); }	// linear, 1.0 = unity
+	void process(int32_t *buf, uint16_t sz);
+private:
+	int32_t gain = 0x10000;					// Q16
+	volatile int32_t target = 0x10000;
+};
+
+// -----------------------------------------------------------
+#define CYD_LIMITER_THRESHOLD	31000	// default limit, about -0.5 dBFS
+#define CYD_LIMITER_RELEASE_MS	100		// default recovery time constant
+
+/**
+ * @brief Block peak limiter. The gain drops to the limit at the start of the block
+ * 		holding the peak (no overshoot) and recovers with the release constant,
+ * 		ramped over each block. Integer only on the audio path.
+ */
+class CYD_limiter : public CYD_dspStage
+{
+public:
+	CYD_limiter() { setRelease(CYD_LIMITER_RELEASE_MS); }
+	const char *name() { return "limiter"; }
+	void setThreshold(int16_t level) { threshold = level; }
+	void setRelease(uint16_t ms)
+	{
+		release_ms = ms;
+		releaseCoef = ms ? (uint32_t)((1.0f - expf(-(float)CYD_DSP_BLOCK * 1000.0f / ((float)sampleRate * ms))) * 65536.0f) : 0x10000;
+	}
+	void setSampleRate(uint32_t rate)
+	{
+		if (!rate || rate == sampleRate) return;
+		sampleRate = rate;
+		setRelease(release_ms);
+	}
+	void reset() { gain = 0x10000; }
+	uint32_t getGain() { return gain; }		// current gain, Q16
+	void process(int32_t *buf, uint16_t sz);
+private:
+	int32_t threshold = CYD_LIMITER_THRESHOLD;
+	uint32_t sampleRate = 44100;
+	uint16_t release_ms;
+	uint32_t releaseCoef;					// Q16 step per block back to unity
+	uint32_t gain = 0x10000;				// Q16
+};
+
+// -----------------------------------------------------------
+#define CYD_MIX_SOURCES		4		// sources a mixer can hold
+
+/**
+ * @brief Audio source summed into the output by CYD_mixer. Adds itself into the
+ * 		block in place (see mix_16b_16b()), no copy of the block is made.
+ */
+class CYD_mixSource
+{
+public:
+	virtual ~CYD_mixSource(){};
+	virtual void mix(int32_t *buf, uint16_t sz) = 0;
+};
+
+/**
+ * @brief Sums the registered sources into the block
+ */
+class CYD_mixer : public CYD_dspStage
+{
+public:
+	const char *name() { return "mixer"; }
+	bool addSource(CYD_mixSource *src);
+	bool removeSource(CYD_mixSource *src);
+	void process(int32_t *buf, uint16_t sz)
+	{
+		for (uint8_t i = 0; i < count; i++) sources[i]->mix(buf, sz);
+	}
+private:
+	CYD_mixSource *sources[CYD_MIX_SOURCES];
+	uint8_t count = 0;
+};
+
+// -----------------------------------------------------------
+#define CYD_VOICES			4		// voices sounding at the same time
+#define CYD_VOICE_MAX_STEP	(4UL << 16)	// up to 4x the output rate (speed * source rate)
+
+/**
+ * @brief One shot player of 16 bit PCM held in memory, at any rate
+ * 		A Q16 fraction steps through the frames by source rate * speed / output rate
+ * 		per output sample, samples in between are interpolated linearly. The data
+ * 		must stay valid until the voice stops.
+ */
+class CYD_voice
+{
+public:
+	void play(const int16_t *pcm, uint32_t frames, uint8_t channels, uint32_t step, uint16_t gain);
+	void stop() { data = nullptr; }
+	bool active() { return data != nullptr; }
+	const int16_t *source() { return data; }
+	void mix(int32_t *buf, uint16_t sz);	// adds to the block, stops at the last frame
+private:
+	const int16_t *data = nullptr;
+	uint32_t frames;
+	uint32_t idx;							// current frame
+	uint32_t frac;							// Q16 position between idx and idx + 1
+	uint32_t step;							// Q16.16 frames per output sample
+	uint16_t gain;							// Q15
+	uint8_t channels;
+};
+
+/**
+ * @brief Pool of voices, mixed as one mixer source. A trigger takes a free voice
+ * 		or the one started first.
+ */
+class CYD_voices : public CYD_mixSource
+{
+public:
+	int8_t play(const int16_t *pcm, uint32_t frames, uint8_t channels, uint32_t step, uint16_t gain);
+	void stop(int8_t v) { if (v >= 0 && v < CYD_VOICES) voice[v].stop(); }
+	void stopSource(const int16_t *pcm);	// every voice playing this data
+	void stopAll();
+	uint8_t active();
+	void mix(int32_t *buf, uint16_t sz)
+	{
+		for (uint8_t v = 0; v < CYD_VOICES; v++)
+			if (voice[v].active()) voice[v].mix(buf, sz);
+	}
+private:
+	CYD_voice voice[CYD_VOICES];
+	uint32_t started[CYD_VOICES] = {};		// trigger count when the voice was started
+	uint32_t triggers = 0;
+};
+
+// -----------------------------------------------------------
+/**
+ * @brief Stage calling a plain function, e.g. a weak user hook
+ */
+class CYD_hookStage : public CYD_dspStage
+{
+public:
+	CYD_hookStage(const char *stageName, void (*fn)(int32_t *buf, uint16_t sz)) : hookName(stageName), hook(fn) {}
+	const char *name() { return hookName; }
+	void process(int32_t *buf, uint16_t sz) { if (hook) hook(buf, sz); }
+private:
+	const char *hookName;
+	void (*hook)(int32_t *buf, uint16_t sz);
+};
+
+// -----------------------------------------------------------
+#define CYD_RESAMPLER_TAPS		8		// polyphase FIR length
+#define CYD_RESAMPLER_PHASES	32		// sub-sample positions of the FIR table
+#define CYD_RESAMPLER_SUB_BITS	11		// 16 bit fraction = 5 bit phase + 11 bit interpolation
+#define CYD_RESAMPLER_FIFO		256		// input words held, enough for a block at 3.5x the output rate
+#define CYD_RESAMPLER_MAX_STEP	(7UL << 15)	// 3.5 input samples per output sample
+
+/**
+ * @brief Streaming sample rate converter from a source rate to the fixed output rate
+ * 		data format i16_L i16_R, no DC bias
+ * 
+ * 		Input words are written straight into the FIFO (writeBuffer() + commit()),
+ * 		read() produces output words while enough input is held, the remainder
+ * 		stays for the next call. A Q16.16 phase accumulator steps through the input,
+ * 		the sample between two inputs comes from an 8 tap polyphase FIR (windowed
+ * 		sinc, band limited to the lower of both Nyquist frequencies) or from linear
+ * 		interpolation. The FIR coefficients are interpolated between
+ * 		neighbouring phases. Integer only on the audio path, the FIR table is calculated
+ * 		by setRates().
+ * 		Stays in front of the pipeline: a rate change can not be done in place.
+ */
+class CYD_resampler
+{
+public:
+	CYD_resampler() { reset(); }
+	void setRates(uint32_t inRate, uint32_t outRate, bool polyphase = true);
+	bool active() { return step != 0x10000; }	// false: rates match, bypass
+	void reset();
+	int32_t *writeBuffer(uint16_t *space)
+	{
+		*space = CYD_RESAMPLER_FIFO - count;
+		return &fifo[count];
+	}
+	void commit(uint16_t n) { count += n; }
+	uint16_t available();						// output words read() can produce now
+	uint16_t read(int32_t *out, uint16_t n);
+	static uint32_t benchmark(uint32_t inRate, uint32_t outRate, bool polyphase, uint16_t outSamples);
+private:
+	static const uint16_t history = CYD_RESAMPLER_TAPS / 2 - 1;	// inputs needed before the position
+	int32_t fifo[CYD_RESAMPLER_FIFO];
+	uint16_t count;								// words in the fifo
+	uint32_t pos;								// Q16.16 read position in the fifo
+	uint32_t step = 0x10000;					// Q16.16 input samples per output sample
+	bool fir = true;
+	int16_t coef[CYD_RESAMPLER_PHASES + 1][CYD_RESAMPLER_TAPS];	// Q15, each phase sums to 1.0, last = first shifted by one input
+};
+
+// -----------------------------------------------------------
+/**
+ * @brief Ordered list of output stages, each one processes the same block in place
+ * 		and its cycles are accounted per stage.
+ * 		Stages are inserted and removed while the output is idle or from the task
+ * 		that runs process(), the pipeline does not lock.
+ */
+class CYD_pipeline
+{
+public:
+	bool insert(CYD_dspStage *stage, uint8_t pos = CYD_DSP_STAGES);	// default: append
+	bool remove(CYD_dspStage *stage);
+	void process(int32_t *buf, uint16_t sz);
+	void reset();
+	void setSampleRate(uint32_t rate);
+	uint8_t count() { return stageCount; }
+	CYD_dspStage *stage(uint8_t i) { return (i < stageCount) ? stages[i] : nullptr; }
+private:
+	CYD_dspStage *stages[CYD_DSP_STAGES];
+	uint8_t stageCount = 0;
 };
 
 #endif // _CYD_DSP_H_
@@ -1,7 +1,12 @@
 #include "CYD_Audio.h"
+#ifndef SDFATFS_USED
+#include <FSImpl.h>
+#endif
 
 // Custom funtions, some of them replace original library ones.
 
+static_assert(CYDAUDIO_DAC_BUF_SIZE <= CYD_DSP_BLOCK, "output blocks must fit the DSP stages");
+
 const uint16_t fader_wave[65] = {
 0x0000, 0x0196, 0x033e, 0x04f9, 0x06c6, 0x08a5, 0x0a96, 0x0c97, 0x0ea9, 0x10ca, 0x12fc, 0x153a, 0x1788, 0x19e4, 0x1c4b, 0x1ebe, 
 0x213c, 0x23c4, 0x2656, 0x28f0, 0x2b90, 0x2e38, 0x30e5, 0x3396, 0x364b, 0x3902, 0x3bbb, 0x3e74, 0x412c, 0x43e2, 0x4695, 0x4944, 
@@ -80,9 +85,9 @@ bool CYD_Audio::playSampleCYD(int32_t *sampleBuf, uint16_t sz)
 /**
  * @brief prepare a block of data for the DAC depending on:
  * 			- bit depth, number of channels
- * 			- current play status (generate fade in)
- * 			- add bias in case of internal DAC use
+ * 			- current play status (generate fade in, ramp the internal DAC bias)
  * 			- current volume setting
+ * 		The block is written without the DAC bias, processBlock() adds it.
  * 
  * @param cfg combined configuration word (bit depth, channels, formced mono)
  * @param outBfPtr pointer to output buffer (int16int16)
@@ -170,15 +175,15 @@ int32_t CYD_Audio::prepareDACdata(data_cfg_t cfg, int32_t *outBfPtr, uint16_t sz
 				break;
 		}
 		// Apply volume
-		l = ((l * gainL) >> 16) + m_dacBias;
-		r = ((r * gainR) >> 16) + m_dacBias;		
+		l = (l * gainL) >> 16;
+		r = (r * gainR) >> 16;
 		*outBfPtr++ = ((l << 16) | (r & 0xffff));
 		wordsWritten++;
 		sz--;
 		if (doubleFeed)	// 8bit 1ch audio word has 2 samples
 		{
-			l2 = ((l2 * gainL) >> 16) + m_dacBias;
-			r2 = ((r2 * gainR) >> 16) + m_dacBias;
+			l2 = (l2 * gainL) >> 16;
+			r2 = (r2 * gainR) >> 16;
 			*outBfPtr++ = ((l2 << 16) | (r2 & 0xffff));			
 			if (sz) 
 			{
@@ -194,11 +199,139 @@ int32_t CYD_Audio::prepareDACdata(data_cfg_t cfg, int32_t *outBfPtr, uint16_t sz
 	return (wordsWritten);
 }
 
+/**
+ * @brief Set the low cut (2nd order Butterworth high pass) for small speakers
+ * 
+ * @param hz corner frequency, 0 = off
+ */
+void CYD_Audio::setLowCut(uint16_t hz)
+{
+	m_lowCutHz = hz;
+	updateEQ();
+}
+
+/**
+ * @brief Load the block EQ from the low cut and the tone filter coefficients of
+ * 		IIR_calculateCoefficients(). Flat tone filters are bypassed, headroom for a
+ * 		boost (m_corr) is folded into the first enabled stage.
+ * 		Called on every tone or sample rate change, the new coefficients take
+ * 		effect with the next block.
+ */
+void CYD_Audio::updateEQ()
+{
+	uint32_t rate = getOutputRate();
+	if (rate < 1000) return;	// same fuse as IIR_calculateCoefficients()
+	float gain = (m_corr > 1) ? 1.0f / m_corr : 1.0f;
+	if (m_lowCutHz && m_lowCutHz < rate / 2)
+	{
+		const float Q = 0.7071f;
+		float K = tanf((float)PI * m_lowCutHz / rate);
+		float norm = 1 / (1 + K / Q + K * K);
+		m_eq.setStage(0, norm, -2 * norm, norm, 2 * (K * K - 1) * norm, (1 - K / Q + K * K) * norm, gain);
+		gain = 1.0f;
+	}
+	else m_eq.bypassStage(0);
+
+	const int8_t toneGain[3] = {m_gain0, m_gain1, m_gain2};
+	for (uint8_t i = 0; i < 3; i++)
+	{
+		if (toneGain[i])
+		{
+			m_eq.setStage(i + 1, m_filter[i].a0, m_filter[i].a1, m_filter[i].a2, m_filter[i].b1, m_filter[i].b2, gain);
+			gain = 1.0f;
+		}
+		else m_eq.bypassStage(i + 1);
+	}
+}
+
+/**
+ * @brief Time the block EQ against the per-sample IIR_filterChain0/1/2 over the
+ * 		same block of a 1 kHz test tone. Leaves the EQ and filter chain state cleared.
+ * 
+ * @param blockCycles cycles of m_eq.process() for CYDAUDIO_DAC_BUF_SIZE words
+ * @param chainCycles cycles of the per-sample chain for the same words
+ */
+void CYD_Audio::benchmarkEQ(uint32_t *blockCycles, uint32_t *chainCycles)
+{
+	int32_t buf[CYDAUDIO_DAC_BUF_SIZE];
+	for (uint16_t i = 0; i < CYDAUDIO_DAC_BUF_SIZE; i++)
+	{
+		int16_t v = 16000 * sinf(2 * (float)PI * 1000 * i / 44100);
+		buf[i] = pack_16b_16b(v, v);
+	}
+	uint32_t t0 = ESP.getCycleCount();
+	m_eq.process(buf, CYDAUDIO_DAC_BUF_SIZE);
+	*blockCycles = ESP.getCycleCount() - t0;
+
+	int16_t sample[2];
+	t0 = ESP.getCycleCount();
+	for (uint16_t i = 0; i < CYDAUDIO_DAC_BUF_SIZE; i++)
+	{
+		sample[LEFTCHANNEL] = buf[i] >> 16;
+		sample[RIGHTCHANNEL] = buf[i] & 0xFFFF;
+		int16_t *out = IIR_filterChain0(sample);
+		out = IIR_filterChain1(out);
+		out = IIR_filterChain2(out);
+		buf[i] = pack_16b_16b(out[LEFTCHANNEL], out[RIGHTCHANNEL]);
+	}
+	*chainCycles = ESP.getCycleCount() - t0;
+
+	m_eq.reset();
+	sample[0] = sample[1] = 0;
+	IIR_filterChain0(sample, true);			// clears the state of all three
+}
+
+/**
+ * @brief The default output stages in processing order
+ */
+void CYD_Audio::initPipeline()
+{
+	m_mixer.addSource(&m_voices);
+	m_pipeline.insert(&m_mixer);			// other sources join before any processing
+	m_pipeline.insert(&m_eq);
+	m_pipeline.insert(&m_custom);
+	m_pipeline.insert(&m_limiter);			// catches EQ boosts and mixed sources
+	m_pipeline.insert(&rms);				// levels of what is played
+}
+
+/**
+ * @brief Output processing of one block: pipeline stages, then the internal DAC bias.
+ * 		The bias is ramped linearly from its value at the end of the previous block
+ * 		(m_blockBias) to m_dacBias, following the fade in curve without a step.
+ * 
+ * @param buf DAC words (int16 L | int16 R, no bias)
+ * @param sz number of words
+ */
+void CYD_Audio::processBlock(int32_t *buf, uint16_t sz)
+{
+	m_pipeline.process(buf, sz);
+	if (m_f_internalDAC) addDACbias(buf, sz);
+}
+
+/**
+ * @brief Add the internal DAC bias, ramped from m_blockBias to m_dacBias
+ */
+void CYD_Audio::addDACbias(int32_t *buf, uint16_t sz)
+{
+	uint32_t biasStart = m_blockBias;
+	m_blockBias = m_dacBias;
+	if (biasStart == 0x8000 && m_dacBias == 0x8000)
+	{
+		for (uint16_t i = 0; i < sz; i++) buf[i] ^= 0x80008000;	// + 0x8000 on both halves, no carry
+		return;
+	}
+	int32_t step = (((int32_t)m_dacBias - (int32_t)biasStart) << 8) / sz;
+	int32_t bias = biasStart << 8;
+	for (uint16_t i = 0; i < sz; i++)
+	{
+		bias += step;
+		buf[i] = pack_16b_16b((buf[i] >> 16) + (bias >> 8), (buf[i] & 0xFFFF) + (bias >> 8));
+	}
+}
+
 /**
  * @brief play chunk of data received from the input buffer, 
- * 			calculate rms amplitude
- * 		TODO: EQ maybe?
- * 		TODO: external processing callback
+ * 			apply EQ, calculate levels
  *   
  * @return true all avaialble words written
  * @return false could not write all words
@@ -208,6 +341,7 @@ bool CYD_Audio::playChunkCYD()
 	data_cfg_t dataCfg = (data_cfg_t)(	(getBitsPerSample() << 8) 	| 
 										(m_f_forceMono<<2) 			| 
 										(getChannels() & 0x03));
+	if (m_resampler.active()) return playResampledCYD(dataCfg);
 	uint16_t writtenSamples;										
 	while(m_validSamples)
 	{
@@ -216,8 +350,7 @@ bool CYD_Audio::playChunkCYD()
 			writtenSamples = prepareDACdata(dataCfg, dacBuf, CYDAUDIO_DAC_BUF_SIZE);
 			if (writtenSamples == CYDAUDIO_DAC_BUF_SIZE)
 			{
-				rms.process(dacBuf, CYDAUDIO_DAC_BUF_SIZE);// calculate level
-				// TODO: apply EQ
+				processBlock(dacBuf, CYDAUDIO_DAC_BUF_SIZE);	// pipeline, DAC bias
 				playSampleCYD(dacBuf, CYDAUDIO_DAC_BUF_SIZE);
 			}
 			else 
@@ -235,8 +368,7 @@ bool CYD_Audio::playChunkCYD()
 			writtenSamples = prepareDACdata(dataCfg, dacBuf, remainingSamples);
 			if (writtenSamples == remainingSamples)
 			{
-				rms.process(dacBuf, remainingSamples);	// calculate level
-				// TODO: apply EQ
+				processBlock(dacBuf, remainingSamples);	// pipeline, DAC bias
 				playSampleCYD(dacBuf, remainingSamples);
 			}
 			else
@@ -253,6 +385,218 @@ bool CYD_Audio::playChunkCYD()
 	return true;
 }
 
+/**
+ * @brief play chunk through the resampler: the decoded samples are prepared straight
+ * 		into its FIFO, every full output block goes through the pipeline to I2S.
+ * 		Input not yet used stays in the FIFO for the next chunk, the last partial
+ * 		block of a song (< 1.5 ms) is dropped by the reset at its end.
+ * 
+ * @param cfg data configuration of the source
+ * @return true all avaialble words written
+ * @return false could not write all words
+ */
+bool CYD_Audio::playResampledCYD(data_cfg_t cfg)
+{
+	while (m_validSamples)
+	{
+		uint16_t space;
+		int32_t *in = m_resampler.writeBuffer(&space);
+		if (space < 2) break;						// never, the FIFO is drained below
+		// one word spare: 8 bit mono writes two words per sample
+		uint16_t sz = min((uint16_t)(space - 1), (uint16_t)m_validSamples);
+		uint16_t writtenSamples = prepareDACdata(cfg, in, sz);
+		if (writtenSamples != sz)
+		{
+			log_e("I2S write error! sent=%d, wr=%d", sz, writtenSamples);
+			m_validSamples = 0;
+			m_curSample = 0;
+			stopSong();
+			return false;
+		}
+		m_resampler.commit(writtenSamples);
+		while (m_resampler.available() >= CYDAUDIO_DAC_BUF_SIZE)
+		{
+			m_resampler.read(dacBuf, CYDAUDIO_DAC_BUF_SIZE);
+			processBlock(dacBuf, CYDAUDIO_DAC_BUF_SIZE);	// pipeline, DAC bias
+			playSampleCYD(dacBuf, CYDAUDIO_DAC_BUF_SIZE);
+		}
+	}
+	m_curSample = 0;
+	return true;
+}
+
+/**
+ * @brief Start a sound effect from 16 bit PCM in memory. It is mixed into the
+ * 		stream if one plays, else loop() outputs it alone.
+ * 
+ * @param pcm interleaved samples, must stay valid until the voice ends or is stopped
+ * @param frames number of frames (samples per channel)
+ * @param channels 1 or 2
+ * @param rate sample rate of the data
+ * @param speed playback speed and pitch, 1.0 = native, up to 4x the output rate
+ * @param gain 1.0 = volume setting, up to 2.0
+ * @return int8_t voice number, -1 if the data can not be played
+ */
+int8_t CYD_Audio::playVoice(const int16_t *pcm, uint32_t frames, uint8_t channels, uint32_t rate, float speed, float gain)
+{
+	if (speed <= 0.0f || gain < 0.0f) return -1;
+	uint32_t step = (float)rate * speed * 65536.0f / getOutputRate();
+	uint16_t g = min(gain * gainL / 2.0f, 65535.0f);		// Q15, follows the volume setting
+	return m_voices.play(pcm, frames, channels, step, g);
+}
+
+/**
+ * @brief Output the voices alone while no stream plays, CYD_VOICE_IDLE_BLOCKS per call,
+ * 		the I2S write paces the task. The internal DAC bias is ramped up before
+ * 		the voices are heard and down again after the last one ended.
+ */
+void CYD_Audio::playVoicesCYD()
+{
+	for (uint8_t n = 0; n < CYD_VOICE_IDLE_BLOCKS; n++)
+	{
+		bool sounding = m_voices.active();
+		fillDACbuf(0);
+		if (m_f_internalDAC)
+		{
+			uint32_t target = sounding ? 0x8000 : 0;
+			if (m_dacBias != target || m_blockBias != target)
+			{
+				if (m_dacBias < target) m_dacBias = min(m_dacBias + CYD_VOICE_BIAS_STEP, target);
+				else m_dacBias = (m_dacBias > CYD_VOICE_BIAS_STEP) ? m_dacBias - CYD_VOICE_BIAS_STEP : 0;
+				addDACbias(dacBuf, CYDAUDIO_DAC_BUF_SIZE);	// ramp only, the voices wait
+				playSampleCYD(dacBuf, CYDAUDIO_DAC_BUF_SIZE);
+				continue;
+			}
+		}
+		if (!sounding) return;
+		processBlock(dacBuf, CYDAUDIO_DAC_BUF_SIZE);
+		playSampleCYD(dacBuf, CYDAUDIO_DAC_BUF_SIZE);
+	}
+}
+
+/**
+ * @brief Loop the next local file sample-exact. While the file plays once, the decoded
+ * 		frames of the window are copied to RAM. From the end of the window on they are
+ * 		repeated from there: the decoder and the file are closed, the wrap joins the last
+ * 		and the first frame of the window without a decoder restart.
+ * 
+ * @param startFrame first frame of the window, at the sample rate of the file
+ * @param endFrame frame after the window, 0 = end of file
+ * @return false invalid window
+ */
+bool CYD_Audio::setLoopPoints(uint32_t startFrame, uint32_t endFrame)
+{
+	if (endFrame && endFrame <= startFrame) return false;
+	m_loopStart = startFrame;
+	m_loopEnd = endFrame ? endFrame : UINT32_MAX;
+	m_f_loopArmed = true;
+	return true;
+}
+
+/**
+ * @brief Copy the frames of the decoded chunk that lie in the loop window, frames
+ * 		behind the window are cut from the chunk. A window over CYD_LOOP_MAX_BYTES or
+ * 		8 bit data fall back to looping the whole file through the decoder.
+ */
+void CYD_Audio::captureLoop()
+{
+	if (getBitsPerSample() != 16)	// 8 bit WAV data packs two samples per word
+	{
+		log_w("Loop points need 16 bit data, looping the whole file");
+		endLoop();
+		setFileLoop(true);
+		return;
+	}
+	uint8_t ch = getChannels();
+	uint32_t first = m_loopDecoded;
+	uint32_t last = first + m_validSamples;
+	m_loopDecoded = last;
+	if (last > m_loopEnd)
+	{
+		uint32_t end = max(first, m_loopEnd);
+		m_validSamples -= last - end;
+		last = end;
+	}
+	if (last <= m_loopStart) return;
+	uint32_t from = max(first, m_loopStart);
+	uint32_t need = (m_loopFrames + last - from) * ch * sizeof(int16_t);
+	if (need > m_loopBytes)
+	{
+		uint32_t size = need;
+		if (m_loopEnd != UINT32_MAX) size = (m_loopEnd - m_loopStart) * ch * sizeof(int16_t);
+		else size = min(max(need, m_loopBytes + CYD_LOOP_GROW_BYTES), (uint32_t)CYD_LOOP_MAX_BYTES);
+		int16_t *buf = nullptr;
+		if (need <= size && size <= CYD_LOOP_MAX_BYTES) buf = (int16_t *)realloc(m_loopBuf, size);
+		if (!buf)
+		{
+			log_w("Loop window does not fit (%u bytes), looping the whole file", need);
+			endLoop();
+			setFileLoop(true);
+			return;
+		}
+		m_loopBuf = buf;
+		m_loopBytes = size;
+	}
+	memcpy(m_loopBuf + m_loopFrames * ch, m_outBuff + (from - first) * ch, (last - from) * ch * sizeof(int16_t));
+	m_loopFrames += last - from;
+}
+
+/**
+ * @brief Replay the loop window, CYD_LOOP_CHUNK_FRAMES per call. The chunk path reads
+ * 		m_outBuff, it is pointed into the window, so fader, resampler and pipeline run
+ * 		on across the wrap.
+ */
+void CYD_Audio::playLoopCYD()
+{
+	if (audiofile)	// window complete, the file and the decoder are not needed any more
+	{
+		audiofile.close();
+		freeDecoder(m_codec);
+		InBuff.resetBuffer();
+		log_i("Loop of %u frames from frame %u, repeated from RAM", m_loopFrames, m_loopStart);
+	}
+	uint16_t n = min(m_loopFrames - m_loopPos, (uint32_t)CYD_LOOP_CHUNK_FRAMES);
+	int16_t *outBuff = m_outBuff;
+	m_outBuff = m_loopBuf + m_loopPos * getChannels();
+	m_validSamples = n;
+	m_curSample = 0;
+	playChunkCYD();
+	m_outBuff = outBuff;
+	m_loopPos += n;
+	if (m_loopPos >= m_loopFrames) m_loopPos = 0;
+}
+
+/**
+ * @brief Free the loop window, the next file plays once unless new loop points are set
+ */
+void CYD_Audio::endLoop()
+{
+	free(m_loopBuf);
+	m_loopBuf = nullptr;
+	m_loopBytes = 0;
+	m_loopDecoded = 0;
+	m_loopFrames = 0;
+	m_loopPos = 0;
+	m_f_loopWindow = false;
+	m_f_loopPlay = false;
+}
+
+/**
+ * @brief Fix the I2S sample rate. Sources at other rates are converted by the
+ * 		resampler, the EQ and the pipeline stages run at the output rate.
+ * 
+ * @param hz output rate, 0 = I2S follows the sample rate of each source
+ * @param polyphase true: 8 tap polyphase FIR, false: linear interpolation
+ */
+void CYD_Audio::setOutputRate(uint32_t hz, bool polyphase)
+{
+	m_outputRate = hz;
+	m_polyphase = polyphase;
+	if (hz) i2s_set_sample_rates((i2s_port_t)m_i2s_num, hz);
+	m_resampler.reset();
+	setSampleRate(m_sampleRate);
+}
+
 /**
  * @brief generates bias fade out curve for clickless end of sample
  * 			applies only when internal DAC is used (zero at 0x80)
@@ -287,6 +631,7 @@ void CYD_Audio::genFadeOut(void)
 	m_fader = 0x00;
 	m_play_status = FADE_IN;
 	m_dacBias = 0;
+	m_blockBias = 0;
 	// let I2S send the data and flush the TX buffers
 	// too short time will result with a "click"
 	delay(400);
@@ -323,3 +668,87 @@ uint16_t CYD_Audio::volumeDown(void)		// volume step down
 	return m_vol;
 }
 
+#ifndef SDFATFS_USED
+/**
+ * @brief Read only fs::File backend for a byte array, lets the local file
+ * 		player (processLocalFile) read memory mapped data without any changes.
+ */
+class MemFileImpl : public fs::FileImpl
+{
+public:
+	MemFileImpl(const uint8_t *data, size_t length, const char *path) : _data(data), _size(length)
+	{
+		strlcpy(_path, path, sizeof(_path));
+		const char *slash = strrchr(_path, '/');
+		_name = slash ? slash + 1 : _path;
+	}
+	size_t write(const uint8_t *buf, size_t size) { return 0; }
+	size_t read(uint8_t *buf, size_t size)
+	{
+		if (!_data) return 0;
+		if (size > _size - _pos) size = _size - _pos;
+		memcpy(buf, _data + _pos, size);
+		_pos += size;
+		return size;
+	}
+	void flush() {}
+	bool seek(uint32_t pos, fs::SeekMode mode)
+	{
+		size_t newPos;
+		switch (mode)
+		{
+			case fs::SeekCur: newPos = _pos + pos;	break;
+			case fs::SeekEnd: newPos = _size + pos;	break;
+			default:		  newPos = pos; 		break;
+		}
+		if (newPos > _size) return false;
+		_pos = newPos;
+		return true;
+	}
+	size_t position() const { return _pos; }
+	size_t size() const { return _size; }
+	bool setBufferSize(size_t size) { return false; }
+	void close() { _data = nullptr; }
+	time_t getLastWrite() { return 0; }
+	const char *path() const { return _path; }
+	const char *name() const { return _name; }
+	boolean isDirectory(void) { return false; }
+	fs::FileImplPtr openNextFile(const char *mode) { return fs::FileImplPtr(); }
+	boolean seekDir(long position) { return false; }
+	String getNextFileName(void) { return String(); }
+	String getNextFileName(bool *isDir) { return String(); }
+	void rewindDirectory(void) {}
+	operator bool() { return _data != nullptr; }
+
+private:
+	const uint8_t *_data;
+	size_t _size;
+	size_t _pos = 0;
+	char _path[256];
+	const char *_name;
+};
+
+/**
+ * @brief Play an encoded audio file stored in a byte array, ie. a clip memory
+ * 		mapped from a flash partition. Decoding runs exactly as for SD files.
+ * 
+ * @param dataBuf pointer to the file data, must stay valid until the playback stops
+ * @param length file size in bytes
+ * @param name file name, the extension selects the codec
+ * @param resumeFilePos optional start position
+ * @return true decoder initialized, playback running
+ */
+bool CYD_Audio::connecttoFLASH(const uint8_t* dataBuf, const uint32_t length, const char* name, int32_t resumeFilePos)
+{
+	if (!dataBuf || !length || !name || strlen(name) > 255) return false;
+
+	xSemaphoreTakeRecursive(mutex_audio, portMAX_DELAY);
+	m_resumeFilePos = resumeFilePos;
+	setDefaults(); // free buffers an set defaults
+	log_i("Reading flash file: \"%s\", %u bytes", name, length);
+	audiofile = File(std::make_shared<MemFileImpl>(dataBuf, length, name));
+	bool ret = startLocalFile();
+	xSemaphoreGiveRecursive(mutex_audio);
+	return ret;
+}
+#endif // SDFATFS_USED
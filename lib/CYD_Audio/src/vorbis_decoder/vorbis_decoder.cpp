@@ -95,25 +95,30 @@ void VORBISDecoder_FreeBuffers(){
             mapping_clear_info(s_map_param + i);
         s_nrOfMaps = 0;
     }
+    if(s_map_param) {free(s_map_param); s_map_param = NULL;}
 
     if(s_nrOfFloors) {
         for(int i = 0; i < s_nrOfFloors; i++) /* unpack does the range checking */
             floor_free_info(s_floor_param[i]);
-        free(s_floor_param);
         s_nrOfFloors = 0;
     }
+    if(s_floor_param) {free(s_floor_param); s_floor_param = NULL;}
+    if(s_floor_type) {free(s_floor_type); s_floor_type = NULL;}
 
     if(s_nrOfResidues) {
         for(int i = 0; i < s_nrOfResidues; i++) /* unpack does the range checking */
             res_clear_info(s_residue_param + i);
         s_nrOfResidues = 0;
     }
+    if(s_residue_param) {free(s_residue_param); s_residue_param = NULL;}
 
     if(s_nrOfCodebooks) {
         for(int i = 0; i < s_nrOfCodebooks; i++)
-            vorbis_book_clear(s_codebooks);
+            vorbis_book_clear(s_codebooks + i);
         s_nrOfCodebooks = 0;
     }
+    if(s_codebooks) {free(s_codebooks); s_codebooks = NULL;}
+    if(s_mode_param) {free(s_mode_param); s_mode_param = NULL;}
 
     if(s_dsp_state){vorbis_dsp_destroy(s_dsp_state); s_dsp_state = NULL;}
 }
@@ -822,7 +827,7 @@ int vorbis_book_unpack(codebook_t *s) {
                         goto _errout;
                     }
 
-                    s->q_val = 0; /* about to go out of scope; _make_decode_table was using it */
+                    free(s->q_val); s->q_val = NULL; /* _make_decode_table was using it, it is not needed any more */
                 }
                 else {
                     /* use dec_type 2: packed vector of column offsets */
@@ -1614,6 +1619,7 @@ vorbis_dsp_state_t *vorbis_dsp_create() {
     v->work = (int32_t **)__malloc_heap_psram(s_vorbisChannels * sizeof(*v->work));
     v->mdctright = (int32_t **)__malloc_heap_psram(s_vorbisChannels* sizeof(*v->mdctright));
 
+    v->channels = s_vorbisChannels;
     for(i = 0; i < s_vorbisChannels; i++) {
         v->work[i] = (int32_t *)__calloc_heap_psram(1, (s_blocksizes[1] >> 1) * sizeof(*v->work[i]));
         v->mdctright[i] = (int32_t *)__calloc_heap_psram(1, (s_blocksizes[1] >> 2) * sizeof(*v->mdctright[i]));
@@ -1632,13 +1638,13 @@ void vorbis_dsp_destroy(vorbis_dsp_state_t *v) {
     int i;
     if(v) {
         if(v->work) {
-            for(i = 0; i < s_vorbisChannels; i++) {
+            for(i = 0; i < v->channels; i++) {
                 if(v->work[i]) {free(v->work[i]); v->work[i] = NULL;}
             }
             if(v->work){free(v->work); v->work = NULL;}
         }
         if(v->mdctright) {
-            for(i = 0; i < s_vorbisChannels; i++) {
+            for(i = 0; i < v->channels; i++) {
                 if(v->mdctright[i]){free(v->mdctright[i]); v->mdctright[i] = NULL;}
             }
             if(v->mdctright){free(v->mdctright); v->mdctright = NULL;}
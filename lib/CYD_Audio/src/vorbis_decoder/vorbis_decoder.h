@@ -141,6 +141,7 @@ typedef struct _vorbis_dsp_state{  // vorbis_dsp_state buffers the current vorbi
     int              out_end;
     int32_t          lW;        // last window
     uint32_t         W;         // Window
+    uint8_t          channels;  // work buffers, s_vorbisChannels is reset at the last page
 } vorbis_dsp_state_t;
 
 typedef struct _bitreader{
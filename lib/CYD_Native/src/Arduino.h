@@ -0,0 +1,163 @@
+#ifndef _CYD_NATIVE_ARDUINO_H_
+#define _CYD_NATIVE_ARDUINO_H_
+
+/**
+ * @brief Host shim of the ESP32 Arduino core, just what CYD_Audio, its decoders and the
+ * 		CYD28 audio task use. Time is the host clock, FreeRTOS objects are threads, the
+ * 		heap is malloc() and there is no PSRAM unless CYD_NATIVE_PSRAM_KB asks for it.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <type_traits>
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp32-hal-log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "WString.h"
+
+using std::min;
+using std::max;
+
+// size_t is 64 bit on the host, 32 bit like uint32_t on the target: mixed calls must still compile
+template <typename T, typename U>
+inline typename std::common_type<T, U>::type min(const T &a, const U &b) { return b < a ? b : a; }
+template <typename T, typename U>
+inline typename std::common_type<T, U>::type max(const T &a, const U &b) { return a < b ? b : a; }
+
+typedef bool boolean;
+typedef uint8_t byte;
+typedef uint16_t word;
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+
+#define PROGMEM
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_dword(addr) (*(const uint32_t *)(addr))
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define lowByte(w) ((uint8_t)((w) & 0xff))
+#define highByte(w) ((uint8_t)((w) >> 8))
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+inline void pinMode(uint8_t pin, uint8_t mode) {}
+inline void digitalWrite(uint8_t pin, uint8_t val) {}
+inline int digitalRead(uint8_t pin) { return LOW; }
+#define digitalPinToInterrupt(pin) ((int)(pin))
+inline void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {}	// no pin ever changes
+inline void detachInterrupt(uint8_t pin) {}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+	return inMax == inMin ? outMin : (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+
+inline float pow10f(float x) { return powf(10.0f, x); }	// gone from newer C libraries
+
+inline int toLowerCase(int c) { return tolower(c); }
+inline int toUpperCase(int c) { return toupper(c); }
+inline bool isAlphaNumeric(int c) { return isalnum(c); }
+inline bool isDigit(int c) { return isdigit(c); }
+inline bool isSpace(int c) { return isspace(c); }
+
+#if !defined(__GLIBC__) || (__GLIBC__ == 2 && __GLIBC_MINOR__ < 38)	// newer C libraries have them
+#define CYD_NATIVE_STRLCPY 1
+size_t strlcpy(char *dst, const char *src, size_t size);
+size_t strlcat(char *dst, const char *src, size_t size);
+#endif
+
+uint32_t psramBytes();
+bool psramInit();
+bool psramFound();
+void *ps_malloc(size_t size);
+void *ps_calloc(size_t n, size_t size);
+void *ps_realloc(void *ptr, size_t size);
+
+/**
+ * @brief Serial port on stdout
+ */
+class HardwareSerial
+{
+public:
+	void begin(unsigned long baud) {}
+	void end() {}
+	int available() { return 0; }
+	int read() { return -1; }
+	void flush() { fflush(stdout); }
+	size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+	size_t write(const uint8_t *buf, size_t size) { return fwrite(buf, 1, size, stdout); }
+	size_t print(const String &s) { return fputs(s.c_str(), stdout) < 0 ? 0 : s.length(); }
+	size_t print(const char *s) { return fputs(s, stdout) < 0 ? 0 : strlen(s); }
+	size_t print(char c) { return write(c); }
+	size_t print(long n, int base = 10) { return print(String(n, base)); }
+	size_t print(unsigned long n, int base = 10) { return print(String(n, base)); }
+	size_t print(int n, int base = 10) { return print((long)n, base); }
+	size_t print(unsigned int n, int base = 10) { return print((unsigned long)n, base); }
+	size_t print(double n, int digits = 2) { return print(String(n, digits)); }
+	size_t println() { return print("\n"); }
+	template <typename T> size_t println(const T &v) { size_t n = print(v); return n + println(); }
+	template <typename T> size_t println(const T &v, int format) { size_t n = print(v, format); return n + println(); }
+	size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+	operator bool() { return true; }
+};
+extern HardwareSerial Serial;
+
+/**
+ * @brief Chip information, cycle counts are host time scaled to a 240 MHz core
+ */
+class EspClass
+{
+public:
+	uint32_t getCycleCount();
+	uint32_t getCpuFreqMHz() { return 240; }
+	uint32_t getFreeHeap();	// heap size less what malloc() has handed out
+	uint32_t getHeapSize() { return 320 * 1024 + psramBytes(); }	// one heap on the host
+	uint32_t getMinFreeHeap() { return 320 * 1024; }
+	uint32_t getMaxAllocHeap() { return 110 * 1024; }
+	uint32_t getPsramSize() { return psramBytes(); }
+	uint32_t getFreePsram() { return psramBytes(); }
+	void restart() { exit(0); }
+};
+extern EspClass ESP;
+
+#endif // _CYD_NATIVE_ARDUINO_H_
@@ -0,0 +1,29 @@
+#ifndef _CYD_NATIVE_FFAT_H_
+#define _CYD_NATIVE_FFAT_H_
+
+#include "FS.h"
+
+namespace fs
+{
+
+/**
+ * @brief FAT partition in flash on a host directory: $CYD_FFAT_ROOT, else the working directory
+ */
+class F_Fat : public NativeFS
+{
+public:
+	F_Fat() : NativeFS("CYD_FFAT_ROOT") {}
+	bool begin(bool formatOnFail = false, const char *basePath = "/ffat", uint8_t maxOpenFiles = 10,
+			   const char *partitionLabel = "ffat")
+	{
+		return NativeFS::begin();
+	}
+	bool format(bool full_wipe = false, char *partitionLabel = nullptr) { return false; }
+	size_t freeBytes() { return totalBytes() - usedBytes(); }
+};
+
+} // namespace fs
+
+extern fs::F_Fat FFat;
+
+#endif // _CYD_NATIVE_FFAT_H_
@@ -0,0 +1,142 @@
+#ifndef _CYD_NATIVE_FS_H_
+#define _CYD_NATIVE_FS_H_
+
+#include <Arduino.h>
+#include <memory>
+
+/**
+ * @brief fs::FS and fs::File of the ESP32 core. NativeFS serves them from a directory
+ * 		of the host, it stands in for the SD card, SD_MMC and FFat.
+ */
+
+namespace fs
+{
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+enum SeekMode
+{
+	SeekSet = 0,
+	SeekCur = 1,
+	SeekEnd = 2
+};
+
+} // namespace fs
+
+#include "FSImpl.h"
+
+namespace fs
+{
+
+class File
+{
+public:
+	File(FileImplPtr p = FileImplPtr()) : _p(p) {}
+
+	size_t write(uint8_t c) { return write(&c, 1); }
+	size_t write(const uint8_t *buf, size_t size) { return _p ? _p->write(buf, size) : 0; }
+	size_t print(const String &s) { return write((const uint8_t *)s.c_str(), s.length()); }
+	size_t println(const String &s) { return print(s + "\n"); }
+	int available() { return _p ? (int)(_p->size() - _p->position()) : 0; }
+	int read()
+	{
+		uint8_t c;
+		return read(&c, 1) == 1 ? c : -1;
+	}
+	int peek()
+	{
+		if (!_p) return -1;
+		size_t pos = _p->position();
+		int c = read();
+		_p->seek(pos, SeekSet);
+		return c;
+	}
+	size_t read(uint8_t *buf, size_t size) { return _p ? _p->read(buf, size) : 0; }
+	size_t readBytes(char *buffer, size_t length) { return read((uint8_t *)buffer, length); }
+	String readStringUntil(char terminator)
+	{
+		String ret;
+		int c;
+		while ((c = read()) >= 0 && c != terminator) ret += (char)c;
+		return ret;
+	}
+	String readString() { return readStringUntil(0); }
+	void flush() { if (_p) _p->flush(); }
+	bool seek(uint32_t pos, SeekMode mode) { return _p ? _p->seek(pos, mode) : false; }
+	bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+	size_t position() const { return _p ? _p->position() : 0; }
+	size_t size() const { return _p ? _p->size() : 0; }
+	bool setBufferSize(size_t size) { return _p ? _p->setBufferSize(size) : false; }
+	void close()
+	{
+		if (_p)
+		{
+			_p->close();
+			_p = nullptr;
+		}
+	}
+	operator bool() const { return _p && *_p; }
+	time_t getLastWrite() { return _p ? _p->getLastWrite() : 0; }
+	const char *path() const { return _p ? _p->path() : nullptr; }
+	const char *name() const { return _p ? _p->name() : nullptr; }
+	boolean isDirectory(void) { return _p ? _p->isDirectory() : false; }
+	boolean seekDir(long position) { return _p ? _p->seekDir(position) : false; }
+	File openNextFile(const char *mode = FILE_READ) { return _p ? File(_p->openNextFile(mode)) : File(); }
+	String getNextFileName(void) { return _p ? _p->getNextFileName() : String(); }
+	String getNextFileName(boolean *isDir) { return _p ? _p->getNextFileName(isDir) : String(); }
+	void rewindDirectory(void) { if (_p) _p->rewindDirectory(); }
+
+protected:
+	FileImplPtr _p;
+};
+
+class FS
+{
+public:
+	FS(FSImplPtr impl) : _impl(impl) {}
+
+	File open(const char *path, const char *mode = FILE_READ, const bool create = false);
+	File open(const String &path, const char *mode = FILE_READ, const bool create = false) { return open(path.c_str(), mode, create); }
+	bool exists(const char *path);
+	bool exists(const String &path) { return exists(path.c_str()); }
+	bool remove(const char *path);
+	bool remove(const String &path) { return remove(path.c_str()); }
+	bool rename(const char *pathFrom, const char *pathTo);
+	bool rename(const String &pathFrom, const String &pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+	bool mkdir(const char *path);
+	bool mkdir(const String &path) { return mkdir(path.c_str()); }
+	bool rmdir(const char *path);
+	bool rmdir(const String &path) { return rmdir(path.c_str()); }
+
+protected:
+	FSImplPtr _impl;
+};
+
+/**
+ * @brief Host directory backend, paths of the FS are relative to root
+ */
+class NativeFS : public FS
+{
+public:
+	NativeFS(const char *rootVariable);
+	bool begin(const char *root = nullptr);	// nullptr: $rootVariable, else the working directory
+	void end();
+	const char *root();
+	uint64_t totalBytes();
+	uint64_t usedBytes();
+};
+
+} // namespace fs
+
+#ifndef FS_NO_GLOBALS
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+#endif
+
+#endif // _CYD_NATIVE_FS_H_
@@ -0,0 +1,162 @@
+#include <Arduino.h>
+#include <WiFi.h>
+#include <soc/gpio_reg.h>
+#include <chrono>
+#include <thread>
+#include <stdarg.h>
+#include <malloc.h>
+
+HardwareSerial Serial;
+[[maybe_unused]] static const bool serialLines = setvbuf(stdout, nullptr, _IOLBF, 0) == 0;	// like a serial monitor, also through a pipe
+EspClass ESP;
+WiFiClass WiFi;
+volatile uint32_t cydNativeGpioRegs[6];
+
+static const auto bootTime = std::chrono::steady_clock::now();
+
+// ---------------------------------------------------------------
+static size_t heapInUse()
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+	struct mallinfo2 info = mallinfo2();
+	return info.uordblks + info.hblkhd;	// small blocks and mmap()ed large ones
+#else
+	return 0;
+#endif
+}
+static const size_t bootHeap = heapInUse();
+
+// ---------------------------------------------------------------
+static uint64_t nanosSinceBoot()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - bootTime).count();
+}
+// ---------------------------------------------------------------
+unsigned long millis()
+{
+	return nanosSinceBoot() / 1000000;
+}
+// ---------------------------------------------------------------
+unsigned long micros()
+{
+	return nanosSinceBoot() / 1000;
+}
+// ---------------------------------------------------------------
+void delay(uint32_t ms)
+{
+	std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+// ---------------------------------------------------------------
+void delayMicroseconds(uint32_t us)
+{
+	std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+// ---------------------------------------------------------------
+void yield()
+{
+	std::this_thread::yield();
+}
+// ---------------------------------------------------------------
+long random(long howbig)
+{
+	return howbig > 0 ? ::random() % howbig : 0;
+}
+// ---------------------------------------------------------------
+long random(long howsmall, long howbig)
+{
+	return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+// ---------------------------------------------------------------
+void randomSeed(unsigned long seed)
+{
+	if (seed) srandom(seed);
+}
+// ---------------------------------------------------------------
+#ifdef CYD_NATIVE_STRLCPY
+size_t strlcpy(char *dst, const char *src, size_t size)
+{
+	size_t len = strlen(src);
+	if (size)
+	{
+		size_t n = len < size - 1 ? len : size - 1;
+		memcpy(dst, src, n);
+		dst[n] = 0;
+	}
+	return len;
+}
+// ---------------------------------------------------------------
+size_t strlcat(char *dst, const char *src, size_t size)
+{
+	size_t len = strnlen(dst, size);
+	return len == size ? size + strlen(src) : len + strlcpy(dst + len, src, size - len);
+}
+#endif
+// ---------------------------------------------------------------
+/**
+ * @brief PSRAM size in bytes, CYD_NATIVE_PSRAM_KB of the environment at the first call.
+ * 		None by default like on the CYD, PSRAM allocations are served by malloc().
+ */
+uint32_t psramBytes()
+{
+	static const char *kb = getenv("CYD_NATIVE_PSRAM_KB");
+	static const uint32_t bytes = kb ? strtoul(kb, nullptr, 10) * 1024 : 0;
+	return bytes;
+}
+// ---------------------------------------------------------------
+bool psramInit()
+{
+	return psramBytes() > 0;
+}
+// ---------------------------------------------------------------
+bool psramFound()
+{
+	return psramBytes() > 0;
+}
+// ---------------------------------------------------------------
+void *ps_malloc(size_t size)
+{
+	return psramFound() ? malloc(size) : nullptr;
+}
+// ---------------------------------------------------------------
+void *ps_calloc(size_t n, size_t size)
+{
+	return psramFound() ? calloc(n, size) : nullptr;
+}
+// ---------------------------------------------------------------
+void *ps_realloc(void *ptr, size_t size)
+{
+	return psramFound() ? realloc(ptr, size) : nullptr;
+}
+// ---------------------------------------------------------------
+size_t HardwareSerial::printf(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	int len = vprintf(format, args);
+	va_end(args);
+	return len < 0 ? 0 : len;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief CPU time of the calling thread in cycles of a 240 MHz core, stage timings keep
+ * 		their unit and time the thread spends preempted on a busy host is left out
+ */
+uint32_t EspClass::getCycleCount()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return (uint32_t)(((uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec) * 240 / 1000);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Free heap as on a target with 320 kB (plus the emulated PSRAM): the bytes
+ * 		malloc() has handed out since start-up are taken from it, so heap use can be
+ * 		compared between builds
+ */
+uint32_t EspClass::getFreeHeap()
+{
+	size_t used = heapInUse();
+	used = used > bootHeap ? used - bootHeap : 0;
+	return used < getHeapSize() ? getHeapSize() - used : 0;
+}
+// ---------------------------------------------------------------
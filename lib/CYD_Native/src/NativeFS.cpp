@@ -0,0 +1,208 @@
+#include "FS.h"
+#include "SD.h"
+#include "SD_MMC.h"
+#include "FFat.h"
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+using namespace fs;
+
+/**
+ * @brief File or directory of the host, opened with stdio / dirent
+ */
+class NativeFileImpl : public FileImpl
+{
+public:
+	NativeFileImpl(const std::string &hostPath, const char *path, const char *mode) : _hostPath(hostPath), _path(path)
+	{
+		size_t slash = _path.rfind('/');
+		_name = slash == std::string::npos ? _path : _path.substr(slash + 1);
+		struct stat st;
+		if (stat(hostPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+		{
+			_dir = opendir(hostPath.c_str());
+			_mtime = st.st_mtime;
+			return;
+		}
+		_file = fopen(hostPath.c_str(), mode[0] == 'r' ? "rb" : mode[0] == 'a' ? "ab" : "wb");
+		if (_file && fstat(fileno(_file), &st) == 0) _mtime = st.st_mtime;
+	}
+	~NativeFileImpl() { close(); }
+
+	size_t write(const uint8_t *buf, size_t size) { return _file ? fwrite(buf, 1, size, _file) : 0; }
+	size_t read(uint8_t *buf, size_t size) { return _file ? fread(buf, 1, size, _file) : 0; }
+	void flush() { if (_file) fflush(_file); }
+	bool seek(uint32_t pos, SeekMode mode)
+	{
+		if (!_file) return false;
+		int whence = mode == SeekCur ? SEEK_CUR : mode == SeekEnd ? SEEK_END : SEEK_SET;
+		return fseek(_file, mode == SeekSet ? (long)pos : (long)(int32_t)pos, whence) == 0;
+	}
+	size_t position() const { return _file ? ftell(_file) : 0; }
+	size_t size() const
+	{
+		struct stat st;
+		if (_file) fflush(_file);
+		return _file && fstat(fileno(_file), &st) == 0 ? st.st_size : 0;
+	}
+	bool setBufferSize(size_t size) { return _file && setvbuf(_file, nullptr, _IOFBF, size) == 0; }
+	void close()
+	{
+		if (_file) fclose(_file);
+		if (_dir) closedir(_dir);
+		_file = nullptr;
+		_dir = nullptr;
+	}
+	time_t getLastWrite() { return _mtime; }
+	const char *path() const { return _path.c_str(); }
+	const char *name() const { return _name.c_str(); }
+	boolean isDirectory(void) { return _dir != nullptr; }
+	FileImplPtr openNextFile(const char *mode)
+	{
+		struct dirent *entry = nextEntry();
+		if (!entry) return FileImplPtr();
+		return std::make_shared<NativeFileImpl>(_hostPath + "/" + entry->d_name, childPath(entry->d_name).c_str(), mode);
+	}
+	String getNextFileName(void) { return getNextFileName(nullptr); }
+	String getNextFileName(bool *isDir)
+	{
+		struct dirent *entry = nextEntry();
+		if (!entry) return String();
+		if (isDir)
+		{
+			struct stat st;
+			*isDir = stat((_hostPath + "/" + entry->d_name).c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+		}
+		return String(childPath(entry->d_name).c_str());
+	}
+	void rewindDirectory(void) { if (_dir) rewinddir(_dir); }
+	operator bool() { return _file || _dir; }
+
+private:
+	std::string _hostPath;
+	std::string _path;
+	std::string _name;
+	FILE *_file = nullptr;
+	DIR *_dir = nullptr;
+	time_t _mtime = 0;
+
+	struct dirent *nextEntry()
+	{
+		struct dirent *entry;
+		while (_dir && (entry = readdir(_dir)))
+		{
+			if (strcmp(entry->d_name, ".") && strcmp(entry->d_name, "..")) return entry;
+		}
+		return nullptr;
+	}
+	std::string childPath(const char *name) const { return (_path == "/" ? "" : _path) + "/" + name; }
+};
+
+/**
+ * @brief Directory of the host as a file system, paths are appended to its root
+ */
+class NativeFSImpl : public FSImpl
+{
+public:
+	std::string root;
+	bool mounted = false;
+
+	std::string hostPath(const char *path) const { return root + (path[0] == '/' ? "" : "/") + path; }
+
+	FileImplPtr open(const char *path, const char *mode, const bool create)
+	{
+		if (!mounted || !path) return FileImplPtr();
+		if (mode[0] == 'r' && access(hostPath(path).c_str(), F_OK) != 0) return FileImplPtr();
+		auto file = std::make_shared<NativeFileImpl>(hostPath(path), path, mode);
+		return *file ? file : FileImplPtr();
+	}
+	bool exists(const char *path) { return mounted && path && access(hostPath(path).c_str(), F_OK) == 0; }
+	bool rename(const char *pathFrom, const char *pathTo) { return mounted && ::rename(hostPath(pathFrom).c_str(), hostPath(pathTo).c_str()) == 0; }
+	bool remove(const char *path) { return mounted && unlink(hostPath(path).c_str()) == 0; }
+	bool mkdir(const char *path) { return mounted && ::mkdir(hostPath(path).c_str(), 0755) == 0; }
+	bool rmdir(const char *path) { return mounted && ::rmdir(hostPath(path).c_str()) == 0; }
+};
+
+// ---------------------------------------------------------------
+File FS::open(const char *path, const char *mode, const bool create)
+{
+	return _impl ? File(_impl->open(path, mode, create)) : File();
+}
+// ---------------------------------------------------------------
+bool FS::exists(const char *path)
+{
+	return _impl && _impl->exists(path);
+}
+// ---------------------------------------------------------------
+bool FS::remove(const char *path)
+{
+	return _impl && _impl->remove(path);
+}
+// ---------------------------------------------------------------
+bool FS::rename(const char *pathFrom, const char *pathTo)
+{
+	return _impl && _impl->rename(pathFrom, pathTo);
+}
+// ---------------------------------------------------------------
+bool FS::mkdir(const char *path)
+{
+	return _impl && _impl->mkdir(path);
+}
+// ---------------------------------------------------------------
+bool FS::rmdir(const char *path)
+{
+	return _impl && _impl->rmdir(path);
+}
+// ---------------------------------------------------------------
+NativeFS::NativeFS(const char *rootVariable) : FS(std::make_shared<NativeFSImpl>())
+{
+	const char *root = getenv(rootVariable);
+	static_cast<NativeFSImpl *>(_impl.get())->root = root ? root : ".";
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Mount the host directory
+ *
+ * @param root directory, nullptr keeps the one from the environment
+ * @return true the directory exists
+ */
+bool NativeFS::begin(const char *root)
+{
+	NativeFSImpl *impl = static_cast<NativeFSImpl *>(_impl.get());
+	if (root) impl->root = root;
+	while (impl->root.size() > 1 && impl->root.back() == '/') impl->root.pop_back();
+	struct stat st;
+	impl->mounted = stat(impl->root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+	if (!impl->mounted) log_e("%s is not a directory", impl->root.c_str());
+	return impl->mounted;
+}
+// ---------------------------------------------------------------
+void NativeFS::end()
+{
+	static_cast<NativeFSImpl *>(_impl.get())->mounted = false;
+}
+// ---------------------------------------------------------------
+const char *NativeFS::root()
+{
+	NativeFSImpl *impl = static_cast<NativeFSImpl *>(_impl.get());
+	return impl->mounted ? impl->root.c_str() : nullptr;
+}
+// ---------------------------------------------------------------
+uint64_t NativeFS::totalBytes()
+{
+	struct statvfs vfs;
+	return root() && statvfs(root(), &vfs) == 0 ? (uint64_t)vfs.f_blocks * vfs.f_frsize : 0;
+}
+// ---------------------------------------------------------------
+uint64_t NativeFS::usedBytes()
+{
+	struct statvfs vfs;
+	return root() && statvfs(root(), &vfs) == 0 ? (uint64_t)(vfs.f_blocks - vfs.f_bfree) * vfs.f_frsize : 0;
+}
+// ---------------------------------------------------------------
+SPIClass SPI;
+fs::SDFS SD;
+fs::SDMMCFS SD_MMC;
+fs::F_Fat FFat;
@@ -0,0 +1,334 @@
+#include <Arduino.h>
+#include <freertos/event_groups.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Task: a detached thread and its notification counter
+ */
+struct cydNativeTask
+{
+	std::mutex lock;
+	std::condition_variable cv;
+	uint32_t notifications = 0;
+};
+
+/**
+ * @brief Mutex, recursive mutex, binary or counting semaphore. A mutex remembers
+ * 		its holder so the recursive calls can nest.
+ */
+struct cydNativeSemaphore
+{
+	std::mutex lock;
+	std::condition_variable cv;
+	UBaseType_t count;
+	UBaseType_t maxCount;
+	std::thread::id holder;
+	UBaseType_t depth = 0;
+};
+
+struct cydNativeQueue
+{
+	std::mutex lock;
+	std::condition_variable cv;
+	std::deque<std::vector<uint8_t>> items;
+	UBaseType_t length;
+	UBaseType_t itemSize;
+};
+
+struct cydNativeEventGroup
+{
+	std::mutex lock;
+	std::condition_variable cv;
+	EventBits_t bits = 0;
+};
+
+static thread_local cydNativeTask *currentTask = nullptr;
+static std::recursive_mutex criticalLock;
+
+// ---------------------------------------------------------------
+/**
+ * @brief Wait on a condition variable for a number of ticks, portMAX_DELAY waits forever
+ *
+ * @return true the predicate became true
+ */
+template <typename Predicate>
+static bool waitTicks(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks, Predicate ready)
+{
+	if (ticks == portMAX_DELAY)
+	{
+		cv.wait(lock, ready);
+		return true;
+	}
+	return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+// ---------------------------------------------------------------
+void cydNativeCritical(bool enter)
+{
+	if (enter) criticalLock.lock();
+	else criticalLock.unlock();
+}
+// ---------------------------------------------------------------
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameter,
+								   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+	cydNativeTask *task = new cydNativeTask;
+	if (handle) *handle = task;
+	std::thread([=]() {
+		currentTask = task;
+		code(parameter);
+	}).detach();
+	return pdPASS;
+}
+// ---------------------------------------------------------------
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameter,
+					   UBaseType_t priority, TaskHandle_t *handle)
+{
+	return xTaskCreatePinnedToCore(code, name, stackDepth, parameter, priority, handle, tskNO_AFFINITY);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Only a task can delete itself on the host: its thread ends here
+ */
+void vTaskDelete(TaskHandle_t task)
+{
+	if (task && task != currentTask) return;
+	while (true) std::this_thread::sleep_for(std::chrono::hours(1));
+}
+// ---------------------------------------------------------------
+void vTaskDelay(TickType_t ticks)
+{
+	if (ticks) std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+	else std::this_thread::yield();
+}
+// ---------------------------------------------------------------
+TickType_t xTaskGetTickCount()
+{
+	return millis();
+}
+// ---------------------------------------------------------------
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+	if (!currentTask) currentTask = new cydNativeTask;	// main thread
+	return currentTask;
+}
+// ---------------------------------------------------------------
+void xTaskNotifyGive(TaskHandle_t task)
+{
+	std::lock_guard<std::mutex> lock(task->lock);
+	task->notifications++;
+	task->cv.notify_all();
+}
+// ---------------------------------------------------------------
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks)
+{
+	cydNativeTask *task = xTaskGetCurrentTaskHandle();
+	std::unique_lock<std::mutex> lock(task->lock);
+	waitTicks(task->cv, lock, ticks, [task]() { return task->notifications > 0; });
+	uint32_t value = task->notifications;
+	if (value) task->notifications = clearOnExit ? 0 : value - 1;
+	return value;
+}
+// ---------------------------------------------------------------
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task)
+{
+	return 0;
+}
+// ---------------------------------------------------------------
+static SemaphoreHandle_t createSemaphore(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+	cydNativeSemaphore *sem = new cydNativeSemaphore;
+	sem->maxCount = maxCount;
+	sem->count = initialCount;
+	return sem;
+}
+// ---------------------------------------------------------------
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+	return createSemaphore(1, 1);
+}
+// ---------------------------------------------------------------
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+	return createSemaphore(1, 1);
+}
+// ---------------------------------------------------------------
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+	return createSemaphore(1, 0);
+}
+// ---------------------------------------------------------------
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+	return createSemaphore(maxCount, initialCount);
+}
+// ---------------------------------------------------------------
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+	std::unique_lock<std::mutex> lock(sem->lock);
+	if (!waitTicks(sem->cv, lock, ticks, [sem]() { return sem->count > 0; })) return pdFALSE;
+	sem->count--;
+	sem->holder = std::this_thread::get_id();
+	return pdTRUE;
+}
+// ---------------------------------------------------------------
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+	std::lock_guard<std::mutex> lock(sem->lock);
+	if (sem->count >= sem->maxCount) return pdFALSE;
+	sem->count++;
+	sem->holder = std::thread::id();
+	sem->cv.notify_one();
+	return pdTRUE;
+}
+// ---------------------------------------------------------------
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks)
+{
+	{
+		std::lock_guard<std::mutex> lock(sem->lock);
+		if (!sem->count && sem->holder == std::this_thread::get_id())	// as FreeRTOS, even if taken by xSemaphoreTake()
+		{
+			sem->depth++;
+			return pdTRUE;
+		}
+	}
+	if (!xSemaphoreTake(sem, ticks)) return pdFALSE;
+	std::lock_guard<std::mutex> lock(sem->lock);
+	sem->depth = 1;
+	return pdTRUE;
+}
+// ---------------------------------------------------------------
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+	{
+		std::lock_guard<std::mutex> lock(sem->lock);
+		if (sem->count || sem->holder != std::this_thread::get_id()) return pdFALSE;
+		if (sem->depth && --sem->depth) return pdTRUE;
+	}
+	return xSemaphoreGive(sem);
+}
+// ---------------------------------------------------------------
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+	delete sem;
+}
+// ---------------------------------------------------------------
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+	cydNativeQueue *queue = new cydNativeQueue;
+	queue->length = length;
+	queue->itemSize = itemSize;
+	return queue;
+}
+// ---------------------------------------------------------------
+static BaseType_t queueSend(QueueHandle_t queue, const void *item, TickType_t ticks, bool front)
+{
+	std::unique_lock<std::mutex> lock(queue->lock);
+	if (!waitTicks(queue->cv, lock, ticks, [queue]() { return queue->items.size() < queue->length; })) return errQUEUE_FULL;
+	const uint8_t *data = (const uint8_t *)item;
+	std::vector<uint8_t> copy(data, data + queue->itemSize);
+	if (front) queue->items.push_front(std::move(copy));
+	else queue->items.push_back(std::move(copy));
+	queue->cv.notify_all();
+	return pdPASS;
+}
+// ---------------------------------------------------------------
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+	return queueSend(queue, item, ticks, false);
+}
+// ---------------------------------------------------------------
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+	return queueSend(queue, item, ticks, true);
+}
+// ---------------------------------------------------------------
+static BaseType_t queueReceive(QueueHandle_t queue, void *item, TickType_t ticks, bool remove)
+{
+	std::unique_lock<std::mutex> lock(queue->lock);
+	if (!waitTicks(queue->cv, lock, ticks, [queue]() { return !queue->items.empty(); })) return errQUEUE_EMPTY;
+	memcpy(item, queue->items.front().data(), queue->itemSize);
+	if (remove)
+	{
+		queue->items.pop_front();
+		queue->cv.notify_all();
+	}
+	return pdPASS;
+}
+// ---------------------------------------------------------------
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+	return queueReceive(queue, item, ticks, true);
+}
+// ---------------------------------------------------------------
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+	return queueReceive(queue, item, ticks, false);
+}
+// ---------------------------------------------------------------
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+	std::lock_guard<std::mutex> lock(queue->lock);
+	queue->items.clear();
+	queue->cv.notify_all();
+	return pdPASS;
+}
+// ---------------------------------------------------------------
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+	std::lock_guard<std::mutex> lock(queue->lock);
+	return queue->items.size();
+}
+// ---------------------------------------------------------------
+void vQueueDelete(QueueHandle_t queue)
+{
+	delete queue;
+}
+// ---------------------------------------------------------------
+EventGroupHandle_t xEventGroupCreate()
+{
+	return new cydNativeEventGroup;
+}
+// ---------------------------------------------------------------
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits)
+{
+	std::lock_guard<std::mutex> lock(group->lock);
+	group->bits |= bits;
+	group->cv.notify_all();
+	return group->bits;
+}
+// ---------------------------------------------------------------
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits)
+{
+	std::lock_guard<std::mutex> lock(group->lock);
+	EventBits_t old = group->bits;
+	group->bits &= ~bits;
+	return old;
+}
+// ---------------------------------------------------------------
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group)
+{
+	std::lock_guard<std::mutex> lock(group->lock);
+	return group->bits;
+}
+// ---------------------------------------------------------------
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+								BaseType_t waitForAll, TickType_t ticks)
+{
+	std::unique_lock<std::mutex> lock(group->lock);
+	auto ready = [=]() { return waitForAll ? (group->bits & bits) == bits : (group->bits & bits) != 0; };
+	bool set = waitTicks(group->cv, lock, ticks, ready);
+	EventBits_t value = group->bits;
+	if (set && clearOnExit) group->bits &= ~bits;
+	return value;
+}
+// ---------------------------------------------------------------
+void vEventGroupDelete(EventGroupHandle_t group)
+{
+	delete group;
+}
+// ---------------------------------------------------------------
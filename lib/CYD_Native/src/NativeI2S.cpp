@@ -0,0 +1,283 @@
+#include <Arduino.h>
+#include <driver/i2s.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * @brief One I2S port: its configuration and the simulated DMA clock. clockFrames
+ * 		were written since clockStart, the ones the clock has not played yet fill the
+ * 		DMA buffers.
+ */
+struct NativeI2SPort
+{
+	bool installed = false;
+	bool running = false;
+	i2s_config_t config = {};
+	Clock::time_point clockStart;
+	uint64_t clockFrames = 0;
+	uint64_t frames = 0;
+	uint32_t underruns = 0;
+	uint64_t lowWater = UINT64_MAX;	// fewest frames left in the DMA buffers at a write
+};
+
+static NativeI2SPort ports[I2S_NUM_MAX];
+static std::mutex i2sLock;
+static FILE *wavFile = nullptr;
+static uint32_t wavRate = 0;
+static uint32_t wavBytes = 0;
+static bool wavOpened = false;
+
+// ---------------------------------------------------------------
+static void putLE(uint8_t *p, uint32_t value, int bytes)
+{
+	for (int i = 0; i < bytes; i++) p[i] = value >> (8 * i);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Write the header of a 16 bit stereo WAV, again at exit with the final sizes
+ */
+static void wavHeader()
+{
+	uint8_t h[44];
+	memcpy(h, "RIFF", 4);
+	putLE(h + 4, 36 + wavBytes, 4);
+	memcpy(h + 8, "WAVEfmt ", 8);
+	putLE(h + 16, 16, 4);
+	putLE(h + 20, 1, 2);
+	putLE(h + 22, 2, 2);
+	putLE(h + 24, wavRate, 4);
+	putLE(h + 28, wavRate * 4, 4);
+	putLE(h + 32, 4, 2);
+	putLE(h + 34, 16, 2);
+	memcpy(h + 36, "data", 4);
+	putLE(h + 40, wavBytes, 4);
+	fseek(wavFile, 0, SEEK_SET);
+	fwrite(h, 1, sizeof(h), wavFile);
+	fseek(wavFile, 0, SEEK_END);
+}
+// ---------------------------------------------------------------
+static void wavClose()
+{
+	std::lock_guard<std::mutex> lock(i2sLock);
+	if (!wavFile) return;
+	wavHeader();
+	fclose(wavFile);
+	wavFile = nullptr;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Port 0 is recorded to the file named by CYD_I2S_WAV, opened on the first write
+ */
+static void wavOpen(uint32_t rate)
+{
+	wavOpened = true;
+	const char *path = getenv("CYD_I2S_WAV");
+	if (!path || !*path) return;
+	wavFile = fopen(path, "wb");
+	if (!wavFile)
+	{
+		log_e("can't create %s", path);
+		return;
+	}
+	wavRate = rate;
+	wavHeader();
+	atexit(wavClose);
+}
+// ---------------------------------------------------------------
+static bool realtime()
+{
+	static const char *value = getenv("CYD_I2S_REALTIME");
+	return !value || strcmp(value, "0");
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Frames still waiting in the DMA buffers. An underrun restarts the clock,
+ * 		the hardware would have played silence meanwhile.
+ */
+static uint64_t dmaFill(NativeI2SPort &port, Clock::time_point now)
+{
+	if (!realtime() || !port.running) return 0;
+	double elapsed = std::chrono::duration<double>(now - port.clockStart).count();
+	uint64_t played = (uint64_t)(elapsed * port.config.sample_rate);
+	if (played >= port.clockFrames)
+	{
+		if (played > port.clockFrames) port.underruns++;
+		port.clockStart = now;
+		port.clockFrames = 0;
+		return 0;
+	}
+	return port.clockFrames - played;
+}
+// ---------------------------------------------------------------
+esp_err_t i2s_driver_install(i2s_port_t i2s_num, const i2s_config_t *i2s_config, int queue_size, void *i2s_queue)
+{
+	if (i2s_num >= I2S_NUM_MAX || !i2s_config) return ESP_ERR_INVALID_ARG;
+	std::lock_guard<std::mutex> lock(i2sLock);
+	NativeI2SPort &port = ports[i2s_num];
+	if (port.installed) return ESP_ERR_INVALID_STATE;
+	port.config = *i2s_config;
+	port.installed = true;
+	port.running = true;
+	port.clockStart = Clock::now();
+	port.clockFrames = 0;
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+esp_err_t i2s_driver_uninstall(i2s_port_t i2s_num)
+{
+	if (i2s_num >= I2S_NUM_MAX) return ESP_ERR_INVALID_ARG;
+	std::lock_guard<std::mutex> lock(i2sLock);
+	if (!ports[i2s_num].installed) return ESP_ERR_INVALID_STATE;
+	ports[i2s_num].installed = false;
+	ports[i2s_num].running = false;
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+esp_err_t i2s_set_pin(i2s_port_t i2s_num, const i2s_pin_config_t *pin)
+{
+	return i2s_num < I2S_NUM_MAX && ports[i2s_num].installed ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+// ---------------------------------------------------------------
+esp_err_t i2s_set_dac_mode(i2s_dac_mode_t dac_mode)
+{
+	return dac_mode < I2S_DAC_CHANNEL_MAX ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+// ---------------------------------------------------------------
+esp_err_t i2s_set_sample_rates(i2s_port_t i2s_num, uint32_t rate)
+{
+	if (i2s_num >= I2S_NUM_MAX || !rate) return ESP_ERR_INVALID_ARG;
+	std::lock_guard<std::mutex> lock(i2sLock);
+	NativeI2SPort &port = ports[i2s_num];
+	if (!port.installed) return ESP_ERR_INVALID_STATE;
+	if (rate == port.config.sample_rate) return ESP_OK;
+	// the DMA buffers are flushed by a rate change
+	port.config.sample_rate = rate;
+	port.clockStart = Clock::now();
+	port.clockFrames = 0;
+	if (i2s_num == I2S_NUM_0 && wavFile && wavBytes && rate != wavRate)
+		log_w("WAV sink is %u Hz, the port now runs %u Hz", wavRate, rate);
+	else if (i2s_num == I2S_NUM_0 && !wavBytes) wavRate = rate;
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+esp_err_t i2s_start(i2s_port_t i2s_num)
+{
+	if (i2s_num >= I2S_NUM_MAX) return ESP_ERR_INVALID_ARG;
+	std::lock_guard<std::mutex> lock(i2sLock);
+	NativeI2SPort &port = ports[i2s_num];
+	if (!port.installed) return ESP_ERR_INVALID_STATE;
+	port.running = true;
+	port.clockStart = Clock::now();
+	port.clockFrames = 0;
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+esp_err_t i2s_stop(i2s_port_t i2s_num)
+{
+	if (i2s_num >= I2S_NUM_MAX) return ESP_ERR_INVALID_ARG;
+	std::lock_guard<std::mutex> lock(i2sLock);
+	if (!ports[i2s_num].installed) return ESP_ERR_INVALID_STATE;
+	ports[i2s_num].running = false;
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+esp_err_t i2s_zero_dma_buffer(i2s_port_t i2s_num)
+{
+	if (i2s_num >= I2S_NUM_MAX) return ESP_ERR_INVALID_ARG;
+	std::lock_guard<std::mutex> lock(i2sLock);
+	NativeI2SPort &port = ports[i2s_num];
+	if (!port.installed) return ESP_ERR_INVALID_STATE;
+	port.clockStart = Clock::now();
+	port.clockFrames = 0;
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Hand frames to the sink once the simulated DMA buffers have room for them
+ *
+ * @param ticks_to_wait ms to wait for room, a partial write returns ESP_OK like the IDF driver
+ */
+esp_err_t i2s_write(i2s_port_t i2s_num, const void *src, size_t size, size_t *bytes_written, TickType_t ticks_to_wait)
+{
+	if (i2s_num >= I2S_NUM_MAX || !src || !bytes_written) return ESP_ERR_INVALID_ARG;
+	*bytes_written = 0;
+	std::unique_lock<std::mutex> lock(i2sLock);
+	NativeI2SPort &port = ports[i2s_num];
+	if (!port.installed) return ESP_ERR_INVALID_STATE;
+
+	const size_t frameBytes = port.config.bits_per_sample / 8 * 2;
+	const uint64_t capacity = (uint64_t)port.config.dma_buf_count * port.config.dma_buf_len;
+	const bool dac = port.config.mode & I2S_MODE_DAC_BUILT_IN;
+	const uint8_t *data = (const uint8_t *)src;
+	size_t frames = size / frameBytes;
+	Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(ticks_to_wait);
+
+	if (i2s_num == I2S_NUM_0 && !wavOpened) wavOpen(port.config.sample_rate);
+
+	while (frames)
+	{
+		Clock::time_point now = Clock::now();
+		uint64_t fill = dmaFill(port, now);
+		if (realtime()) port.lowWater = std::min(port.lowWater, fill);
+		if (fill >= capacity)
+		{
+			if (ticks_to_wait != portMAX_DELAY && now >= deadline) break;
+			// sleep until a quarter of the buffers has been played
+			double wait = (double)(fill - capacity + capacity / 4 + 1) / port.config.sample_rate;
+			lock.unlock();
+			std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+			lock.lock();
+			continue;
+		}
+		size_t chunk = std::min<uint64_t>(frames, capacity - fill);
+		if (i2s_num == I2S_NUM_0 && wavFile)
+		{
+			if (port.config.bits_per_sample == I2S_BITS_PER_SAMPLE_16BIT)
+			{
+				int16_t pcm[512];
+				for (size_t i = 0; i < chunk * 2;)
+				{
+					size_t n = std::min<size_t>(chunk * 2 - i, 512);
+					memcpy(pcm, data + i * 2, n * 2);
+					if (dac) for (size_t k = 0; k < n; k++) pcm[k] ^= (int16_t)0x8000;
+					fwrite(pcm, 2, n, wavFile);
+					i += n;
+				}
+				wavBytes += chunk * 4;
+			}
+		}
+		port.clockFrames += chunk;
+		port.frames += chunk;
+		data += chunk * frameBytes;
+		*bytes_written += chunk * frameBytes;
+		frames -= chunk;
+	}
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+uint64_t cydNativeI2SFrames(i2s_port_t i2s_num)
+{
+	std::lock_guard<std::mutex> lock(i2sLock);
+	return i2s_num < I2S_NUM_MAX ? ports[i2s_num].frames : 0;
+}
+// ---------------------------------------------------------------
+void cydNativeI2SGetStats(i2s_port_t i2s_num, cydNativeI2SStats_t *stats)
+{
+	std::lock_guard<std::mutex> lock(i2sLock);
+	if (i2s_num >= I2S_NUM_MAX) return;
+	const NativeI2SPort &port = ports[i2s_num];
+	stats->underruns = port.underruns;
+	stats->lowWaterMs = port.lowWater == UINT64_MAX ? 0 : (uint32_t)(port.lowWater * 1000 / port.config.sample_rate);
+}
+// ---------------------------------------------------------------
+void cydNativeI2SResetStats(i2s_port_t i2s_num)
+{
+	std::lock_guard<std::mutex> lock(i2sLock);
+	if (i2s_num >= I2S_NUM_MAX) return;
+	ports[i2s_num].underruns = 0;
+	ports[i2s_num].lowWater = UINT64_MAX;
+}
+// ---------------------------------------------------------------
@@ -0,0 +1,60 @@
+#include <TFT_eSPI.h>
+
+static TFT_eSPI *lastDisplay = nullptr;
+
+// ---------------------------------------------------------------
+TFT_eSPI::TFT_eSPI(int16_t width, int16_t height) : _width(width), _height(height)
+{
+	_framebuffer = (uint16_t *)calloc((size_t)width * height, sizeof(uint16_t));
+	lastDisplay = this;
+}
+// ---------------------------------------------------------------
+TFT_eSPI::~TFT_eSPI()
+{
+	if (lastDisplay == this) lastDisplay = nullptr;
+	free(_framebuffer);
+}
+// ---------------------------------------------------------------
+void TFT_eSPI::setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h)
+{
+	_windowX = x;
+	_windowY = y;
+	_windowW = w;
+	_windowH = h;
+	_windowPos = 0;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Fill the address window row by row, pixels outside the screen are dropped
+ */
+void TFT_eSPI::pushColors(uint16_t *data, uint32_t len, bool swap)
+{
+	if (!_framebuffer || _windowW <= 0) return;
+	for (uint32_t i = 0; i < len; i++, _windowPos++)
+	{
+		int32_t x = _windowX + _windowPos % _windowW;
+		int32_t y = _windowY + _windowPos / _windowW;
+		if (x < 0 || x >= _width || y < 0 || y >= _height) continue;
+		_framebuffer[y * _width + x] = data[i];
+	}
+}
+// ---------------------------------------------------------------
+void TFT_eSPI::pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data)
+{
+	setAddrWindow(x, y, w, h);
+	pushColors((uint16_t *)data, (uint32_t)w * h, false);
+}
+// ---------------------------------------------------------------
+void TFT_eSPI::fillScreen(uint32_t color)
+{
+	for (int32_t i = 0; _framebuffer && i < (int32_t)_width * _height; i++) _framebuffer[i] = color;
+}
+// ---------------------------------------------------------------
+const uint16_t *cydNativeFramebuffer(int16_t *width, int16_t *height)
+{
+	if (!lastDisplay) return nullptr;
+	if (width) *width = lastDisplay->width();
+	if (height) *height = lastDisplay->height();
+	return lastDisplay->framebuffer();
+}
+// ---------------------------------------------------------------
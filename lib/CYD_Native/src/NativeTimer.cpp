@@ -0,0 +1,105 @@
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/**
+ * @brief Timer: its thread waits for the next deadline, stop or delete wake it early
+ */
+struct cydNativeTimer
+{
+	std::mutex lock;
+	std::condition_variable cv;
+	esp_timer_cb_t callback;
+	void *arg;
+	bool armed = false;
+	bool deleted = false;
+	uint64_t periodUs = 0;		// 0 = one shot
+	std::chrono::steady_clock::time_point deadline;
+};
+
+// ---------------------------------------------------------------
+static void timerThread(cydNativeTimer *timer)
+{
+	std::unique_lock<std::mutex> lock(timer->lock);
+	while (!timer->deleted)
+	{
+		if (!timer->armed)
+		{
+			timer->cv.wait(lock);
+			continue;
+		}
+		if (timer->cv.wait_until(lock, timer->deadline) != std::cv_status::timeout) continue;	// rearmed, stopped or deleted
+		if (timer->periodUs) timer->deadline += std::chrono::microseconds(timer->periodUs);
+		else timer->armed = false;
+		lock.unlock();
+		timer->callback(timer->arg);
+		lock.lock();
+	}
+	lock.unlock();
+	delete timer;
+}
+// ---------------------------------------------------------------
+static esp_err_t startTimer(esp_timer_handle_t timer, uint64_t us, bool periodic)
+{
+	if (!timer) return ESP_ERR_INVALID_ARG;
+	std::lock_guard<std::mutex> lock(timer->lock);
+	if (timer->armed) return ESP_ERR_INVALID_STATE;
+	timer->armed = true;
+	timer->periodUs = periodic ? us : 0;
+	timer->deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+	timer->cv.notify_all();
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle)
+{
+	if (!args || !args->callback || !handle) return ESP_ERR_INVALID_ARG;
+	cydNativeTimer *timer = new cydNativeTimer;
+	timer->callback = args->callback;
+	timer->arg = args->arg;
+	std::thread(timerThread, timer).detach();
+	*handle = timer;
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs)
+{
+	return startTimer(timer, timeoutUs, false);
+}
+// ---------------------------------------------------------------
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs)
+{
+	return startTimer(timer, periodUs, true);
+}
+// ---------------------------------------------------------------
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+	if (!timer) return ESP_ERR_INVALID_ARG;
+	std::lock_guard<std::mutex> lock(timer->lock);
+	if (!timer->armed) return ESP_ERR_INVALID_STATE;
+	timer->armed = false;
+	timer->cv.notify_all();
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief The timer thread frees the timer once it has seen the flag
+ */
+esp_err_t esp_timer_delete(esp_timer_handle_t timer)
+{
+	if (!timer) return ESP_ERR_INVALID_ARG;
+	std::lock_guard<std::mutex> lock(timer->lock);
+	if (timer->armed) return ESP_ERR_INVALID_STATE;
+	timer->deleted = true;
+	timer->cv.notify_all();
+	return ESP_OK;
+}
+// ---------------------------------------------------------------
+int64_t esp_timer_get_time()
+{
+	return micros();
+}
+// ---------------------------------------------------------------
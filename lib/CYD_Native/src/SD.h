@@ -0,0 +1,41 @@
+#ifndef _CYD_NATIVE_SD_H_
+#define _CYD_NATIVE_SD_H_
+
+#include "FS.h"
+#include "SPI.h"
+
+typedef enum
+{
+	CARD_NONE,
+	CARD_MMC,
+	CARD_SD,
+	CARD_SDHC,
+	CARD_UNKNOWN
+} sdcard_type_t;
+
+namespace fs
+{
+
+/**
+ * @brief SD card on a host directory: $CYD_SD_ROOT, else the working directory
+ */
+class SDFS : public NativeFS
+{
+public:
+	SDFS() : NativeFS("CYD_SD_ROOT") {}
+	bool begin(uint8_t ssPin = 5, SPIClass &spi = SPI, uint32_t frequency = 4000000, const char *mountpoint = "/sd",
+			   uint8_t max_files = 5, bool format_if_empty = false)
+	{
+		return NativeFS::begin();
+	}
+	bool begin(const char *root) { return NativeFS::begin(root); }	// another host directory as the card
+	sdcard_type_t cardType() { return root() ? CARD_SDHC : CARD_NONE; }
+	uint64_t cardSize() { return totalBytes(); }
+};
+
+} // namespace fs
+
+extern fs::SDFS SD;
+using namespace fs;
+
+#endif // _CYD_NATIVE_SD_H_
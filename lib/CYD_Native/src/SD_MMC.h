@@ -0,0 +1,29 @@
+#ifndef _CYD_NATIVE_SD_MMC_H_
+#define _CYD_NATIVE_SD_MMC_H_
+
+#include "SD.h"
+
+namespace fs
+{
+
+/**
+ * @brief SD card in SDMMC mode on a host directory: $CYD_SD_MMC_ROOT, else the working directory
+ */
+class SDMMCFS : public NativeFS
+{
+public:
+	SDMMCFS() : NativeFS("CYD_SD_MMC_ROOT") {}
+	bool begin(const char *mountpoint = "/sdcard", bool mode1bit = false, bool format_if_mount_failed = false,
+			   int sdmmc_frequency = 20000, uint8_t maxOpenFiles = 5)
+	{
+		return NativeFS::begin();
+	}
+	sdcard_type_t cardType() { return root() ? CARD_SDHC : CARD_NONE; }
+	uint64_t cardSize() { return totalBytes(); }
+};
+
+} // namespace fs
+
+extern fs::SDMMCFS SD_MMC;
+
+#endif // _CYD_NATIVE_SD_MMC_H_
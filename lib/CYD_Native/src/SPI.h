@@ -0,0 +1,23 @@
+#ifndef _CYD_NATIVE_SPI_H_
+#define _CYD_NATIVE_SPI_H_
+
+#include <Arduino.h>
+
+#define FSPI 1
+#define HSPI 2
+#define VSPI 3
+
+/**
+ * @brief SPI bus, nothing is attached on the host
+ */
+class SPIClass
+{
+public:
+	SPIClass(uint8_t bus = HSPI) {}
+	void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {}
+	void end() {}
+	void setFrequency(uint32_t freq) {}
+};
+extern SPIClass SPI;
+
+#endif // _CYD_NATIVE_SPI_H_
@@ -0,0 +1,45 @@
+#ifndef _CYD_NATIVE_TFT_ESPI_H_
+#define _CYD_NATIVE_TFT_ESPI_H_
+
+#include <Arduino.h>
+
+/**
+ * @brief TFT_eSPI on a framebuffer in host memory, the part the LVGL driver uses. Pixels
+ * 		are kept as RGB565 in native byte order, so the panel's byte swap is dropped.
+ * 		ESP32_DMA is not defined: LVGL takes the blocking flush.
+ */
+class TFT_eSPI
+{
+public:
+	TFT_eSPI(int16_t width = 240, int16_t height = 320);
+	~TFT_eSPI();
+
+	void begin(uint8_t tc = 0) {}
+	void init(uint8_t tc = 0) {}
+	void setRotation(uint8_t rotation) {}	// the framebuffer is in display orientation already
+	int16_t width() const { return _width; }
+	int16_t height() const { return _height; }
+
+	void startWrite() {}
+	void endWrite() {}
+	void setAddrWindow(int32_t x, int32_t y, int32_t w, int32_t h);
+	void pushColors(uint16_t *data, uint32_t len, bool swap = true);
+	void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, const uint16_t *data);
+	void fillScreen(uint32_t color);
+
+	const uint16_t *framebuffer() const { return _framebuffer; }
+
+private:
+	int16_t _width;
+	int16_t _height;
+	uint16_t *_framebuffer;
+	int32_t _windowX = 0, _windowY = 0, _windowW = 0, _windowH = 0;
+	uint32_t _windowPos = 0;	// pixels pushed into the address window so far
+};
+
+/**
+ * @brief Framebuffer of the display created last, nullptr before there is one
+ */
+const uint16_t *cydNativeFramebuffer(int16_t *width = nullptr, int16_t *height = nullptr);
+
+#endif // _CYD_NATIVE_TFT_ESPI_H_
@@ -0,0 +1,129 @@
+#ifndef _CYD_NATIVE_WSTRING_H_
+#define _CYD_NATIVE_WSTRING_H_
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <string>
+
+/**
+ * @brief Arduino String on std::string, the commonly used part of the API
+ */
+class String
+{
+public:
+	String(const char *cstr = "") : s(cstr ? cstr : "") {}
+	String(const char *cstr, unsigned int length) : s(cstr, length) {}
+	String(const std::string &str) : s(str) {}
+	explicit String(char c) : s(1, c) {}
+	explicit String(unsigned char value, unsigned char base = 10) : s(format((unsigned long)value, base)) {}
+	explicit String(int value, unsigned char base = 10) : s(format((long)value, base)) {}
+	explicit String(unsigned int value, unsigned char base = 10) : s(format((unsigned long)value, base)) {}
+	explicit String(long value, unsigned char base = 10) : s(format(value, base)) {}
+	explicit String(unsigned long value, unsigned char base = 10) : s(format(value, base)) {}
+	explicit String(float value, unsigned int decimals = 2) : s(format((double)value, decimals)) {}
+	explicit String(double value, unsigned int decimals = 2) : s(format(value, decimals)) {}
+
+	unsigned int length() const { return s.length(); }
+	bool isEmpty() const { return s.empty(); }
+	const char *c_str() const { return s.c_str(); }
+	bool reserve(unsigned int size) { s.reserve(size); return true; }
+	char charAt(unsigned int index) const { return index < s.length() ? s[index] : 0; }
+	void setCharAt(unsigned int index, char c) { if (index < s.length()) s[index] = c; }
+	char operator[](unsigned int index) const { return charAt(index); }
+	char &operator[](unsigned int index) { return s[index]; }
+
+	bool concat(const String &str) { s += str.s; return true; }
+	bool concat(const char *cstr) { if (cstr) s += cstr; return true; }
+	bool concat(char c) { s += c; return true; }
+	template <typename T> bool concat(T value) { s += String(value).s; return true; }
+	template <typename T> String &operator+=(const T &value) { concat(value); return *this; }
+
+	friend String operator+(const String &a, const String &b) { return String(a.s + b.s); }
+	friend String operator+(const String &a, const char *b) { return String(a.s + (b ? b : "")); }
+	friend String operator+(const char *a, const String &b) { return String((a ? a : "") + b.s); }
+	friend String operator+(const String &a, char c) { return String(a.s + c); }
+	template <typename T> friend String operator+(const String &a, T value) { return a + String(value); }
+
+	bool equals(const String &str) const { return s == str.s; }
+	bool equals(const char *cstr) const { return s == (cstr ? cstr : ""); }
+	bool equalsIgnoreCase(const String &str) const { return s.length() == str.s.length() && strcasecmp(c_str(), str.c_str()) == 0; }
+	int compareTo(const String &str) const { return s.compare(str.s); }
+	bool operator==(const String &str) const { return equals(str); }
+	bool operator==(const char *cstr) const { return equals(cstr); }
+	bool operator!=(const String &str) const { return !equals(str); }
+	bool operator!=(const char *cstr) const { return !equals(cstr); }
+	bool operator<(const String &str) const { return s < str.s; }
+	bool operator>(const String &str) const { return s > str.s; }
+	bool startsWith(const String &prefix, unsigned int offset = 0) const { return s.compare(offset, prefix.s.length(), prefix.s) == 0 && offset + prefix.s.length() <= s.length(); }
+	bool endsWith(const String &suffix) const { return s.length() >= suffix.s.length() && s.compare(s.length() - suffix.s.length(), suffix.s.length(), suffix.s) == 0; }
+
+	int indexOf(char c, unsigned int from = 0) const { return position(s.find(c, from)); }
+	int indexOf(const String &str, unsigned int from = 0) const { return position(s.find(str.s, from)); }
+	int lastIndexOf(char c) const { return position(s.rfind(c)); }
+	int lastIndexOf(char c, unsigned int from) const { return position(s.rfind(c, from)); }
+	int lastIndexOf(const String &str) const { return position(s.rfind(str.s)); }
+	String substring(unsigned int from) const { return from < s.length() ? String(s.substr(from)) : String(); }
+	String substring(unsigned int from, unsigned int to) const
+	{
+		if (from > to) std::swap(from, to);
+		if (from >= s.length()) return String();
+		return String(s.substr(from, to - from));
+	}
+
+	void replace(char find, char replace) { for (auto &c : s) if (c == find) c = replace; }
+	void replace(const String &find, const String &replace)
+	{
+		if (find.s.empty()) return;
+		for (size_t pos = s.find(find.s); pos != std::string::npos; pos = s.find(find.s, pos + replace.s.length()))
+			s.replace(pos, find.s.length(), replace.s);
+	}
+	void remove(unsigned int index) { if (index < s.length()) s.erase(index); }
+	void remove(unsigned int index, unsigned int count) { if (index < s.length()) s.erase(index, count); }
+	void toLowerCase() { for (auto &c : s) c = tolower((unsigned char)c); }
+	void toUpperCase() { for (auto &c : s) c = toupper((unsigned char)c); }
+	void trim()
+	{
+		size_t first = s.find_first_not_of(" \t\r\n\f\v");
+		if (first == std::string::npos) { s.clear(); return; }
+		s = s.substr(first, s.find_last_not_of(" \t\r\n\f\v") - first + 1);
+	}
+
+	long toInt() const { return atol(c_str()); }
+	float toFloat() const { return (float)atof(c_str()); }
+	double toDouble() const { return atof(c_str()); }
+
+private:
+	std::string s;
+
+	static int position(size_t pos) { return pos == std::string::npos ? -1 : (int)pos; }
+	static std::string format(unsigned long value, unsigned char base)
+	{
+		char buf[8 * sizeof(long) + 1];
+		char *p = buf + sizeof(buf) - 1;
+		*p = 0;
+		if (base < 2) base = 10;
+		do
+		{
+			unsigned digit = value % base;
+			*--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+			value /= base;
+		} while (value);
+		return p;
+	}
+	static std::string format(long value, unsigned char base)
+	{
+		if (value < 0 && base == 10) return "-" + format((unsigned long)-value, base);
+		return format((unsigned long)value, base);
+	}
+	static std::string format(double value, unsigned int decimals)
+	{
+		char buf[64];
+		snprintf(buf, sizeof(buf), "%.*f", (int)decimals, value);
+		return buf;
+	}
+};
+
+#endif // _CYD_NATIVE_WSTRING_H_
@@ -0,0 +1,31 @@
+#ifndef _CYD_NATIVE_WIFI_H_
+#define _CYD_NATIVE_WIFI_H_
+
+#include <Arduino.h>
+#include "WiFiClient.h"
+
+typedef enum
+{
+	WL_IDLE_STATUS = 0,
+	WL_NO_SSID_AVAIL = 1,
+	WL_CONNECTED = 3,
+	WL_CONNECT_FAILED = 4,
+	WL_DISCONNECTED = 6
+} wl_status_t;
+
+/**
+ * @brief The host has no station interface: never connected, web streams fail to open
+ */
+class WiFiClass
+{
+public:
+	wl_status_t begin(const char *ssid, const char *passphrase = nullptr) { return WL_CONNECT_FAILED; }
+	wl_status_t status() { return WL_DISCONNECTED; }
+	bool isConnected() { return false; }
+	bool disconnect(bool wifiOff = false) { return true; }
+	bool mode(int m) { return true; }
+	int8_t RSSI() { return 0; }
+};
+extern WiFiClass WiFi;
+
+#endif // _CYD_NATIVE_WIFI_H_
@@ -0,0 +1,31 @@
+#ifndef _CYD_NATIVE_WIFICLIENT_H_
+#define _CYD_NATIVE_WIFICLIENT_H_
+
+#include <Arduino.h>
+
+/**
+ * @brief TCP client that never connects, so the web stream paths compile and fail cleanly
+ */
+class WiFiClient
+{
+public:
+	virtual ~WiFiClient() {}
+	virtual int connect(const char *host, uint16_t port) { return 0; }
+	virtual int connect(const char *host, uint16_t port, int32_t timeout) { return connect(host, port); }
+	virtual uint8_t connected() { return 0; }
+	virtual void stop() {}
+	virtual int available() { return 0; }
+	virtual int read() { return -1; }
+	virtual int read(uint8_t *buf, size_t size) { return -1; }
+	int read(char *buf, size_t size) { return read((uint8_t *)buf, size); }
+	size_t readBytes(uint8_t *buf, size_t length) { int n = read(buf, length); return n < 0 ? 0 : n; }
+	size_t readBytes(char *buf, size_t length) { return readBytes((uint8_t *)buf, length); }
+	virtual size_t write(const uint8_t *buf, size_t size) { return 0; }
+	size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+	size_t print(const String &s) { return print(s.c_str()); }
+	virtual void flush() {}
+	void setTimeout(unsigned long timeout) {}
+	operator bool() { return connected(); }
+};
+
+#endif // _CYD_NATIVE_WIFICLIENT_H_
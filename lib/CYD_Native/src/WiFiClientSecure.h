@@ -0,0 +1,13 @@
+#ifndef _CYD_NATIVE_WIFICLIENTSECURE_H_
+#define _CYD_NATIVE_WIFICLIENTSECURE_H_
+
+#include "WiFiClient.h"
+
+class WiFiClientSecure : public WiFiClient
+{
+public:
+	void setInsecure() {}
+	void setCACert(const char *rootCA) {}
+};
+
+#endif // _CYD_NATIVE_WIFICLIENTSECURE_H_
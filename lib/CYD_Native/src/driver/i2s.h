@@ -0,0 +1,141 @@
+#ifndef _CYD_NATIVE_DRIVER_I2S_H_
+#define _CYD_NATIVE_DRIVER_I2S_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/**
+ * @brief Legacy I2S driver of IDF 4.4 on the host. i2s_write() feeds a sink: a WAV file
+ * 		named by CYD_I2S_WAV or nothing. A simulated DMA clock drains dma_buf_count *
+ * 		dma_buf_len frames at the sample rate, so writers block like on the target.
+ * 		CYD_I2S_REALTIME=0 turns the clock off and runs as fast as the host can decode.
+ * 		Internal DAC data (unsigned, 0x8000 bias) is written to the WAV as signed PCM.
+ */
+
+typedef enum
+{
+	I2S_NUM_0 = 0,
+	I2S_NUM_1 = 1,
+	I2S_NUM_MAX
+} i2s_port_t;
+
+typedef enum
+{
+	I2S_MODE_MASTER = (1 << 0),
+	I2S_MODE_SLAVE = (1 << 1),
+	I2S_MODE_TX = (1 << 2),
+	I2S_MODE_RX = (1 << 3),
+	I2S_MODE_DAC_BUILT_IN = (1 << 4),
+	I2S_MODE_ADC_BUILT_IN = (1 << 5),
+	I2S_MODE_PDM = (1 << 6)
+} i2s_mode_t;
+
+typedef enum
+{
+	I2S_BITS_PER_SAMPLE_8BIT = 8,
+	I2S_BITS_PER_SAMPLE_16BIT = 16,
+	I2S_BITS_PER_SAMPLE_24BIT = 24,
+	I2S_BITS_PER_SAMPLE_32BIT = 32
+} i2s_bits_per_sample_t;
+
+typedef enum
+{
+	I2S_CHANNEL_FMT_RIGHT_LEFT = 0,
+	I2S_CHANNEL_FMT_ALL_RIGHT,
+	I2S_CHANNEL_FMT_ALL_LEFT,
+	I2S_CHANNEL_FMT_ONLY_RIGHT,
+	I2S_CHANNEL_FMT_ONLY_LEFT
+} i2s_channel_fmt_t;
+
+typedef enum
+{
+	I2S_COMM_FORMAT_STAND_I2S = 0x01,
+	I2S_COMM_FORMAT_STAND_MSB = 0x03,
+	I2S_COMM_FORMAT_STAND_PCM_SHORT = 0x04,
+	I2S_COMM_FORMAT_STAND_PCM_LONG = 0x0C,
+	I2S_COMM_FORMAT_I2S = 0x01,
+	I2S_COMM_FORMAT_I2S_MSB = 0x01,
+	I2S_COMM_FORMAT_I2S_LSB = 0x02
+} i2s_comm_format_t;
+
+typedef enum
+{
+	I2S_DAC_CHANNEL_DISABLE = 0,
+	I2S_DAC_CHANNEL_RIGHT_EN = 1,
+	I2S_DAC_CHANNEL_LEFT_EN = 2,
+	I2S_DAC_CHANNEL_BOTH_EN = 0x3,
+	I2S_DAC_CHANNEL_MAX = 0x4
+} i2s_dac_mode_t;
+
+#define I2S_PIN_NO_CHANGE		(-1)
+#define ESP_INTR_FLAG_LEVEL1	(1 << 1)
+
+typedef struct
+{
+	i2s_mode_t mode;
+	uint32_t sample_rate;
+	i2s_bits_per_sample_t bits_per_sample;
+	i2s_channel_fmt_t channel_format;
+	i2s_comm_format_t communication_format;
+	int intr_alloc_flags;
+	int dma_buf_count;
+	int dma_buf_len;
+	bool use_apll;
+	bool tx_desc_auto_clear;
+	int fixed_mclk;
+} i2s_config_t;
+
+typedef struct
+{
+	int mck_io_num;
+	int bck_io_num;
+	int ws_io_num;
+	int data_out_num;
+	int data_in_num;
+} i2s_pin_config_t;
+
+esp_err_t i2s_driver_install(i2s_port_t i2s_num, const i2s_config_t *i2s_config, int queue_size, void *i2s_queue);
+esp_err_t i2s_driver_uninstall(i2s_port_t i2s_num);
+esp_err_t i2s_set_pin(i2s_port_t i2s_num, const i2s_pin_config_t *pin);
+esp_err_t i2s_set_dac_mode(i2s_dac_mode_t dac_mode);
+esp_err_t i2s_set_sample_rates(i2s_port_t i2s_num, uint32_t rate);
+esp_err_t i2s_start(i2s_port_t i2s_num);
+esp_err_t i2s_stop(i2s_port_t i2s_num);
+esp_err_t i2s_zero_dma_buffer(i2s_port_t i2s_num);
+esp_err_t i2s_write(i2s_port_t i2s_num, const void *src, size_t size, size_t *bytes_written, TickType_t ticks_to_wait);
+
+/**
+ * @brief Frames the sink has taken since the driver was installed
+ */
+uint64_t cydNativeI2SFrames(i2s_port_t i2s_num);
+
+/**
+ * @brief Simulated DMA clock of a port since the last reset: times the buffers ran dry
+ * 		and the least audio they still held when a write arrived (realtime clock only)
+ */
+typedef struct
+{
+	uint32_t underruns;
+	uint32_t lowWaterMs;
+} cydNativeI2SStats_t;
+
+void cydNativeI2SGetStats(i2s_port_t i2s_num, cydNativeI2SStats_t *stats);
+void cydNativeI2SResetStats(i2s_port_t i2s_num);
+
+// IO mux and peripheral registers, nothing to route on the host
+#define PERIPHS_IO_MUX_GPIO0_U	0
+#define PERIPHS_IO_MUX_U0TXD_U	0
+#define PERIPHS_IO_MUX_U0RXD_U	0
+#define FUNC_GPIO0_CLK_OUT1		0
+#define FUNC_U0TXD_CLK_OUT3		0
+#define FUNC_U0RXD_CLK_OUT2		0
+#define PIN_CTRL				0
+#define PIN_FUNC_SELECT(reg, func)	((void)(reg), (void)(func))
+#define WRITE_PERI_REG(addr, val)	((void)(addr), (void)(val))
+#define READ_PERI_REG(addr)			0
+#define SET_PERI_REG_MASK(reg, mask)	((void)(reg), (void)(mask))
+#define CLEAR_PERI_REG_MASK(reg, mask)	((void)(reg), (void)(mask))
+
+#endif // _CYD_NATIVE_DRIVER_I2S_H_
@@ -0,0 +1,36 @@
+#ifndef _CYD_NATIVE_ESP32_HAL_LOG_H_
+#define _CYD_NATIVE_ESP32_HAL_LOG_H_
+
+#include <stdio.h>
+
+/**
+ * @brief Core debug log on stderr, the level is set with -DCORE_DEBUG_LEVEL as on the target
+ */
+
+#define ARDUHAL_LOG_LEVEL_NONE		0
+#define ARDUHAL_LOG_LEVEL_ERROR		1
+#define ARDUHAL_LOG_LEVEL_WARN		2
+#define ARDUHAL_LOG_LEVEL_INFO		3
+#define ARDUHAL_LOG_LEVEL_DEBUG		4
+#define ARDUHAL_LOG_LEVEL_VERBOSE	5
+
+#ifndef CORE_DEBUG_LEVEL
+#define CORE_DEBUG_LEVEL ARDUHAL_LOG_LEVEL_ERROR
+#endif
+
+#define CYD_NATIVE_LOG(level, letter, format, ...) \
+	do { if (CORE_DEBUG_LEVEL >= level) fprintf(stderr, "[" letter "][%s:%d] %s(): " format "\n", __FILE__, __LINE__, __func__, ##__VA_ARGS__); } while (0)
+
+#define log_e(format, ...) CYD_NATIVE_LOG(ARDUHAL_LOG_LEVEL_ERROR, "E", format, ##__VA_ARGS__)
+#define log_w(format, ...) CYD_NATIVE_LOG(ARDUHAL_LOG_LEVEL_WARN, "W", format, ##__VA_ARGS__)
+#define log_i(format, ...) CYD_NATIVE_LOG(ARDUHAL_LOG_LEVEL_INFO, "I", format, ##__VA_ARGS__)
+#define log_d(format, ...) CYD_NATIVE_LOG(ARDUHAL_LOG_LEVEL_DEBUG, "D", format, ##__VA_ARGS__)
+#define log_v(format, ...) CYD_NATIVE_LOG(ARDUHAL_LOG_LEVEL_VERBOSE, "V", format, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, format, ...) log_e(format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) log_w(format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) log_i(format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) log_d(format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) log_v(format, ##__VA_ARGS__)
+
+#endif // _CYD_NATIVE_ESP32_HAL_LOG_H_
@@ -0,0 +1,6 @@
+#ifndef _CYD_NATIVE_ESP_DSP_H_
+#define _CYD_NATIVE_ESP_DSP_H_
+
+// esp-dsp is included by CYD_DSP.h but none of its functions are used
+
+#endif // _CYD_NATIVE_ESP_DSP_H_
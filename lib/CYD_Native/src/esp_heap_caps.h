@@ -0,0 +1,29 @@
+#ifndef _CYD_NATIVE_ESP_HEAP_CAPS_H_
+#define _CYD_NATIVE_ESP_HEAP_CAPS_H_
+
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdint.h>
+
+/**
+ * @brief Capability based allocation, every capability is served by malloc()
+ */
+
+#define MALLOC_CAP_EXEC			(1 << 0)
+#define MALLOC_CAP_32BIT		(1 << 1)
+#define MALLOC_CAP_8BIT			(1 << 2)
+#define MALLOC_CAP_DMA			(1 << 3)
+#define MALLOC_CAP_SPIRAM		(1 << 10)
+#define MALLOC_CAP_INTERNAL		(1 << 11)
+#define MALLOC_CAP_DEFAULT		(1 << 12)
+
+inline void *heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+inline void *heap_caps_calloc(size_t n, size_t size, uint32_t caps) { return calloc(n, size); }
+inline void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps) { return realloc(ptr, size); }
+inline void heap_caps_free(void *ptr) { free(ptr); }
+inline void *heap_caps_malloc_prefer(size_t size, size_t num, ...) { return malloc(size); }
+inline void *heap_caps_calloc_prefer(size_t n, size_t size, size_t num, ...) { return calloc(n, size); }
+inline size_t heap_caps_get_free_size(uint32_t caps) { return (caps & MALLOC_CAP_SPIRAM) ? 0 : 320 * 1024; }
+inline size_t heap_caps_get_largest_free_block(uint32_t caps) { return (caps & MALLOC_CAP_SPIRAM) ? 0 : 110 * 1024; }
+
+#endif // _CYD_NATIVE_ESP_HEAP_CAPS_H_
@@ -0,0 +1,57 @@
+#ifndef _CYD_NATIVE_ESP_PARTITION_H_
+#define _CYD_NATIVE_ESP_PARTITION_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_spi_flash.h"
+
+/**
+ * @brief Partition API without a flash: no partition is ever found, so the users take
+ * 		their "partition missing" path
+ */
+
+typedef enum
+{
+	ESP_PARTITION_TYPE_APP = 0x00,
+	ESP_PARTITION_TYPE_DATA = 0x01,
+	ESP_PARTITION_TYPE_ANY = 0xff
+} esp_partition_type_t;
+
+typedef enum
+{
+	ESP_PARTITION_SUBTYPE_DATA_NVS = 0x02,
+	ESP_PARTITION_SUBTYPE_DATA_FAT = 0x81,
+	ESP_PARTITION_SUBTYPE_DATA_SPIFFS = 0x82,
+	ESP_PARTITION_SUBTYPE_ANY = 0xff
+} esp_partition_subtype_t;
+
+typedef enum
+{
+	ESP_PARTITION_MMAP_DATA,
+	ESP_PARTITION_MMAP_INST
+} esp_partition_mmap_memory_t;
+
+typedef struct
+{
+	void *flash_chip;
+	esp_partition_type_t type;
+	esp_partition_subtype_t subtype;
+	uint32_t address;
+	uint32_t size;
+	char label[17];
+	bool encrypted;
+} esp_partition_t;
+
+inline const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char *label) { return nullptr; }
+inline esp_err_t esp_partition_read(const esp_partition_t *partition, size_t offset, void *dst, size_t size) { return ESP_ERR_NOT_FOUND; }
+inline esp_err_t esp_partition_write(const esp_partition_t *partition, size_t offset, const void *src, size_t size) { return ESP_ERR_NOT_FOUND; }
+inline esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) { return ESP_ERR_NOT_FOUND; }
+inline esp_err_t esp_partition_mmap(const esp_partition_t *partition, size_t offset, size_t size,
+									esp_partition_mmap_memory_t memory, const void **out, spi_flash_mmap_handle_t *handle)
+{
+	return ESP_ERR_NOT_FOUND;
+}
+
+#endif // _CYD_NATIVE_ESP_PARTITION_H_
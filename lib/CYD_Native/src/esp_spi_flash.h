@@ -0,0 +1,12 @@
+#ifndef _CYD_NATIVE_ESP_SPI_FLASH_H_
+#define _CYD_NATIVE_ESP_SPI_FLASH_H_
+
+#include <stdint.h>
+
+#define SPI_FLASH_SEC_SIZE 4096
+
+typedef uint32_t spi_flash_mmap_handle_t;
+
+inline void spi_flash_munmap(spi_flash_mmap_handle_t handle) {}
+
+#endif // _CYD_NATIVE_ESP_SPI_FLASH_H_
@@ -0,0 +1,40 @@
+#ifndef _CYD_NATIVE_FREERTOS_H_
+#define _CYD_NATIVE_FREERTOS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief FreeRTOS on host threads: a tick is 1 ms, tasks are std::threads, queues,
+ * 		semaphores and event groups block on condition variables. Priorities and core
+ * 		affinity are accepted and ignored.
+ */
+
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void (*TaskFunction_t)(void *);
+
+#define pdFALSE			((BaseType_t)0)
+#define pdTRUE			((BaseType_t)1)
+#define pdPASS			pdTRUE
+#define pdFAIL			pdFALSE
+#define errQUEUE_FULL	((BaseType_t)0)
+#define errQUEUE_EMPTY	((BaseType_t)0)
+
+#define portMAX_DELAY			((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS		((TickType_t)1)
+#define portTICK_RATE_MS		portTICK_PERIOD_MS
+#define configTICK_RATE_HZ		1000
+#define portPRIVILEGE_BIT		((UBaseType_t)0x00)
+#define tskNO_AFFINITY			((BaseType_t)0x7FFFFFFF)
+#define configMAX_PRIORITIES	25
+#define pdMS_TO_TICKS(ms)		((TickType_t)(ms))
+
+#define portENTER_CRITICAL(mux)	cydNativeCritical(true)
+#define portEXIT_CRITICAL(mux)	cydNativeCritical(false)
+#define portMUX_INITIALIZER_UNLOCKED 0
+typedef int portMUX_TYPE;
+void cydNativeCritical(bool enter);
+
+#endif // _CYD_NATIVE_FREERTOS_H_
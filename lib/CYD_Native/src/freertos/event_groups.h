@@ -0,0 +1,26 @@
+#ifndef _CYD_NATIVE_EVENT_GROUPS_H_
+#define _CYD_NATIVE_EVENT_GROUPS_H_
+
+#include "FreeRTOS.h"
+
+typedef struct cydNativeEventGroup *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+#define BIT0 (1u << 0)
+#define BIT1 (1u << 1)
+#define BIT2 (1u << 2)
+#define BIT3 (1u << 3)
+#define BIT4 (1u << 4)
+#define BIT5 (1u << 5)
+#define BIT6 (1u << 6)
+#define BIT7 (1u << 7)
+
+EventGroupHandle_t xEventGroupCreate();
+EventBits_t xEventGroupSetBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t group, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t group);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t group, EventBits_t bits, BaseType_t clearOnExit,
+								BaseType_t waitForAll, TickType_t ticks);
+void vEventGroupDelete(EventGroupHandle_t group);
+
+#endif // _CYD_NATIVE_EVENT_GROUPS_H_
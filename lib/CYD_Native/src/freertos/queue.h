@@ -0,0 +1,19 @@
+#ifndef _CYD_NATIVE_QUEUE_H_
+#define _CYD_NATIVE_QUEUE_H_
+
+#include "FreeRTOS.h"
+
+typedef struct cydNativeQueue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+void vQueueDelete(QueueHandle_t queue);
+#define xQueueSendToBack xQueueSend
+#define xQueueSendFromISR(queue, item, woken) xQueueSend(queue, item, 0)
+
+#endif // _CYD_NATIVE_QUEUE_H_
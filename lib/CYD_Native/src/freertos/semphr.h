@@ -0,0 +1,19 @@
+#ifndef _CYD_NATIVE_SEMPHR_H_
+#define _CYD_NATIVE_SEMPHR_H_
+
+#include "FreeRTOS.h"
+
+typedef struct cydNativeSemaphore *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+#define xSemaphoreGiveFromISR(sem, woken) xSemaphoreGive(sem)
+
+#endif // _CYD_NATIVE_SEMPHR_H_
@@ -0,0 +1,25 @@
+#ifndef _CYD_NATIVE_TASK_H_
+#define _CYD_NATIVE_TASK_H_
+
+#include "FreeRTOS.h"
+
+typedef struct cydNativeTask *TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameter,
+								   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t code, const char *name, uint32_t stackDepth, void *parameter,
+					   UBaseType_t priority, TaskHandle_t *handle);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+void xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+#define taskYIELD() vTaskDelay(0)
+
+// no interrupts on the host: the ISR variants are plain calls
+inline void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *higherPriorityTaskWoken) { xTaskNotifyGive(task); }
+#define portYIELD_FROM_ISR(...)
+
+#endif // _CYD_NATIVE_TASK_H_
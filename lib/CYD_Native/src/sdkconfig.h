@@ -0,0 +1,23 @@
+#ifndef _CYD_NATIVE_SDKCONFIG_H_
+#define _CYD_NATIVE_SDKCONFIG_H_
+
+/**
+ * @brief Target configuration the shim stands in for: a classic ESP32 (internal DAC)
+ * 		with the Arduino core 2.0 on ESP-IDF 4.4, no PSRAM
+ */
+
+#define CYD_NATIVE 1
+#define CONFIG_IDF_TARGET_ESP32 1
+#define CONFIG_FREERTOS_HZ 1000
+
+#define ESP_IDF_VERSION_MAJOR 4
+#define ESP_IDF_VERSION_MINOR 4
+#define ESP_IDF_VERSION_PATCH 0
+
+#define ESP_ARDUINO_VERSION_VAL(major, minor, patch) ((major << 16) | (minor << 8) | (patch))
+#define ESP_ARDUINO_VERSION_MAJOR 2
+#define ESP_ARDUINO_VERSION_MINOR 0
+#define ESP_ARDUINO_VERSION_PATCH 14
+#define ESP_ARDUINO_VERSION ESP_ARDUINO_VERSION_VAL(ESP_ARDUINO_VERSION_MAJOR, ESP_ARDUINO_VERSION_MINOR, ESP_ARDUINO_VERSION_PATCH)
+
+#endif // _CYD_NATIVE_SDKCONFIG_H_
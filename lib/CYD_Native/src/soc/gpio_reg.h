@@ -0,0 +1,19 @@
+#ifndef _CYD_NATIVE_SOC_GPIO_REG_H_
+#define _CYD_NATIVE_SOC_GPIO_REG_H_
+
+#include <stdint.h>
+
+/**
+ * @brief GPIO registers in host memory: code that bangs the pins directly runs, writes
+ * 		go nowhere and every input reads low
+ */
+extern volatile uint32_t cydNativeGpioRegs[6];
+
+#define GPIO_OUT_W1TS_REG	((uintptr_t)&cydNativeGpioRegs[0])
+#define GPIO_OUT_W1TC_REG	((uintptr_t)&cydNativeGpioRegs[1])
+#define GPIO_IN_REG			((uintptr_t)&cydNativeGpioRegs[2])
+#define GPIO_OUT1_W1TS_REG	((uintptr_t)&cydNativeGpioRegs[3])
+#define GPIO_OUT1_W1TC_REG	((uintptr_t)&cydNativeGpioRegs[4])
+#define GPIO_IN1_REG		((uintptr_t)&cydNativeGpioRegs[5])
+
+#endif // _CYD_NATIVE_SOC_GPIO_REG_H_
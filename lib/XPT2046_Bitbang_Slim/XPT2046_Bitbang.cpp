@@ -1,9 +1,26 @@
 #include "XPT2046_Bitbang.h"
+#include <soc/gpio_reg.h>
 
 
 XPT2046_Bitbang::XPT2046_Bitbang(uint8_t mosiPin, uint8_t misoPin, uint8_t clkPin, uint8_t csPin, uint16_t screenWidth, uint16_t screenHeight) : 
     _mosiPin(mosiPin), _misoPin(misoPin), _clkPin(clkPin), _csPin(csPin), _screenWidth(screenWidth), _screenHeight(screenHeight) {
     cal = TouchCalibration{0, 4095, 0, 4095};
+    stats = TouchStats{0, 0, 0, 0};
+}
+
+// Registers of a pin: GPIO 0-31 and 32-39 are in separate banks
+static void pinRegisters(uint8_t pin, volatile uint32_t **set, volatile uint32_t **clr, volatile uint32_t **in, uint32_t *mask) {
+    if (pin < 32) {
+        *set = (volatile uint32_t *)GPIO_OUT_W1TS_REG;
+        *clr = (volatile uint32_t *)GPIO_OUT_W1TC_REG;
+        *in = (volatile uint32_t *)GPIO_IN_REG;
+        *mask = 1UL << pin;
+    } else {
+        *set = (volatile uint32_t *)GPIO_OUT1_W1TS_REG;
+        *clr = (volatile uint32_t *)GPIO_OUT1_W1TC_REG;
+        *in = (volatile uint32_t *)GPIO_IN1_REG;
+        *mask = 1UL << (pin - 32);
+    }
 }
 
 void XPT2046_Bitbang::begin() {
@@ -13,22 +30,44 @@ void XPT2046_Bitbang::begin() {
     pinMode(_csPin, OUTPUT);
     digitalWrite(_csPin, HIGH);
     digitalWrite(_clkPin, LOW);
+
+    volatile uint32_t *unused;
+    pinRegisters(_mosiPin, &_mosiSet, &_mosiClr, &unused, &_mosiMask);
+    pinRegisters(_clkPin, &_clkSet, &_clkClr, &unused, &_clkMask);
+    pinRegisters(_csPin, &_csSet, &_csClr, &unused, &_csMask);
+    pinRegisters(_misoPin, &unused, &unused, &_misoIn, &_misoMask);
+
+    // Round up, the high and low times must not get shorter than the XPT2046 allows
+    _halfCycles = (getCpuFrequencyMhz() * 1000000UL + 2 * XPT2046_DCLK_HZ - 1) / (2 * XPT2046_DCLK_HZ);
+    stats = TouchStats{0, 0, 0, 0};
 }
 
 void XPT2046_Bitbang::setCalibration(uint16_t xMin, uint16_t xMax, uint16_t yMin, uint16_t yMax) {
     cal = TouchCalibration{xMin, xMax, yMin, yMax};
 }
 
+// Busy wait until half a DCLK period has passed since start, the pin writes count towards it
+inline void XPT2046_Bitbang::waitHalfClock(uint32_t start) {
+    while (ESP.getCycleCount() - start < _halfCycles) {
+    }
+}
+
 void XPT2046_Bitbang::writeSPI(byte command) {
     for(int i = 7; i >= 0; i--) {
-        digitalWrite(_mosiPin, command & (1 << i));
-        digitalWrite(_clkPin, LOW);
-        delayMicroseconds(DELAY);
-        digitalWrite(_clkPin, HIGH);
-        delayMicroseconds(DELAY);
+        uint32_t start = ESP.getCycleCount();
+        if (command & (1 << i)) {
+            *_mosiSet = _mosiMask;
+        } else {
+            *_mosiClr = _mosiMask;
+        }
+        *_clkClr = _clkMask;
+        waitHalfClock(start);
+        start = ESP.getCycleCount();
+        *_clkSet = _clkMask;
+        waitHalfClock(start);
     }
-    digitalWrite(_mosiPin, LOW);
-    digitalWrite(_clkPin, LOW);
+    *_mosiClr = _mosiMask;
+    *_clkClr = _clkMask;
 }
 
 uint16_t XPT2046_Bitbang::readSPI(byte command) {
@@ -37,31 +76,75 @@ uint16_t XPT2046_Bitbang::readSPI(byte command) {
     uint16_t result = 0;
 
     for(int i = 15; i >= 0; i--) {
-        digitalWrite(_clkPin, HIGH);
-        delayMicroseconds(DELAY);
-        digitalWrite(_clkPin, LOW);
-        delayMicroseconds(DELAY);
-        result |= (digitalRead(_misoPin) << i);
+        uint32_t start = ESP.getCycleCount();
+        *_clkSet = _clkMask;
+        waitHalfClock(start);
+        start = ESP.getCycleCount();
+        *_clkClr = _clkMask;
+        waitHalfClock(start);
+        if (*_misoIn & _misoMask) {
+            result |= 1 << i;
+        }
     }
 
     return result >> 4;
 }
 
+// Pressure estimate, the last command powers down with PENIRQ armed (PD bits cleared)
+uint16_t XPT2046_Bitbang::readZ() {
+    uint16_t z1 = readSPI(CMD_READ_Z1);
+    uint16_t z2 = readSPI(CMD_READ_Z2 & ~((byte)1));
+    return z1 + 4095 - z2;
+}
+
+// Median of a few samples (insertion sort), spread is max - min
+static uint16_t median(uint16_t *samples, uint8_t count, uint16_t *spread) {
+    for (uint8_t i = 1; i < count; i++) {
+        uint16_t v = samples[i];
+        uint8_t j = i;
+        for (; j > 0 && samples[j - 1] > v; j--) {
+            samples[j] = samples[j - 1];
+        }
+        samples[j] = v;
+    }
+    *spread = samples[count - 1] - samples[0];
+    return samples[count / 2];
+}
+
 TouchPoint XPT2046_Bitbang::getTouch() {
-    digitalWrite(_csPin, LOW);
+    uint32_t readStart = ESP.getCycleCount();
+    *_csClr = _csMask;
 
-    uint16_t z1 = readSPI(CMD_READ_Z1);
-    uint16_t z = z1 + 4095;
-    uint16_t z2 = readSPI(CMD_READ_Z2);
-    z -= z2;
+    uint16_t z = readZ();
+    if(z < XPT2046_Z_THRESHOLD) {
+        *_csSet = _csMask;
+        stats.readCycles = ESP.getCycleCount() - readStart;
+        return TouchPoint{0, 0, 0, 0, 0};
+    }
+
+    // Oversample both axes, the median drops the outliers resistive panels produce
+    uint16_t xSamples[XPT2046_SAMPLES];
+    uint16_t ySamples[XPT2046_SAMPLES];
+    for (uint8_t i = 0; i < XPT2046_SAMPLES; i++) {
+        xSamples[i] = readSPI(CMD_READ_X);
+        ySamples[i] = readSPI(CMD_READ_Y);
+    }
 
-    if(z < 100) {
+    // Pressure gate after the samples as well: a pen lifting or landing during the read
+    // gives phantom coordinates
+    uint16_t zEnd = readZ();
+    *_csSet = _csMask;
+    if (zEnd < XPT2046_Z_THRESHOLD) {
+        stats.rejected++;
+        stats.readCycles = ESP.getCycleCount() - readStart;
         return TouchPoint{0, 0, 0, 0, 0};
     }
+    z = (z + zEnd) / 2;
+
+    uint16_t xRaw = median(xSamples, XPT2046_SAMPLES, &stats.xSpread);
+    uint16_t yRaw = median(ySamples, XPT2046_SAMPLES, &stats.ySpread);
+    stats.readCycles = ESP.getCycleCount() - readStart;
 
-    uint16_t xRaw = readSPI(CMD_READ_X);
-    uint16_t yRaw = readSPI(CMD_READ_Y & ~((byte)1));
-    digitalWrite(_csPin, HIGH);
     // Rotate and map
     uint16_t x = map(xRaw, cal.xMin, cal.xMax, 0, _screenWidth);
     uint16_t y = map(yRaw, cal.yMin, cal.yMax, 0, _screenHeight);
@@ -8,7 +8,13 @@
 #define CMD_READ_Z1  0xB1 // Command for XPT2046 to read Z1 position
 #define CMD_READ_Z2  0xC1 // Command for XPT2046 to read Z2 position
 
-#define DELAY 5
+#define XPT2046_DCLK_MAX_HZ 2500000 // Datasheet limit of DCLK (200 ns high/low time)
+#define XPT2046_DCLK_HZ 2000000     // Bit-bang clock, some margin below the limit
+#define XPT2046_SAMPLES 5           // Samples per axis, the median is reported (odd, at most 15)
+#define XPT2046_Z_THRESHOLD 100     // Minimum pressure before and after the samples
+
+static_assert(XPT2046_DCLK_HZ <= XPT2046_DCLK_MAX_HZ, "XPT2046_DCLK_HZ is above the DCLK limit of the XPT2046");
+static_assert(XPT2046_SAMPLES % 2 == 1 && XPT2046_SAMPLES <= 15, "XPT2046_SAMPLES must be odd and at most 15");
 
 struct TouchPoint {
     uint16_t x;
@@ -18,6 +24,14 @@ struct TouchPoint {
     uint16_t zRaw;
 };
 
+// Cost and spread of the last getTouch(), for tuning the filter
+struct TouchStats {
+    uint32_t readCycles;   // CPU cycles of the whole read
+    uint16_t xSpread;      // Max - min of the raw X samples (jitter)
+    uint16_t ySpread;      // Max - min of the raw Y samples
+    uint16_t rejected;     // Touches rejected by the pressure gate since begin()
+};
+
 struct TouchCalibration {
     uint16_t xMin;
     uint16_t xMax;
@@ -31,6 +45,7 @@ class XPT2046_Bitbang {
         void begin();
         TouchPoint getTouch();
         void setCalibration(uint16_t xMin, uint16_t xMax, uint16_t yMin, uint16_t yMax);
+        const TouchStats& getStats() const { return stats; }
 
     private:
         uint8_t _mosiPin;
@@ -40,8 +55,15 @@ class XPT2046_Bitbang {
         uint16_t _screenWidth;
         uint16_t _screenHeight;
         TouchCalibration cal;
+        TouchStats stats;
+        // Set/clear and input registers of the pins, resolved once in begin()
+        volatile uint32_t *_mosiSet, *_mosiClr, *_clkSet, *_clkClr, *_csSet, *_csClr, *_misoIn;
+        uint32_t _mosiMask, _clkMask, _csMask, _misoMask;
+        uint32_t _halfCycles;  // CPU cycles per DCLK half period
+        inline void waitHalfClock(uint32_t start);
         void writeSPI(byte command);
         uint16_t readSPI(byte command);
+        uint16_t readZ();
 };
 
 #endif
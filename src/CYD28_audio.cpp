@@ -1,4 +1,6 @@
 #include "CYD28_audio.h"
+#include <freertos/event_groups.h>
+#include <atomic>
 
 CYD_Audio audio; 
 
@@ -8,10 +10,15 @@ void CreateQueues();
 //****************************************************************************************
 //                                   A U D I O _ T A S K                                 *
 //****************************************************************************************
-audioMessage_t audioTxMessage, audioRxMessage;
+#define AUDIO_READY_BIT BIT0
 
 QueueHandle_t audioSetQueue = NULL;
 QueueHandle_t audioGetQueue = NULL;
+SemaphoreHandle_t audioCmdMutex = NULL;		// one command/reply exchange at a time, callers run in several tasks
+EventGroupHandle_t audioEvents = NULL;		// AUDIO_READY_BIT set once the audio output is running
+uint32_t audioReadyMs = 0;					// time since boot when the output was ready
+static std::atomic<uint32_t> audioLevels(0);	// last output block levels, read without a queue round trip
+static std::atomic<bool> audioSounding(false);	// a clip or a voice played in the last loop, the same way
 // ---------------------------------------------------------------
 void CreateQueues()
 {
@@ -21,14 +28,24 @@ void CreateQueues()
 // ---------------------------------------------------------------
 void audioInit() 
 {
+	// created here so commands can be queued before the task is up, they are served once it is ready
+	CreateQueues();
+	audioCmdMutex = xSemaphoreCreateMutex();
+	audioEvents = xEventGroupCreate();
+	if (!audioSetQueue || !audioGetQueue || !audioCmdMutex || !audioEvents)
+	{
+		log_e("queues are not initialized");
+		while (true);
+	}
+
     xTaskCreatePinnedToCore(
         audioTask,             /* Function to implement the task */
         "audioplay",           /* Name of the task */
         10000,                  /* Stack size in words */
         NULL,                  /* Task input parameter */
-        2 | portPRIVILEGE_BIT, /* Priority of the task */
+        AUDIO_TASK_PRIORITY | portPRIVILEGE_BIT, /* Priority of the task */
         NULL,                  /* Task handle. */
-        0                      /* Core where the task should run */
+        AUDIO_TASK_CORE        /* Core where the task should run */
     );
 }
 // ---------------------------------------------------------------
@@ -41,16 +58,35 @@ void audioTask(void *parameter)
 #else
 	audio.begin(true, I2S_DAC_CHANNEL_LEFT_EN);
 #endif
-	CreateQueues();
-	if (!audioSetQueue || !audioGetQueue)
-	{
-		log_e("queues are not initialized");
-		while (true);
-	}
 	audioMessage_t audioRxTaskMessage;
 	audioMessage_t audioTxTaskMessage;
 	
 	audio.setVolume(21); // 0...21
+	audio.setOutputRate(AUDIO_OUTPUT_RATE);
+	audio.setLowCut(AUDIO_LOW_CUT_HZ);
+	audio.setTone(0, AUDIO_PRESENCE_DB, 0);
+#if AUDIO_EQ_BENCHMARK
+	{
+		uint32_t blockCycles, chainCycles;
+		audio.benchmarkEQ(&blockCycles, &chainCycles);	// coefficients for the output rate
+		log_i("EQ: block %u cycles, per-sample chain %u cycles per %u words", blockCycles, chainCycles, CYDAUDIO_DAC_BUF_SIZE);
+	}
+#endif
+#if AUDIO_RESAMPLER_BENCHMARK
+	{
+		const uint32_t rates[] = {22050, 48000, 16000};
+		const uint16_t outSamples = 1024;
+		for (uint32_t rate : rates)
+		{
+			uint32_t fir = CYD_resampler::benchmark(rate, 44100, true, outSamples);
+			uint32_t lin = CYD_resampler::benchmark(rate, 44100, false, outSamples);
+			log_i("Resampler %u -> 44100: polyphase %.1f, linear %.1f cycles per output sample",
+				  rate, (float)fir / outSamples, (float)lin / outSamples);
+		}
+	}
+#endif
+	audioReadyMs = millis();
+	xEventGroupSetBits(audioEvents, AUDIO_READY_BIT);
 
 	while (true)
 	{
@@ -61,6 +97,7 @@ void audioTask(void *parameter)
 				case IS_PLAYING:
 					audioTxTaskMessage.cmd = IS_PLAYING;
 					audioTxTaskMessage.ret = audio.isRunning();
+					audioTxTaskMessage.value = audio.voices().active();
 					xQueueSend(audioGetQueue, &audioTxTaskMessage, portMAX_DELAY);					
 					break;
 				case SET_VOLUME:
@@ -93,6 +130,29 @@ void audioTask(void *parameter)
 					audioTxTaskMessage.ret = audio.connecttoSD(audioRxTaskMessage.txt1);
 					xQueueSend(audioGetQueue, &audioTxTaskMessage, portMAX_DELAY);
 					break;
+				case CONNECTTOFLASH:
+					audioTxTaskMessage.cmd = CONNECTTOFLASH;
+					log_i("msg: %s (flash)", audioRxTaskMessage.txt1);
+					audioTxTaskMessage.ret = audio.connecttoFLASH(audioRxTaskMessage.data, audioRxTaskMessage.value, audioRxTaskMessage.txt1);
+					xQueueSend(audioGetQueue, &audioTxTaskMessage, portMAX_DELAY);
+					break;
+				case QUEUE_SD:
+					audioTxTaskMessage.cmd = QUEUE_SD;
+					audioTxTaskMessage.ret = audio.queueSD(audioRxTaskMessage.txt1);
+					xQueueSend(audioGetQueue, &audioTxTaskMessage, portMAX_DELAY);
+					break;
+				case SET_LOOP:
+					audioTxTaskMessage.cmd = SET_LOOP;
+					audioTxTaskMessage.ret = audio.setLoopPoints(audioRxTaskMessage.value, audioRxTaskMessage.loopEnd);
+					xQueueSend(audioGetQueue, &audioTxTaskMessage, portMAX_DELAY);
+					break;
+				case SET_LEVEL_METER:
+					audioTxTaskMessage.cmd = SET_LEVEL_METER;
+					audio.setLevelMeter(audioRxTaskMessage.value);
+					if (!audioRxTaskMessage.value) setVuMeters(0);
+					audioTxTaskMessage.ret = 1;
+					xQueueSend(audioGetQueue, &audioTxTaskMessage, portMAX_DELAY);
+					break;
 				case CONNECTTOSPEECH:
 					audioTxTaskMessage.cmd = CONNECTTOSPEECH;
 					audioTxTaskMessage.ret = audio.connecttospeech(audioRxTaskMessage.txt1, audioRxTaskMessage.txt2);
@@ -104,47 +164,133 @@ void audioTask(void *parameter)
 					audioTxTaskMessage.ret = 1;
 					xQueueSend(audioGetQueue, &audioTxTaskMessage, portMAX_DELAY);				
 					break;			
+				case PLAY_VOICE:
+					audioTxTaskMessage.cmd = PLAY_VOICE;
+					audioTxTaskMessage.ret = audio.playVoice((const int16_t *)audioRxTaskMessage.data, audioRxTaskMessage.value,
+															 audioRxTaskMessage.channels, audioRxTaskMessage.rate, audioRxTaskMessage.speed);
+					xQueueSend(audioGetQueue, &audioTxTaskMessage, portMAX_DELAY);
+					break;
+				case STOP_VOICES:
+					audioTxTaskMessage.cmd = STOP_VOICES;
+					if (audioRxTaskMessage.data) audio.voices().stopSource((const int16_t *)audioRxTaskMessage.data);
+					else audio.voices().stopAll();
+					audioTxTaskMessage.ret = 1;
+					xQueueSend(audioGetQueue, &audioTxTaskMessage, portMAX_DELAY);
+					break;
 				default:
 					log_i("Audio task: error");
 					break;
 			}
 		}
 		audio.loop();
-		if (!audio.isRunning())
+		bool sounding = audio.isRunning() || audio.voices().active();
+		audioSounding.store(sounding, std::memory_order_relaxed);
+		if (!sounding)
 		{
+			setVuMeters(0);
 			vTaskDelay(1);
 		}
 	}
 }
 // ---------------------------------------------------------------
+/**
+ * @brief Wait until the audio task has started the output
+ *
+ * @param timeoutMs maximum wait
+ * @return true audio is ready
+ */
+bool audioWaitReady(uint32_t timeoutMs)
+{
+	if (!audioEvents) return false;
+	return xEventGroupWaitBits(audioEvents, AUDIO_READY_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeoutMs)) & AUDIO_READY_BIT;
+}
+// ---------------------------------------------------------------
+/**
+ * @return time since boot in ms when audio became ready, 0 if it is not ready yet
+ */
+uint32_t audioReadyTime()
+{
+	return audioReadyMs;
+}
+// ---------------------------------------------------------------
 audioMessage_t transmitReceive(audioMessage_t msg)
 {
+	audioMessage_t reply = {};
+	xSemaphoreTake(audioCmdMutex, portMAX_DELAY);
 	xQueueSend(audioSetQueue, &msg, portMAX_DELAY);
-	if (xQueueReceive(audioGetQueue, &audioRxMessage, portMAX_DELAY) == pdPASS)
+	if (xQueueReceive(audioGetQueue, &reply, portMAX_DELAY) == pdPASS)
 	{
-		if (msg.cmd != audioRxMessage.cmd)
+		if (msg.cmd != reply.cmd)
 		{
 			log_e("wrong reply from message queue");
 		}
 	}
-	return audioRxMessage;
+	xSemaphoreGive(audioCmdMutex);
+	return reply;
 }
 // ---------------------------------------------------------------
 bool audioIsPlaying(void)
 {
+	audioMessage_t audioTxMessage = {};
 	audioTxMessage.cmd = IS_PLAYING;
 	audioMessage_t RX = transmitReceive(audioTxMessage);
 	return ((bool)RX.ret);
 }
 // ---------------------------------------------------------------
+/**
+ * @brief A clip or a voice is playing
+ */
+bool audioIsSounding(void)
+{
+	audioMessage_t audioTxMessage = {};
+	audioTxMessage.cmd = IS_PLAYING;
+	audioMessage_t RX = transmitReceive(audioTxMessage);
+	return RX.ret || RX.value;
+}
+// ---------------------------------------------------------------
 void audioStopSong()
 {
+	audioMessage_t audioTxMessage = {};
 	audioTxMessage.cmd = AUDIO_STOP;
 	audioMessage_t RX = transmitReceive(audioTxMessage);
 }
 // ---------------------------------------------------------------
+/**
+ * @brief Start a sound effect, mixed over the playing clip
+ *
+ * @param pcm interleaved 16 bit samples, must stay valid until the voice ends or
+ * 		audioStopVoices() returned
+ * @param speed playback speed and pitch, 1.0 = native
+ * @return voice number, -1 if the data can not be played
+ */
+int8_t audioPlayVoice(const int16_t *pcm, uint32_t frames, uint8_t channels, uint32_t rate, float speed)
+{
+	audioMessage_t audioTxMessage = {};
+	audioTxMessage.cmd = PLAY_VOICE;
+	audioTxMessage.data = (const uint8_t *)pcm;
+	audioTxMessage.value = frames;
+	audioTxMessage.channels = channels;
+	audioTxMessage.rate = rate;
+	audioTxMessage.speed = speed;
+	audioMessage_t RX = transmitReceive(audioTxMessage);
+	return (int8_t)RX.ret;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Stop the voices playing the given data, all voices for nullptr.
+ * 		The data may be freed once this returned.
+ */
+void audioStopVoices(const int16_t *pcm)
+{
+	audioMessage_t audioTxMessage = {};
+	audioTxMessage.cmd = STOP_VOICES;
+	audioTxMessage.data = (const uint8_t *)pcm;
+	transmitReceive(audioTxMessage);
+}
+// ---------------------------------------------------------------
 void audioSetVolume(uint8_t vol)
 {
+	audioMessage_t audioTxMessage = {};
 	audioTxMessage.cmd = SET_VOLUME;
 	audioTxMessage.value = vol;
 	audioMessage_t RX = transmitReceive(audioTxMessage);
@@ -153,6 +299,7 @@ void audioSetVolume(uint8_t vol)
 // value scaled to 0-100% range
 uint8_t audioGetVolumePerCent()
 {
+	audioMessage_t audioTxMessage = {};
 	audioTxMessage.cmd = GET_VOLUME;
 	audioMessage_t RX = transmitReceive(audioTxMessage);
 	uint16_t vol = (RX.ret >> 16) & 0xFF;
@@ -162,6 +309,7 @@ uint8_t audioGetVolumePerCent()
 // ---------------------------------------------------------------
 uint32_t audioGetRMS()
 {
+	audioMessage_t audioTxMessage = {};
 	audioTxMessage.cmd = GET_RMS;
 	audioMessage_t RX = transmitReceive(audioTxMessage);
 	return RX.ret;
@@ -169,6 +317,7 @@ uint32_t audioGetRMS()
 // ---------------------------------------------------------------
 bool audioConnecttohost(const char *host)
 {
+	audioMessage_t audioTxMessage = {};
 	audioTxMessage.cmd = CONNECTTOHOST;
 	audioTxMessage.txt1 = host;
 	audioMessage_t RX = transmitReceive(audioTxMessage);
@@ -177,18 +326,123 @@ bool audioConnecttohost(const char *host)
 // ---------------------------------------------------------------
 bool audioConnecttoSD(const char *filename)
 {
+	audioMessage_t audioTxMessage = {};
 	audioTxMessage.cmd = CONNECTTOSD;
 	audioTxMessage.txt1 = filename;
 	audioMessage_t RX = transmitReceive(audioTxMessage);
 	return RX.ret;
 }
 // ---------------------------------------------------------------
+bool audioConnecttoFlash(const uint8_t *data, uint32_t length, const char *filename)
+{
+	audioMessage_t audioTxMessage = {};
+	audioTxMessage.cmd = CONNECTTOFLASH;
+	audioTxMessage.txt1 = filename;
+	audioTxMessage.data = data;
+	audioTxMessage.value = length;
+	audioMessage_t RX = transmitReceive(audioTxMessage);
+	return RX.ret;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Append a file to the gapless sequence after the playing clip.
+ * 		A new clip or audioStopSong() clears the sequence.
+ */
+bool audioQueueSD(const char *filename)
+{
+	audioMessage_t audioTxMessage = {};
+	audioTxMessage.cmd = QUEUE_SD;
+	audioTxMessage.txt1 = filename;
+	audioMessage_t RX = transmitReceive(audioTxMessage);
+	return RX.ret;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Loop the next clip sample-exact from startFrame to endFrame (0 = end of file)
+ * 		until it is stopped, send it right before audioConnecttoSD()/audioConnecttoFlash()
+ */
+bool audioSetLoop(uint32_t startFrame, uint32_t endFrame)
+{
+	audioMessage_t audioTxMessage = {};
+	audioTxMessage.cmd = SET_LOOP;
+	audioTxMessage.value = startFrame;
+	audioTxMessage.loopEnd = endFrame;
+	audioMessage_t RX = transmitReceive(audioTxMessage);
+	return RX.ret;
+}
+// ---------------------------------------------------------------
 bool audioConnecttoSpeech(const char *host, const char *lang)
 {
+	audioMessage_t audioTxMessage = {};
 	audioTxMessage.cmd = CONNECTTOSPEECH;
 	audioTxMessage.txt1 = host;
 	audioTxMessage.txt2 = lang;
 	audioMessage_t RX = transmitReceive(audioTxMessage);
 	return RX.ret;
 }
-// ---------------------------------------------------------------
\ No newline at end of file
+// ---------------------------------------------------------------
+/**
+ * @brief Level hook of CYD_Audio, called by the audio task once per output block
+ */
+void audio_levels(uint32_t levels)
+{
+	setVuMeters(levels);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Publish the output levels, a single atomic store: no lock, no queue message
+ *
+ * @param vuRL peakL << 24 | peakR << 16 | rmsL << 8 | rmsR, 0-255 of full scale
+ */
+void setVuMeters(uint32_t vuRL)
+{
+	audioLevels.store(vuRL, std::memory_order_relaxed);
+}
+// ---------------------------------------------------------------
+/**
+ * @return last levels published by setVuMeters(), safe to call from any task
+ */
+uint32_t audioGetLevels()
+{
+	return audioLevels.load(std::memory_order_relaxed);
+}
+// ---------------------------------------------------------------
+/**
+ * @return a clip or a voice played in the last audio task loop, published next to the
+ * 		levels: safe to call from any task, unlike audioIsSounding() it costs the audio
+ * 		task nothing but may lag one loop behind a command
+ */
+bool audioGetSounding()
+{
+	return audioSounding.load(std::memory_order_relaxed);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Switch the level computation in the audio task on or off
+ */
+void audioSetLevelMeter(bool enable)
+{
+	audioMessage_t audioTxMessage = {};
+	audioTxMessage.cmd = SET_LEVEL_METER;
+	audioTxMessage.value = enable;
+	transmitReceive(audioTxMessage);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Name and CPU cycles since boot of every output pipeline stage.
+ * 		Read directly: the stage list is fixed once the audio task runs.
+ *
+ * @return number of stages filled in
+ */
+uint8_t audioGetDspStats(const char **names, uint32_t *cycles, uint8_t maxStages)
+{
+	CYD_pipeline &pipeline = audio.pipeline();
+	uint8_t n = min(pipeline.count(), maxStages);
+	for (uint8_t i = 0; i < n; i++)
+	{
+		names[i] = pipeline.stage(i)->name();
+		cycles[i] = pipeline.stage(i)->cycles;
+	}
+	return n;
+}
+// ---------------------------------------------------------------
@@ -3,6 +3,14 @@
 
 #include "CYD_Audio.h"
 
+#define AUDIO_TASK_CORE 0		// core reserved for audio, the UI runs on the other one
+#define AUDIO_TASK_PRIORITY 2
+#define AUDIO_LOW_CUT_HZ 150	// high pass in front of the small CYD speaker, 0 = off
+#define AUDIO_PRESENCE_DB 4		// tone filter boost around 3 kHz for clearer speech, 0 = flat
+#define AUDIO_EQ_BENCHMARK 0	// log the block EQ against the per-sample filter chain at startup
+#define AUDIO_OUTPUT_RATE 44100	// I2S rate, clips at other rates are resampled, 0 = I2S follows each clip
+#define AUDIO_RESAMPLER_BENCHMARK 0	// log the resampler cost for common rates at startup
+
 /**
  * @brief Audio taks commands
  */
@@ -15,7 +23,13 @@ typedef enum : uint8_t
 	CONNECTTOHOST,
 	CONNECTTOSPEECH,
 	CONNECTTOSD,
-	AUDIO_STOP
+	CONNECTTOFLASH,
+	AUDIO_STOP,
+	PLAY_VOICE,
+	STOP_VOICES,
+	QUEUE_SD,
+	SET_LOOP,
+	SET_LEVEL_METER
 }audioCmd_t;
 
 /**
@@ -26,23 +40,40 @@ typedef struct
 	audioCmd_t cmd;
 	const char *txt1;
 	const char *txt2;
+	const uint8_t *data;
 	uint32_t value;
+	uint32_t rate;			// PLAY_VOICE: sample rate of data
+	uint8_t channels;		// PLAY_VOICE: channels of data
+	float speed;			// PLAY_VOICE: playback speed, 1.0 = native
+	uint32_t loopEnd;		// SET_LOOP: frame after the window, 0 = end of file (start in value)
 	uint32_t ret;
 } audioMessage_t;
 
 extern CYD_Audio audio;
 
 void audioInit();
+bool audioWaitReady(uint32_t timeoutMs);
+uint32_t audioReadyTime();
 audioMessage_t transmitReceive(audioMessage_t msg);
 
 bool audioIsPlaying(void);
+bool audioIsSounding(void);
 void audioSetVolume(uint8_t vol);
 uint32_t audioGetRMS();
 uint8_t audioGetVolumePerCent();
 bool audioConnecttohost(const char *host);
 bool audioConnecttoSD(const char *filename);
+bool audioConnecttoFlash(const uint8_t *data, uint32_t length, const char *filename);
 bool audioConnecttoSpeech(const char *host, const char *lang);
+bool audioQueueSD(const char *filename);
+bool audioSetLoop(uint32_t startFrame, uint32_t endFrame);
 void audioStopSong();
+int8_t audioPlayVoice(const int16_t *pcm, uint32_t frames, uint8_t channels, uint32_t rate, float speed);
+void audioStopVoices(const int16_t *pcm = nullptr);
 void setVuMeters(uint32_t vuRL);
+uint32_t audioGetLevels();
+bool audioGetSounding();
+void audioSetLevelMeter(bool enable);
+uint8_t audioGetDspStats(const char **names, uint32_t *cycles, uint8_t maxStages);
 
 #endif // _AUDIO_H_
@@ -0,0 +1,393 @@
+#include "CYD28_bank.h"
+#include <SD.h>
+#include <esp_partition.h>
+#include <esp_spi_flash.h>
+#include <algorithm>
+
+#define BANK_PARTITION_LABEL "bank"
+#define BANK_MAGIC		0x42445943 	// "CYDB"
+#define BANK_VERSION	2
+#define BANK_SECTOR		SPI_FLASH_SEC_SIZE
+#define BANK_INDEX_SIZE	(2 * BANK_SECTOR)	// header + entry table + names
+#define BANK_COPY_CHUNK	BANK_SECTOR
+
+/**
+ * @brief Bank index header, stored at offset 0 of the partition
+ */
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t count;			// number of entries following the header
+	uint32_t bankHash;		// hash over all entry keys, unchanged banks are skipped
+	uint32_t eraseCount;	// lifetime number of erased sectors
+	uint32_t namesSize;		// bytes of file names following the entry table
+	uint32_t reserved[3];
+} bankHeader_t;
+
+/**
+ * @brief One clip in the bank
+ */
+typedef struct
+{
+	uint32_t nameHash;		// hash of the file name, lookup key
+	uint32_t key;			// hash of name, size and mtime, detects changed files
+	uint32_t offset;		// data offset within the partition, sector aligned
+	uint32_t size;			// file size in bytes
+	uint16_t nameOffset;	// file name in the name table, not terminated
+	uint16_t nameLength;
+} bankEntry_t;
+
+static const esp_partition_t *bankPartition = nullptr;
+static bankHeader_t bankHeader;
+static std::vector<bankEntry_t> bankEntries;
+static std::vector<char> bankNames;			// name table of bankEntries
+static bankStats_t bankStats;
+static spi_flash_mmap_handle_t bankMapHandle = 0;
+static bool bankMapped = false;
+static void (*bankFlashEnter)() = nullptr;
+static void (*bankFlashLeave)() = nullptr;
+
+// ---------------------------------------------------------------
+static uint32_t fnv1a(const void *data, size_t len, uint32_t hash = 2166136261u)
+{
+	const uint8_t *p = (const uint8_t *)data;
+	while (len--)
+	{
+		hash ^= *p++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief The name hash only narrows the search, a clip is identified by its full name
+ */
+static bool bankEntryIs(const bankEntry_t &e, const String &name)
+{
+	return e.nameLength == name.length() && memcmp(bankNames.data() + e.nameOffset, name.c_str(), e.nameLength) == 0;
+}
+// ---------------------------------------------------------------
+static void flashEnter()
+{
+	if (bankFlashEnter) bankFlashEnter();
+}
+// ---------------------------------------------------------------
+static void flashLeave()
+{
+	if (bankFlashLeave) bankFlashLeave();
+}
+// ---------------------------------------------------------------
+static inline uint32_t sectorAlign(uint32_t size)
+{
+	return (size + BANK_SECTOR - 1) & ~(BANK_SECTOR - 1);
+}
+// ---------------------------------------------------------------
+static bool bankErase(uint32_t offset, uint32_t size)
+{
+	// one sector per guard, so playback waits at most one erase
+	for (uint32_t done = 0; done < sectorAlign(size); done += BANK_SECTOR)
+	{
+		flashEnter();
+		bool ok = esp_partition_erase_range(bankPartition, offset + done, BANK_SECTOR) == ESP_OK;
+		flashLeave();
+		if (!ok) return false;
+		bankStats.sectorsErased++;
+	}
+	return true;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Find a free, sector aligned range in the data area (first fit)
+ *
+ * @param used entries already placed in the bank
+ * @param size requested size in bytes
+ * @param offset found offset
+ * @return true if enough space was found
+ */
+static bool bankAllocate(std::vector<bankEntry_t> &used, uint32_t size, uint32_t *offset)
+{
+	std::sort(used.begin(), used.end(), [](const bankEntry_t &a, const bankEntry_t &b) { return a.offset < b.offset; });
+	uint32_t need = sectorAlign(size);
+	uint32_t start = BANK_INDEX_SIZE;
+	for (const auto &e : used)
+	{
+		if (e.offset >= start + need) break;
+		start = std::max(start, e.offset + sectorAlign(e.size));
+	}
+	if (start + need > bankPartition->size) return false;
+	*offset = start;
+	return true;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Copy one file from the SD card into already erased flash
+ */
+static bool bankCopyFile(const String &path, uint32_t offset, uint32_t size, uint8_t *buf)
+{
+	File file = SD.open(path);
+	if (!file) return false;
+	uint32_t done = 0;
+	while (done < size)
+	{
+		size_t len = file.read(buf, std::min((uint32_t)BANK_COPY_CHUNK, size - done));
+		if (len == 0) break;
+		flashEnter();
+		bool ok = esp_partition_write(bankPartition, offset + done, buf, len) == ESP_OK;
+		flashLeave();
+		if (!ok) break;
+		done += len;
+	}
+	file.close();
+	bankStats.bytesWritten += done;
+	return done == size;
+}
+// ---------------------------------------------------------------
+void bankSetFlashGuard(void (*enter)(), void (*leave)())
+{
+	bankFlashEnter = enter;
+	bankFlashLeave = leave;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Locate the bank partition and load its index
+ *
+ * @return true partition found (index may still be empty)
+ */
+bool bankInit()
+{
+	bankPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, BANK_PARTITION_LABEL);
+	if (!bankPartition)
+	{
+		Serial.println("Bank mirror: no \"" BANK_PARTITION_LABEL "\" partition, mirror disabled");
+		return false;
+	}
+	bankEntries.clear();
+	bankNames.clear();
+	memset(&bankHeader, 0, sizeof(bankHeader));
+	esp_partition_read(bankPartition, 0, &bankHeader, sizeof(bankHeader));
+	if (bankHeader.magic != BANK_MAGIC || bankHeader.version != BANK_VERSION ||
+		sizeof(bankHeader) + bankHeader.count * sizeof(bankEntry_t) + bankHeader.namesSize > BANK_INDEX_SIZE)
+	{
+		uint32_t eraseCount = (bankHeader.magic == BANK_MAGIC) ? bankHeader.eraseCount : 0;
+		memset(&bankHeader, 0, sizeof(bankHeader));
+		bankHeader.eraseCount = eraseCount;
+		return true;
+	}
+	bankEntries.resize(bankHeader.count);
+	bankNames.resize(bankHeader.namesSize);
+	esp_partition_read(bankPartition, sizeof(bankHeader), bankEntries.data(), bankHeader.count * sizeof(bankEntry_t));
+	esp_partition_read(bankPartition, sizeof(bankHeader) + bankHeader.count * sizeof(bankEntry_t), bankNames.data(), bankNames.size());
+	for (const auto &e : bankEntries)
+	{
+		if (e.nameOffset + e.nameLength > bankNames.size())
+		{
+			// damaged index, the next sync rebuilds the bank
+			bankEntries.clear();
+			bankNames.clear();
+			bankHeader.bankHash = 0;
+			bankHeader.count = 0;
+			return true;
+		}
+	}
+	Serial.println("Bank mirror: " + String(bankHeader.count) + " clips in " + String(bankPartition->size / 1024) + " kB partition");
+	return true;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Bring the bank up to date with the given list of files (root of the SD card).
+ * 		Only new or changed files are written, nothing is touched if the bank hash matches.
+ *
+ * @param files file names in button order
+ * @return true bank is valid
+ */
+bool bankSync(const std::vector<String> &files)
+{
+	if (!bankPartition) return false;
+
+	uint32_t t0 = millis();
+	memset(&bankStats, 0, sizeof(bankStats));
+
+	// describe the wanted content: name hash + key (name, size, mtime) per file, as many
+	// as the index holds with their names
+	std::vector<bankEntry_t> wanted;
+	std::vector<const String *> wantedNames;
+	uint32_t bankHash = fnv1a(&bankPartition->size, sizeof(bankPartition->size));
+	uint32_t indexUsed = sizeof(bankHeader_t);
+	for (const auto &name : files)
+	{
+		if (indexUsed + sizeof(bankEntry_t) + name.length() > BANK_INDEX_SIZE) break;
+		File file = SD.open("/" + name);
+		if (!file) continue;
+		bankEntry_t e = {};
+		e.nameHash = fnv1a(name.c_str(), name.length());
+		e.size = file.size();
+		time_t mtime = file.getLastWrite();
+		file.close();
+		e.key = fnv1a(&e.size, sizeof(e.size), e.nameHash);
+		e.key = fnv1a(&mtime, sizeof(mtime), e.key);
+		bankHash = fnv1a(&e.key, sizeof(e.key), bankHash);
+		e.nameLength = name.length();
+		wanted.push_back(e);
+		wantedNames.push_back(&name);
+		indexUsed += sizeof(bankEntry_t) + name.length();
+	}
+
+	if (bankHeader.magic == BANK_MAGIC && bankHeader.bankHash == bankHash && bankHeader.count == wanted.size())
+	{
+		bankStats.unchanged = true;
+		bankStats.filesTotal = bankEntries.size();
+		bankStats.eraseCountTotal = bankHeader.eraseCount;
+		bankStats.copyTimeMs = millis() - t0;
+		Serial.println("Bank mirror unchanged, " + String(bankStats.filesTotal) + " clips, check took " + String(bankStats.copyTimeMs) + " ms");
+		return true;
+	}
+
+	// keep clips whose key did not change, they stay where they are
+	std::vector<bankEntry_t> placed;
+	std::vector<bool> keep(wanted.size(), false);
+	std::vector<bool> stored(wanted.size(), false);
+	for (size_t i = 0; i < wanted.size(); i++)
+	{
+		for (const auto &old : bankEntries)
+		{
+			if (old.key == wanted[i].key && bankEntryIs(old, *wantedNames[i]))
+			{
+				wanted[i].offset = old.offset;
+				placed.push_back(wanted[i]);
+				keep[i] = stored[i] = true;
+				break;
+			}
+		}
+	}
+
+	uint8_t *buf = (uint8_t *)malloc(BANK_INDEX_SIZE);
+	if (!buf)
+	{
+		Serial.println("Bank mirror: out of memory");
+		return false;
+	}
+
+	// drop the RAM index before the first erase: no clip may play from sectors that are
+	// about to be erased or reused. Until the new index is written clips play from SD.
+	flashEnter();
+	bankUnmapClip();
+	bankEntries.clear();
+	bankNames.clear();
+	flashLeave();
+
+	// invalidate the index first, an interrupted sync rebuilds the bank on the next boot
+	bankErase(0, BANK_INDEX_SIZE);
+
+	for (size_t i = 0; i < wanted.size(); i++)
+	{
+		if (keep[i]) continue;
+		uint32_t offset;
+		if (!bankAllocate(placed, wanted[i].size, &offset))
+		{
+			Serial.println("Bank mirror full, skipping: " + *wantedNames[i]);
+			continue;
+		}
+		wanted[i].offset = offset;
+		if (!bankErase(offset, wanted[i].size) || !bankCopyFile("/" + *wantedNames[i], offset, wanted[i].size, buf))
+		{
+			Serial.println("Bank mirror: copy failed: " + *wantedNames[i]);
+			continue;
+		}
+		placed.push_back(wanted[i]);
+		stored[i] = true;
+		bankStats.filesWritten++;
+	}
+
+	// write the new index, names behind the entry table
+	std::vector<bankEntry_t> entries;
+	std::vector<char> names;
+	for (size_t i = 0; i < wanted.size(); i++)
+	{
+		if (!stored[i]) continue;
+		wanted[i].nameOffset = names.size();
+		names.insert(names.end(), wantedNames[i]->c_str(), wantedNames[i]->c_str() + wanted[i].nameLength);
+		entries.push_back(wanted[i]);
+	}
+	bankHeader.magic = BANK_MAGIC;
+	bankHeader.version = BANK_VERSION;
+	bankHeader.count = entries.size();
+	// a partially built bank must not match next time
+	bankHeader.bankHash = (entries.size() == wanted.size()) ? bankHash : 0;
+	bankHeader.eraseCount += bankStats.sectorsErased;
+	bankHeader.namesSize = names.size();
+	memset(buf, 0xFF, BANK_INDEX_SIZE);
+	memcpy(buf, &bankHeader, sizeof(bankHeader));
+	memcpy(buf + sizeof(bankHeader), entries.data(), entries.size() * sizeof(bankEntry_t));
+	memcpy(buf + sizeof(bankHeader) + entries.size() * sizeof(bankEntry_t), names.data(), names.size());
+	// clips map from the new index only once it is in flash
+	flashEnter();
+	bool ok = esp_partition_write(bankPartition, 0, buf, BANK_INDEX_SIZE) == ESP_OK;
+	if (ok)
+	{
+		bankEntries.swap(entries);
+		bankNames.swap(names);
+	}
+	else
+	{
+		// the RAM index stays empty, the next sync must not take the bank as unchanged
+		bankHeader.bankHash = 0;
+		bankHeader.count = 0;
+	}
+	flashLeave();
+	free(buf);
+
+	bankStats.filesTotal = bankEntries.size();
+	bankStats.eraseCountTotal = bankHeader.eraseCount;
+	bankStats.copyTimeMs = millis() - t0;
+	Serial.println("Bank mirror updated: " + String(bankStats.filesWritten) + "/" + String(bankStats.filesTotal) +
+				   " clips copied, " + String(bankStats.bytesWritten) + " bytes in " + String(bankStats.copyTimeMs) + " ms");
+	Serial.println("Bank mirror wear: " + String(bankStats.sectorsErased) + " sectors erased, " +
+				   String(bankStats.eraseCountTotal) + " since partition creation");
+	return ok;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Map a mirrored clip into the address space. The previous mapping is released,
+ * 		so the caller must have stopped its playback.
+ *
+ * @param filename file name as found in the SD root
+ * @param length returns the clip size
+ * @return pointer to the clip data, nullptr if the clip is not in the bank (or bankSync()
+ * 		is rebuilding it)
+ */
+const uint8_t *bankMapClip(const String &filename, uint32_t *length)
+{
+	if (!bankPartition) return nullptr;
+	uint32_t nameHash = fnv1a(filename.c_str(), filename.length());
+	for (const auto &e : bankEntries)
+	{
+		if (e.nameHash != nameHash || !bankEntryIs(e, filename)) continue;
+		bankUnmapClip();
+		const void *ptr = nullptr;
+		if (esp_partition_mmap(bankPartition, e.offset, e.size, ESP_PARTITION_MMAP_DATA, &ptr, &bankMapHandle) != ESP_OK)
+		{
+			log_e("bank mmap failed");
+			return nullptr;
+		}
+		bankMapped = true;
+		*length = e.size;
+		return (const uint8_t *)ptr;
+	}
+	return nullptr;
+}
+// ---------------------------------------------------------------
+void bankUnmapClip()
+{
+	if (bankMapped)
+	{
+		spi_flash_munmap(bankMapHandle);
+		bankMapped = false;
+	}
+}
+// ---------------------------------------------------------------
+const bankStats_t *bankGetStats()
+{
+	return &bankStats;
+}
+// ---------------------------------------------------------------
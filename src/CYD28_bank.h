@@ -0,0 +1,43 @@
+#ifndef _CYD28_BANK_H_
+#define _CYD28_BANK_H_
+
+#include <Arduino.h>
+#include <vector>
+
+/**
+ * @brief Flash bank mirror: configured clips copied from the SD card into the
+ * 		"bank" data partition (see partitions.csv) and played memory mapped.
+ *
+ * Partition layout:
+ * 		[index: header + entry table, 2 sectors][clip data, each clip sector aligned]
+ */
+
+/**
+ * @brief Statistics of the last bankSync() run
+ */
+typedef struct
+{
+	uint32_t filesTotal;		// clips held by the mirror
+	uint32_t filesWritten;		// clips copied from SD during this run
+	uint32_t bytesWritten;		// bytes programmed into flash during this run
+	uint32_t sectorsErased;		// 4kB sectors erased during this run
+	uint32_t eraseCountTotal;	// sectors erased over the lifetime of the partition
+	uint32_t copyTimeMs;		// duration of the sync
+	bool unchanged;				// bank hash matched, flash was not touched
+} bankStats_t;
+
+/**
+ * @brief Called around every flash erase or write of bankSync(). The flash cache is off
+ * 		meanwhile and stalls both cores: enter() may wait until the audio is idle (or stop
+ * 		it) and keep playback from starting until leave(). bankSync() also swaps the RAM
+ * 		index inside the guard, so bankMapClip() must be called under the same lock.
+ */
+void bankSetFlashGuard(void (*enter)(), void (*leave)());
+
+bool bankInit();
+bool bankSync(const std::vector<String> &files);
+const uint8_t *bankMapClip(const String &filename, uint32_t *length);
+void bankUnmapClip();
+const bankStats_t *bankGetStats();
+
+#endif // _CYD28_BANK_H_
@@ -0,0 +1,75 @@
+#include "CYD28_display.h"
+#include <TFT_eSPI.h>
+#include <src/draw/sw/lv_draw_sw.h>
+
+#define DISPLAY_ROTATION 3		// landscape, flipped, as lv_tft_espi_create()
+
+static TFT_eSPI *displayTft = nullptr;
+
+// ---------------------------------------------------------------
+/**
+ * @brief Blocking flush, the same as lv_tft_espi's
+ */
+static void displayFlush(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+	uint32_t w = area->x2 - area->x1 + 1;
+	uint32_t h = area->y2 - area->y1 + 1;
+
+	displayTft->startWrite();
+	displayTft->setAddrWindow(area->x1, area->y1, w, h);
+	displayTft->pushColors((uint16_t *)px_map, w * h, true);
+	displayTft->endWrite();
+	lv_display_flush_ready(disp);
+}
+#ifdef ESP32_DMA
+// ---------------------------------------------------------------
+/**
+ * @brief Queue the transfer of a rendered area. The DMA sends the buffer as is, so the
+ * 		bytes are swapped in place. pushImageDMA() waits for the previous transfer only,
+ * 		LVGL renders into the other buffer while this one is being sent.
+ */
+static void displayFlushDma(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+	uint32_t w = area->x2 - area->x1 + 1;
+	uint32_t h = area->y2 - area->y1 + 1;
+
+	lv_draw_sw_rgb565_swap(px_map, w * h);
+	displayTft->pushImageDMA(area->x1, area->y1, w, h, (uint16_t const *)px_map);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Block on the SPI driver's transfer done result, the buffer is free afterwards
+ */
+static void displayFlushWait(lv_display_t *disp)
+{
+	displayTft->dmaWait();
+	lv_display_flush_ready(disp);
+}
+#endif
+// ---------------------------------------------------------------
+lv_display_t *displayCreateDma(uint32_t horRes, uint32_t verRes, void *buf1, void *buf2, uint32_t bufSize)
+{
+	lv_display_t *disp = lv_display_create(horRes, verRes);
+	if (!disp) return nullptr;
+
+	displayTft = new TFT_eSPI(horRes, verRes);
+	displayTft->begin();
+	displayTft->setRotation(DISPLAY_ROTATION);
+#ifdef ESP32_DMA
+	if (displayTft->initDMA())
+	{
+		// the DMA transfers need the chip select held low permanently,
+		// setAddrWindow() between the transfers waits for the previous one to finish
+		displayTft->startWrite();
+		lv_display_set_flush_cb(disp, displayFlushDma);
+		lv_display_set_flush_wait_cb(disp, displayFlushWait);
+		lv_display_set_buffers(disp, buf1, buf2, bufSize, LV_DISPLAY_RENDER_MODE_PARTIAL);
+		return disp;
+	}
+	log_w("TFT_eSPI DMA init failed, using the blocking flush");
+#endif
+	lv_display_set_flush_cb(disp, displayFlush);
+	lv_display_set_buffers(disp, buf1, nullptr, bufSize, LV_DISPLAY_RENDER_MODE_PARTIAL);
+	return disp;
+}
+// ---------------------------------------------------------------
@@ -0,0 +1,20 @@
+#ifndef _CYD28_DISPLAY_H_
+#define _CYD28_DISPLAY_H_
+
+#include <Arduino.h>
+#include <lvgl.h>
+
+/**
+ * @brief TFT_eSPI display flushed with DMA: LVGL renders into one buffer while the SPI
+ * 		sends the other. Kept out of the vendored LVGL driver (lv_tft_espi) so LVGL
+ * 		upgrades don't drop it. Without ESP32_DMA or if the DMA init fails the display
+ * 		falls back to the blocking flush of buf1 alone.
+ *
+ * @param buf1 first draw buffer, DMA capable memory
+ * @param buf2 second draw buffer, DMA capable memory
+ * @param bufSize size of one buffer in bytes
+ * @return the created display, nullptr if LVGL is out of memory
+ */
+lv_display_t *displayCreateDma(uint32_t horRes, uint32_t verRes, void *buf1, void *buf2, uint32_t bufSize);
+
+#endif // _CYD28_DISPLAY_H_
@@ -0,0 +1,865 @@
+#include "CYD28_library.h"
+#include <SD.h>
+#include <vector>
+#include <algorithm>
+
+#define LIBRARY_INDEX_EMPTY 0xFFFF
+#define LIBRARY_ARENA_MIN	1024		// first arena allocation, doubled when full
+#define LIBRARY_CACHE_MAGIC	0x4C445943	// "CYDL"
+#define LIBRARY_CACHE_VERSION 5
+#define LIBRARY_SEARCH_BITS	11			// gram buckets of the search index (2^n)
+#define LIBRARY_SEARCH_BUCKETS (1u << LIBRARY_SEARCH_BITS)
+#define LIBRARY_SEARCH_GRAMS 96			// grams per entry or query, longer texts are cut
+
+/**
+ * @brief Cache file header
+ */
+typedef struct
+{
+	uint32_t magic;
+	uint16_t version;
+	uint16_t entryCount;
+	libraryCacheKey_t key;
+	uint32_t arenaBytes;
+	uint16_t settingsSize;
+	uint16_t entrySize;		// sizeof(libraryEntry_t), guards against layout changes
+} libraryCacheHeader_t;
+
+static std::vector<libraryEntry_t> libraryEntries;
+static std::vector<uint16_t> libraryIndex;		// open addressing hash table of entry indices
+static std::vector<uint16_t> libraryButtons;	// entry indices in button order
+static uint16_t librarySlotsPerPage = 1;
+static libraryStats_t libraryStats;
+
+static char *arena = nullptr;					// NUL terminated strings back to back
+static uint32_t arenaSize = 0;
+static uint32_t arenaUsed = 0;
+static uint32_t arenaStrings = 0;				// distinct strings in the arena, sizes the intern table
+static std::vector<libraryStr_t> internIndex;	// open addressing hash table of arena offsets, 0 = empty
+
+static std::vector<uint32_t> searchStart;		// first posting of every gram bucket
+static std::vector<uint16_t> searchPostings;	// button positions, ascending within a bucket
+static bool searchValid = false;
+
+// ---------------------------------------------------------------
+static uint32_t fnv1a(const char *str, bool ignoreCase)
+{
+	uint32_t hash = 2166136261u;
+	while (*str)
+	{
+		hash ^= (uint8_t)(ignoreCase ? tolower(*str) : *str);
+		hash *= 16777619u;
+		str++;
+	}
+	return hash;
+}
+// ---------------------------------------------------------------
+static void internInsert(libraryStr_t str)
+{
+	uint32_t mask = internIndex.size() - 1;
+	uint32_t pos = fnv1a(arena + str, false) & mask;
+	while (internIndex[pos]) pos = (pos + 1) & mask;
+	internIndex[pos] = str;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Keep the intern table at most half full. It is dropped once the library is
+ * 		laid out and rebuilt from the arena if strings are added later.
+ */
+static void internReserve(uint32_t count)
+{
+	size_t size = internIndex.size();
+	if (size >= 2 * count) return;
+	if (size == 0) size = 64;
+	while (size < 2 * count) size *= 2;
+	internIndex.assign(size, 0);
+	for (uint32_t str = 1; str < arenaUsed; str += strlen(arena + str) + 1) internInsert(str);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Store a string in the arena, identical strings share one copy
+ *
+ * @return handle, 0 (empty string) if out of memory
+ */
+static libraryStr_t intern(const char *str)
+{
+	if (!str || !*str) return 0;
+	libraryStats.strings++;
+
+	internReserve(arenaStrings + 1);
+	uint32_t mask = internIndex.size() - 1;
+	uint32_t pos = fnv1a(str, false) & mask;
+	for (; internIndex[pos]; pos = (pos + 1) & mask)
+	{
+		if (strcmp(arena + internIndex[pos], str) == 0)
+		{
+			libraryStats.stringsShared++;
+			return internIndex[pos];
+		}
+	}
+
+	uint32_t len = strlen(str) + 1;
+	if (arenaUsed == 0) arenaUsed = 1;	// offset 0 is the empty string
+	if (arenaUsed + len > arenaSize)
+	{
+		uint32_t size = arenaSize ? arenaSize : LIBRARY_ARENA_MIN;
+		while (arenaUsed + len > size) size *= 2;
+		char *grown = (char *)realloc(arena, size);
+		if (!grown)
+		{
+			log_e("library string arena: out of memory");
+			return 0;
+		}
+		arena = grown;
+		arena[0] = 0;
+		arenaSize = size;
+	}
+	libraryStr_t handle = arenaUsed;
+	memcpy(arena + handle, str, len);
+	arenaUsed += len;
+	arenaStrings++;
+	internIndex[pos] = handle;
+	return handle;
+}
+// ---------------------------------------------------------------
+static void indexInsert(uint16_t entry)
+{
+	uint32_t mask = libraryIndex.size() - 1;
+	uint32_t pos = libraryEntries[entry].nameHash & mask;
+	while (libraryIndex[pos] != LIBRARY_INDEX_EMPTY) pos = (pos + 1) & mask;
+	libraryIndex[pos] = entry;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Keep the hash table at most half full, rehash all entries when it grows
+ */
+static void indexReserve(size_t count)
+{
+	size_t size = libraryIndex.size();
+	if (size >= 2 * count) return;
+	if (size == 0) size = 64;
+	while (size < 2 * count) size *= 2;
+	libraryIndex.assign(size, LIBRARY_INDEX_EMPTY);
+	for (size_t i = 0; i < libraryEntries.size(); i++) indexInsert(i);
+}
+// ---------------------------------------------------------------
+static int libraryAppend(libraryEntry_t &entry)
+{
+	if (libraryEntries.size() >= LIBRARY_INDEX_EMPTY) return -1;
+	entry.nameHash = fnv1a(libraryString(entry.filename), true);
+	entry.mark = true;		// touched by the current update pass
+	libraryEntries.push_back(entry);
+	indexReserve(libraryEntries.size());
+	indexInsert(libraryEntries.size() - 1);
+	return libraryEntries.size() - 1;
+}
+// ---------------------------------------------------------------
+void libraryClear()
+{
+	libraryEntries.clear();
+	libraryIndex.clear();
+	libraryButtons.clear();
+	internIndex.clear();
+	std::vector<uint32_t>().swap(searchStart);
+	std::vector<uint16_t>().swap(searchPostings);
+	searchValid = false;
+	free(arena);
+	arena = nullptr;
+	arenaSize = 0;
+	arenaUsed = 0;
+	arenaStrings = 0;
+	memset(&libraryStats, 0, sizeof(libraryStats));
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Button text of an unconfigured file: the name without extension
+ */
+static libraryStr_t fileLabel(const char *filename, libraryStr_t name)
+{
+	size_t len = strlen(filename);
+	if (len > 4 && (strcmp(filename + len - 4, ".mp3") == 0 || strcmp(filename + len - 4, ".MP3") == 0))
+	{
+		return intern(String(filename).substring(0, len - 4).c_str());
+	}
+	return name;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Add a configured clip, the file is not looked up yet
+ *
+ * @param order position in the config file, buttons are laid out in this order
+ * @return entry index, -1 if the library is full
+ */
+int libraryAddConfig(const char *filename, const char *label, const char *color, uint16_t order)
+{
+	libraryEntry_t entry = {};
+	entry.filename = intern(filename);
+	entry.label = intern(label);
+	entry.color = intern(color);
+	entry.order = order;
+	entry.style = -1;
+	entry.configured = true;
+	return libraryAppend(entry);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Add a file found on the card without configuration, it is labelled with its
+ * 		name without extension
+ *
+ * @return entry index, -1 if the library is full
+ */
+int libraryAddFile(const char *filename, uint32_t size)
+{
+	libraryEntry_t entry = {};
+	entry.filename = intern(filename);
+	entry.label = fileLabel(filename, entry.filename);
+	entry.size = size;
+	entry.style = -1;
+	entry.found = true;
+	return libraryAppend(entry);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Add a subdirectory, its button opens the folder as a bank
+ *
+ * @return entry index, -1 if the library is full
+ */
+int libraryAddFolder(const char *dirname)
+{
+	libraryEntry_t entry = {};
+	entry.filename = intern(dirname);
+	entry.label = entry.filename;
+	entry.style = -1;
+	entry.found = true;
+	entry.folder = true;
+	return libraryAppend(entry);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Look up an entry by file name (case insensitive)
+ *
+ * @return entry index, -1 if not in the library
+ */
+int libraryFind(const char *filename)
+{
+	if (libraryIndex.empty()) return -1;
+	uint32_t hash = fnv1a(filename, true);
+	uint32_t mask = libraryIndex.size() - 1;
+	for (uint32_t pos = hash & mask; libraryIndex[pos] != LIBRARY_INDEX_EMPTY; pos = (pos + 1) & mask)
+	{
+		const libraryEntry_t &entry = libraryEntries[libraryIndex[pos]];
+		if (!entry.removed && entry.nameHash == hash && strcasecmp(libraryString(entry.filename), filename) == 0) return libraryIndex[pos];
+	}
+	return -1;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Mark the configured entries of a file found on the card
+ *
+ * @param size file size in bytes
+ * @return true the file is configured (possibly on several buttons)
+ */
+bool libraryMarkFound(const char *filename, uint32_t size)
+{
+	if (libraryIndex.empty()) return false;
+	uint32_t hash = fnv1a(filename, true);
+	uint32_t mask = libraryIndex.size() - 1;
+	bool configured = false;
+	for (uint32_t pos = hash & mask; libraryIndex[pos] != LIBRARY_INDEX_EMPTY; pos = (pos + 1) & mask)
+	{
+		libraryEntry_t &entry = libraryEntries[libraryIndex[pos]];
+		if (entry.configured && !entry.removed && entry.nameHash == hash && strcasecmp(libraryString(entry.filename), filename) == 0)
+		{
+			entry.found = true;
+			entry.size = size;
+			configured = true;
+		}
+	}
+	return configured;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Start an update pass (config reload or directory rescan): clear the marks of
+ * 		all entries. Entries touched by the pass get marked, the rest is handled by
+ * 		libraryEndConfigUpdate() / librarySweepUnseen().
+ */
+void libraryMarkClear()
+{
+	for (auto &entry : libraryEntries) entry.mark = false;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Apply one line of a reloaded config: the entry of the file is updated in place,
+ * 		an unconfigured file becomes configured, a new file is appended
+ *
+ * @param changed set if the entry is new or its label, color or order changed
+ * @return entry index, -1 if the library is full
+ */
+int libraryUpdateConfig(const char *filename, const char *label, const char *color, uint16_t order, bool *changed)
+{
+	*changed = false;
+	int unconfigured = -1;
+	if (!libraryIndex.empty())
+	{
+		uint32_t hash = fnv1a(filename, true);
+		uint32_t mask = libraryIndex.size() - 1;
+		for (uint32_t pos = hash & mask; libraryIndex[pos] != LIBRARY_INDEX_EMPTY; pos = (pos + 1) & mask)
+		{
+			libraryEntry_t &entry = libraryEntries[libraryIndex[pos]];
+			if (entry.removed || entry.mark || entry.folder || entry.nameHash != hash || strcasecmp(libraryString(entry.filename), filename) != 0) continue;
+			if (!entry.configured)
+			{
+				unconfigured = libraryIndex[pos];
+				continue;
+			}
+			// interned strings are equal if their handles are
+			libraryStr_t newLabel = intern(label);
+			libraryStr_t newColor = intern(color);
+			*changed = entry.label != newLabel || entry.color != newColor || entry.order != order;
+			entry.label = newLabel;
+			entry.color = newColor;
+			entry.order = order;
+			entry.mark = true;
+			return libraryIndex[pos];
+		}
+	}
+
+	*changed = true;
+	if (unconfigured >= 0)
+	{
+		libraryEntry_t &entry = libraryEntries[unconfigured];
+		entry.label = intern(label);
+		entry.color = intern(color);
+		entry.order = order;
+		entry.configured = true;
+		entry.mark = true;
+		return unconfigured;
+	}
+	return libraryAddConfig(filename, label, color, order);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Finish a config reload: configured entries no longer in the config turn into
+ * 		unconfigured files if the file exists, otherwise they are removed
+ *
+ * @return number of changed entries
+ */
+int libraryEndConfigUpdate()
+{
+	int changes = 0;
+	for (auto &entry : libraryEntries)
+	{
+		if (!entry.configured || entry.removed || entry.mark) continue;
+		if (entry.found)
+		{
+			entry.configured = false;
+			entry.label = fileLabel(libraryString(entry.filename), entry.filename);
+			entry.color = 0;
+			entry.style = -1;
+			entry.speed = 0;
+			entry.pitchJitter = 0;
+			entry.loop = false;
+		}
+		else
+		{
+			entry.removed = true;
+		}
+		changes++;
+	}
+	return changes;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Set the voice options of a configured entry
+ *
+ * @param speed playback speed in 1/1000, 0 = the entry is played as a clip
+ * @param pitchJitter random speed change per trigger, +-%
+ * @return true the options changed
+ */
+bool librarySetVoice(int index, uint16_t speed, uint8_t pitchJitter)
+{
+	libraryEntry_t *entry = libraryGetEntry(index);
+	if (!entry || (entry->speed == speed && entry->pitchJitter == pitchJitter)) return false;
+	entry->speed = speed;
+	entry->pitchJitter = pitchJitter;
+	return true;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Set the loop window of a configured entry
+ *
+ * @param loop the clip repeats until it is stopped
+ * @param loopStart first frame of the window
+ * @param loopEnd frame after the window, 0 = end of file
+ * @return true the options changed
+ */
+bool librarySetLoop(int index, bool loop, uint32_t loopStart, uint32_t loopEnd)
+{
+	libraryEntry_t *entry = libraryGetEntry(index);
+	if (!entry || (entry->loop == loop && entry->loopStart == loopStart && entry->loopEnd == loopEnd)) return false;
+	entry->loop = loop;
+	entry->loopStart = loopStart;
+	entry->loopEnd = loopEnd;
+	return true;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Mark all entries of a file seen in the directory
+ *
+ * @return -1 file not in the library, otherwise the number of configured entries whose
+ * 		file was missing before
+ */
+int libraryMarkSeen(const char *filename)
+{
+	if (libraryIndex.empty()) return -1;
+	uint32_t hash = fnv1a(filename, true);
+	uint32_t mask = libraryIndex.size() - 1;
+	int result = -1;
+	for (uint32_t pos = hash & mask; libraryIndex[pos] != LIBRARY_INDEX_EMPTY; pos = (pos + 1) & mask)
+	{
+		libraryEntry_t &entry = libraryEntries[libraryIndex[pos]];
+		if (entry.removed || entry.nameHash != hash || strcasecmp(libraryString(entry.filename), filename) != 0) continue;
+		if (result < 0) result = 0;
+		if (!entry.found) result++;
+		entry.mark = true;
+	}
+	return result;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Finish a directory rescan: configured entries not seen lose their file,
+ * 		unconfigured entries not seen are removed
+ *
+ * @return number of changed entries
+ */
+int librarySweepUnseen()
+{
+	int changes = 0;
+	for (auto &entry : libraryEntries)
+	{
+		if (entry.removed || entry.mark) continue;
+		if (entry.configured && strchr(libraryString(entry.filename), LIBRARY_SEQUENCE_SEP)) continue;	// libraryCheckSequences()
+		if (!entry.configured)
+		{
+			entry.removed = true;
+			changes++;
+		}
+		else if (entry.found)
+		{
+			entry.found = false;
+			changes++;
+		}
+	}
+	return changes;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Update the found flag of the sequence entries from the files they list,
+ * 		after the directory was scanned
+ *
+ * @return number of changed entries
+ */
+int libraryCheckSequences()
+{
+	int changes = 0;
+	char part[256];
+	for (auto &entry : libraryEntries)
+	{
+		const char *name = libraryString(entry.filename);
+		if (entry.removed || !entry.configured || !strchr(name, LIBRARY_SEQUENCE_SEP)) continue;
+		bool found = true;
+		while (found && *name)
+		{
+			const char *end = strchr(name, LIBRARY_SEQUENCE_SEP);
+			size_t len = end ? end - name : strlen(name);
+			if (len >= sizeof(part)) len = sizeof(part) - 1;
+			memcpy(part, name, len);
+			part[len] = 0;
+			const libraryEntry_t *file = libraryGetEntry(libraryFind(part));
+			found = file && file->found;
+			name = end ? end + 1 : name + strlen(name);
+		}
+		if (entry.found != found)
+		{
+			entry.found = found;
+			changes++;
+		}
+	}
+	return changes;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Compute the button order: folders in scan order, configured clips that were
+ * 		found, in config order, then the unconfigured files in scan order. Removed entries
+ * 		are skipped. The string arena and the entry array are shrunk to their final size.
+ *
+ * @param slotsPerPage buttons on one page
+ * @param includeUnchecked also show configured clips not found (yet), for a first
+ * 		layout before the directory scan has run
+ */
+void libraryLayout(uint16_t slotsPerPage, bool includeUnchecked)
+{
+	librarySlotsPerPage = slotsPerPage ? slotsPerPage : 1;
+	libraryButtons.clear();
+	libraryButtons.reserve(libraryEntries.size());
+	for (size_t i = 0; i < libraryEntries.size(); i++)
+	{
+		if (libraryEntries[i].folder && !libraryEntries[i].removed) libraryButtons.push_back(i);
+	}
+	size_t folders = libraryButtons.size();
+	for (size_t i = 0; i < libraryEntries.size(); i++)
+	{
+		const libraryEntry_t &entry = libraryEntries[i];
+		if (entry.configured && !entry.removed && (entry.found || includeUnchecked)) libraryButtons.push_back(i);
+	}
+	// entries become configured in place on a config reload, so sort by config position
+	std::stable_sort(libraryButtons.begin() + folders, libraryButtons.end(),
+					 [](uint16_t a, uint16_t b) { return libraryEntries[a].order < libraryEntries[b].order; });
+	for (size_t i = 0; i < libraryEntries.size(); i++)
+	{
+		const libraryEntry_t &entry = libraryEntries[i];
+		if (!entry.configured && !entry.folder && !entry.removed) libraryButtons.push_back(i);
+	}
+
+	// freeze: the intern table is only needed while strings are added, the search index
+	// refers to button positions and is rebuilt on the next search
+	std::vector<libraryStr_t>().swap(internIndex);
+	std::vector<uint32_t>().swap(searchStart);
+	std::vector<uint16_t>().swap(searchPostings);
+	searchValid = false;
+	libraryEntries.shrink_to_fit();
+	libraryButtons.shrink_to_fit();
+	if (arena && arenaUsed < arenaSize)
+	{
+		char *shrunk = (char *)realloc(arena, arenaUsed);
+		if (shrunk)
+		{
+			arena = shrunk;
+			arenaSize = arenaUsed;
+		}
+	}
+
+	libraryStats.entries = libraryEntries.size();
+	libraryStats.entryBytes = libraryEntries.capacity() * sizeof(libraryEntry_t) +
+							  libraryIndex.size() * sizeof(uint16_t) + libraryButtons.capacity() * sizeof(uint16_t);
+	libraryStats.arenaBytes = arenaSize;
+	Serial.println("Library: " + String(libraryStats.entries) + " entries, " + String(libraryStats.entryBytes) +
+				   " bytes entries/index, " + String(libraryStats.arenaBytes) + " bytes strings (" +
+				   String(libraryStats.stringsShared) + "/" + String(libraryStats.strings) + " shared)");
+	Serial.println("Heap after library build: " + String(heap_caps_get_free_size(MALLOC_CAP_8BIT)) + " free, largest block " +
+				   String(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT)));
+}
+// ---------------------------------------------------------------
+static inline bool isWordChar(char c)
+{
+	return isalnum((uint8_t)c);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Bucket of a gram: word prefixes of 1 and 2 characters and trigrams anywhere,
+ * 		the length is hashed in so the three kinds do not share buckets by design
+ */
+static inline uint16_t gramBucket(const char *str, uint8_t len)
+{
+	uint32_t hash = (2166136261u ^ len) * 16777619u;
+	for (uint8_t i = 0; i < len; i++)
+	{
+		hash ^= (uint8_t)tolower(str[i]);
+		hash *= 16777619u;
+	}
+	return (hash ^ (hash >> 16)) & (LIBRARY_SEARCH_BUCKETS - 1);
+}
+// ---------------------------------------------------------------
+static uint16_t textGrams(const char *text, size_t len, uint16_t *grams, uint16_t count)
+{
+	for (size_t i = 0; i < len && count < LIBRARY_SEARCH_GRAMS; i++)
+	{
+		if (isWordChar(text[i]) && (i == 0 || !isWordChar(text[i - 1])))
+		{
+			grams[count++] = gramBucket(text + i, 1);
+			if (i + 1 < len && count < LIBRARY_SEARCH_GRAMS) grams[count++] = gramBucket(text + i, 2);
+		}
+		if (i + 2 < len && count < LIBRARY_SEARCH_GRAMS) grams[count++] = gramBucket(text + i, 3);
+	}
+	return count;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Searchable length of a file name: without extension
+ */
+static size_t stemLength(const char *filename)
+{
+	const char *dot = strrchr(filename, '.');
+	return (dot && dot != filename) ? dot - filename : strlen(filename);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Distinct gram buckets of an entry: its label and, for configured clips, the
+ * 		file name (unconfigured files are labelled with their file name already)
+ */
+static uint16_t entryGrams(const libraryEntry_t &entry, uint16_t *grams)
+{
+	const char *label = libraryString(entry.label);
+	uint16_t count = textGrams(label, strlen(label), grams, 0);
+	if (entry.configured)
+	{
+		const char *filename = libraryString(entry.filename);
+		count = textGrams(filename, stemLength(filename), grams, count);
+	}
+	std::sort(grams, grams + count);
+	return std::unique(grams, grams + count) - grams;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Case insensitive match of the query in a text: as a substring, or for short
+ * 		queries at the start of a word
+ */
+static bool textMatch(const char *text, size_t textLen, const char *query, size_t len, bool wordStart)
+{
+	for (size_t i = 0; i + len <= textLen; i++)
+	{
+		if (wordStart && !(isWordChar(text[i]) && (i == 0 || !isWordChar(text[i - 1])))) continue;
+		if (strncasecmp(text + i, query, len) == 0) return true;
+	}
+	return false;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Build the search index over the laid out buttons: a bucketed gram index with
+ * 		one 16 bit posting (button position) per distinct gram of an entry. Counted
+ * 		first, then filled in place, so no temporary lists are needed.
+ */
+static void searchBuild()
+{
+	uint32_t t0 = micros();
+	uint16_t grams[LIBRARY_SEARCH_GRAMS];
+
+	// counts go to [bucket + 2], after the prefix sum [bucket + 1] is the fill cursor
+	// and ends up as the end of the bucket
+	searchStart.assign(LIBRARY_SEARCH_BUCKETS + 2, 0);
+	for (uint16_t entry : libraryButtons)
+	{
+		uint16_t count = entryGrams(libraryEntries[entry], grams);
+		for (uint16_t i = 0; i < count; i++) searchStart[grams[i] + 2]++;
+	}
+	for (uint32_t b = 2; b < searchStart.size(); b++) searchStart[b] += searchStart[b - 1];
+
+	searchPostings.assign(searchStart.back(), 0);
+	for (size_t pos = 0; pos < libraryButtons.size(); pos++)
+	{
+		uint16_t count = entryGrams(libraryEntries[libraryButtons[pos]], grams);
+		for (uint16_t i = 0; i < count; i++) searchPostings[searchStart[grams[i] + 1]++] = pos;
+	}
+	searchStart.pop_back();
+	searchValid = true;
+
+	Serial.println("Search index: " + String(searchPostings.size()) + " postings, " +
+				   String(searchPostings.size() * sizeof(uint16_t) + searchStart.size() * sizeof(uint32_t)) +
+				   " bytes, built in " + String(micros() - t0) + " us");
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Find the buttons whose label or file name contains the query (case insensitive).
+ * 		Queries of one or two characters match the start of a word. The index is built
+ * 		on the first search after a layout, an empty query only builds it.
+ *
+ * @param results entry indices of the matches in button order
+ * @param maxResults size of results
+ * @return number of matches, maxResults + 1 if there are more: the search stops there,
+ * 		so common queries cost no more than rare ones
+ */
+uint16_t librarySearch(const char *query, int *results, uint16_t maxResults)
+{
+	if (!searchValid) searchBuild();
+	size_t len = strlen(query);
+	if (len == 0 || libraryButtons.empty()) return 0;
+
+	// all grams of the query must be present, candidates come from the rarest one
+	uint16_t grams[LIBRARY_SEARCH_GRAMS];
+	uint16_t count = 0;
+	if (len < 3)
+	{
+		grams[count++] = gramBucket(query, len);
+	}
+	else
+	{
+		for (size_t i = 0; i + 3 <= len && count < LIBRARY_SEARCH_GRAMS; i++) grams[count++] = gramBucket(query + i, 3);
+	}
+	uint16_t rarest = grams[0];
+	for (uint16_t i = 1; i < count; i++)
+	{
+		if (searchStart[grams[i] + 1] - searchStart[grams[i]] < searchStart[rarest + 1] - searchStart[rarest]) rarest = grams[i];
+	}
+
+	uint16_t found = 0;
+	for (uint32_t p = searchStart[rarest]; p < searchStart[rarest + 1]; p++)
+	{
+		uint16_t pos = searchPostings[p];
+		bool candidate = true;
+		for (uint16_t i = 0; i < count && candidate; i++)
+		{
+			if (grams[i] == rarest) continue;
+			candidate = std::binary_search(searchPostings.begin() + searchStart[grams[i]],
+										   searchPostings.begin() + searchStart[grams[i] + 1], pos);
+		}
+		if (!candidate) continue;
+
+		// buckets are shared by unrelated grams, confirm on the text
+		const libraryEntry_t &entry = libraryEntries[libraryButtons[pos]];
+		const char *label = libraryString(entry.label);
+		const char *filename = libraryString(entry.filename);
+		if (!textMatch(label, strlen(label), query, len, len < 3) &&
+			!(entry.configured && textMatch(filename, stemLength(filename), query, len, len < 3)))
+		{
+			continue;
+		}
+		if (found == maxResults) return found + 1;
+		results[found++] = libraryButtons[pos];
+	}
+	return found;
+}
+// ---------------------------------------------------------------
+uint16_t libraryCount()
+{
+	return libraryEntries.size();
+}
+// ---------------------------------------------------------------
+libraryEntry_t *libraryGetEntry(int index)
+{
+	if (index < 0 || index >= (int)libraryEntries.size()) return nullptr;
+	return &libraryEntries[index];
+}
+// ---------------------------------------------------------------
+const char *libraryString(libraryStr_t str)
+{
+	return (arena && str < arenaUsed) ? arena + str : "";
+}
+// ---------------------------------------------------------------
+uint16_t libraryButtonCount()
+{
+	return libraryButtons.size();
+}
+// ---------------------------------------------------------------
+/**
+ * @return pages needed to show all buttons, at least one
+ */
+uint16_t libraryPageCount()
+{
+	uint16_t pages = (libraryButtons.size() + librarySlotsPerPage - 1) / librarySlotsPerPage;
+	return pages ? pages : 1;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Entry shown on a button
+ *
+ * @return entry index, -1 if the slot is past the end of the library
+ */
+int libraryAt(uint16_t page, uint16_t slot)
+{
+	size_t pos = (size_t)page * librarySlotsPerPage + slot;
+	if (slot >= librarySlotsPerPage || pos >= libraryButtons.size()) return -1;
+	return libraryButtons[pos];
+}
+// ---------------------------------------------------------------
+const libraryStats_t *libraryGetStats()
+{
+	return &libraryStats;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Replace the library with a cache file written by librarySaveCache(). The
+ * 		caller still has to run libraryLayout().
+ *
+ * @param key must match the key the cache was saved with
+ * @param settings receives the caller settings stored with the cache
+ * @return true library loaded, false cache missing, stale or damaged (library untouched)
+ */
+bool libraryLoadCache(const char *path, const libraryCacheKey_t *key, void *settings, uint16_t settingsSize)
+{
+	File file = SD.open(path);
+	if (!file) return false;
+
+	libraryCacheHeader_t header;
+	if (file.read((uint8_t *)&header, sizeof(header)) != sizeof(header) ||
+		header.magic != LIBRARY_CACHE_MAGIC || header.version != LIBRARY_CACHE_VERSION ||
+		header.entrySize != sizeof(libraryEntry_t) || header.settingsSize != settingsSize ||
+		memcmp(&header.key, key, sizeof(header.key)) != 0 ||
+		file.size() != sizeof(header) + settingsSize + header.entryCount * sizeof(libraryEntry_t) + header.arenaBytes)
+	{
+		file.close();
+		return false;
+	}
+
+	std::vector<libraryEntry_t> entries(header.entryCount);
+	char *strings = (char *)malloc(header.arenaBytes ? header.arenaBytes : 1);
+	bool ok = strings != nullptr;
+	ok = ok && file.read((uint8_t *)settings, settingsSize) == settingsSize;
+	ok = ok && file.read((uint8_t *)entries.data(), entries.size() * sizeof(libraryEntry_t)) == entries.size() * sizeof(libraryEntry_t);
+	ok = ok && file.read((uint8_t *)strings, header.arenaBytes) == header.arenaBytes;
+	file.close();
+
+	// every handle must point at a terminated string inside the arena
+	ok = ok && (header.arenaBytes == 0 || strings[header.arenaBytes - 1] == 0);
+	for (size_t i = 0; ok && i < entries.size(); i++)
+	{
+		const libraryEntry_t &e = entries[i];
+		ok = (e.filename == 0 || e.filename < header.arenaBytes) && (e.label == 0 || e.label < header.arenaBytes) &&
+			 (e.color == 0 || e.color < header.arenaBytes);
+	}
+	if (!ok)
+	{
+		free(strings);
+		log_e("library cache damaged: %s", path);
+		return false;
+	}
+
+	libraryClear();
+	arena = strings;
+	arenaSize = arenaUsed = header.arenaBytes;
+	for (uint32_t str = 1; str < arenaUsed; str += strlen(arena + str) + 1) arenaStrings++;
+	libraryEntries.swap(entries);
+	indexReserve(libraryEntries.size());
+	for (size_t i = 0; i < libraryEntries.size(); i++)
+	{
+		libraryEntries[i].style = -1;
+		indexInsert(i);
+	}
+	return true;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Write the library to a cache file
+ *
+ * @param key describes what the library was built from
+ * @param settings caller settings stored with the cache
+ * @return true cache written
+ */
+bool librarySaveCache(const char *path, const libraryCacheKey_t *key, const void *settings, uint16_t settingsSize)
+{
+	File file = SD.open(path, FILE_WRITE);
+	if (!file) return false;
+
+	libraryCacheHeader_t header = {};
+	header.magic = LIBRARY_CACHE_MAGIC;
+	header.version = LIBRARY_CACHE_VERSION;
+	header.entryCount = libraryEntries.size();
+	header.key = *key;
+	header.arenaBytes = arenaUsed;
+	header.settingsSize = settingsSize;
+	header.entrySize = sizeof(libraryEntry_t);
+
+	size_t written = file.write((const uint8_t *)&header, sizeof(header));
+	written += file.write((const uint8_t *)settings, settingsSize);
+	written += file.write((const uint8_t *)libraryEntries.data(), libraryEntries.size() * sizeof(libraryEntry_t));
+	written += file.write((const uint8_t *)arena, arenaUsed);
+	file.close();
+
+	if (written != sizeof(header) + settingsSize + libraryEntries.size() * sizeof(libraryEntry_t) + arenaUsed)
+	{
+		// a truncated cache fails the size check on load, remove it anyway
+		SD.remove(path);
+		return false;
+	}
+	return true;
+}
+// ---------------------------------------------------------------
@@ -0,0 +1,116 @@
+#ifndef _CYD28_LIBRARY_H_
+#define _CYD28_LIBRARY_H_
+
+#include <Arduino.h>
+
+/**
+ * @brief Library model of one bank (the SD root or a folder): configured and scanned
+ * 		clips and the subfolders in one flat array, a hash index by file name and the
+ * 		button layout (page/slot), built once per scan.
+ *
+ * Build order:
+ * 		libraryClear() -> libraryAddConfig() per config line -> libraryMarkFound() /
+ * 		libraryAddFile() / libraryAddFolder() per directory entry -> libraryLayout()
+ *
+ * Incremental update (entries keep their index, removed ones stay as tombstones):
+ * 		config:    libraryMarkClear() -> libraryUpdateConfig() per line -> libraryEndConfigUpdate()
+ * 		directory: libraryMarkClear() -> libraryMarkSeen() / libraryAdd...() per entry -> librarySweepUnseen()
+ * 		then libraryCheckSequences() and libraryLayout()
+ *
+ * A configured file name may list several files joined by LIBRARY_SEQUENCE_SEP, played
+ * back to back. Such a sequence is found when all its files are, see libraryCheckSequences().
+ *
+ * All names, labels and colors are interned into one string arena and referenced by
+ * handle. The arena is shrunk to size by libraryLayout(). Entries are referenced by
+ * index, pointers returned by libraryString() stay valid until the next libraryClear()
+ * or update.
+ *
+ * librarySearch() finds buttons by label or file name through a gram index (word
+ * prefixes and trigrams) over the laid out buttons, built on the first search.
+ *
+ * The built library can be saved to a binary cache file and loaded back in one pass:
+ * 		[libraryCacheHeader][caller settings][entries][string arena]
+ */
+
+typedef uint32_t libraryStr_t;	// offset into the string arena, 0 is the empty string
+
+#define LIBRARY_SEQUENCE_SEP '>'	// joins the files of a sequence button, not valid in FAT names
+
+/**
+ * @brief One clip of the library
+ */
+typedef struct
+{
+	uint32_t nameHash;		// case insensitive hash of the file name, FAT names ignore case
+	libraryStr_t filename;	// file name in the SD root (as configured for configured clips)
+	libraryStr_t label;		// button text
+	libraryStr_t color;		// color name from the config, empty for unconfigured files
+	uint32_t size;			// file size in bytes, 0 if not found
+	uint32_t rgb;			// resolved button color (0xRRGGBB), set by the UI
+	uint16_t speed;			// voice playback speed in 1/1000, 0 = played as a clip
+	uint8_t pitchJitter;	// random speed change per voice trigger, +-%
+	uint32_t loopStart;		// loop window in frames of the file, see loop
+	uint32_t loopEnd;		// frame after the loop window, 0 = end of file
+	uint16_t order;			// position in soundboard.conf
+	int16_t style;			// style handle assigned by the UI, -1 for the default style
+	bool configured;		// entry comes from soundboard.conf
+	bool found;				// file exists on the SD card
+	bool whiteText;			// label needs white text on the button color, set by the UI
+	bool removed;			// dropped by an incremental update, the index is not reused
+	bool mark;				// scratch flag of the current update pass
+	bool folder;			// subdirectory, opens another bank
+	bool loop;				// clip repeats loopStart..loopEnd until stopped
+} libraryEntry_t;
+
+/**
+ * @brief What the cached library was built from, a cache is only used if all fields match
+ */
+typedef struct
+{
+	uint32_t configSize;		// size of the config file, 0 if there is none
+	uint32_t configMtime;		// modification time of the config file
+	uint32_t rootHash;			// hash over the names in the root directory
+} libraryCacheKey_t;
+
+/**
+ * @brief Memory used by the library, filled by libraryLayout()
+ */
+typedef struct
+{
+	uint32_t entries;			// entries in the library
+	uint32_t entryBytes;		// entry array
+	uint32_t arenaBytes;		// string arena
+	uint32_t strings;			// strings requested
+	uint32_t stringsShared;		// strings found already interned
+} libraryStats_t;
+
+void libraryClear();
+int libraryAddConfig(const char *filename, const char *label, const char *color, uint16_t order);
+int libraryAddFile(const char *filename, uint32_t size = 0);
+int libraryAddFolder(const char *dirname);
+int libraryFind(const char *filename);
+bool libraryMarkFound(const char *filename, uint32_t size = 0);
+void libraryLayout(uint16_t slotsPerPage, bool includeUnchecked = false);
+
+void libraryMarkClear();
+int libraryUpdateConfig(const char *filename, const char *label, const char *color, uint16_t order, bool *changed);
+int libraryEndConfigUpdate();
+bool librarySetVoice(int index, uint16_t speed, uint8_t pitchJitter);
+bool librarySetLoop(int index, bool loop, uint32_t loopStart, uint32_t loopEnd);
+int libraryMarkSeen(const char *filename);
+int librarySweepUnseen();
+int libraryCheckSequences();
+
+uint16_t libraryCount();
+libraryEntry_t *libraryGetEntry(int index);
+const char *libraryString(libraryStr_t str);
+uint16_t libraryButtonCount();
+uint16_t libraryPageCount();
+int libraryAt(uint16_t page, uint16_t slot);
+const libraryStats_t *libraryGetStats();
+uint16_t librarySearch(const char *query, int *results, uint16_t maxResults);
+
+bool libraryLoadCache(const char *path, const libraryCacheKey_t *key, void *settings, uint16_t settingsSize);
+bool librarySaveCache(const char *path, const libraryCacheKey_t *key, const void *settings, uint16_t settingsSize);
+
+#endif // _CYD28_LIBRARY_H_
@@ -0,0 +1,218 @@
+#include "CYD28_voice.h"
+#include "CYD28_audio.h"
+#include <SD.h>
+#include <vector>
+
+static SemaphoreHandle_t voiceMutex = NULL;	// UI plays, the library task clears
+static std::vector<voiceSample_t> voiceSamples;
+static uint32_t voiceBytes = 0;		// PCM held by the cache
+static uint32_t voiceTriggers = 0;
+
+// ---------------------------------------------------------------
+static uint32_t fnv1a(const char *str)
+{
+	uint32_t hash = 2166136261u;
+	while (*str)
+	{
+		hash ^= (uint8_t)*str++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+// ---------------------------------------------------------------
+static inline uint32_t le32(const uint8_t *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Walk the RIFF chunks up to the sample data
+ *
+ * @param dataSize returns the size of the data chunk, the file is positioned at its start
+ * @return true PCM format the voices can play
+ */
+static bool readWavHeader(File &file, uint8_t *channels, uint32_t *rate, uint8_t *bits, uint32_t *dataSize)
+{
+	uint8_t buf[16];
+	if (file.read(buf, 12) != 12 || memcmp(buf, "RIFF", 4) != 0 || memcmp(buf + 8, "WAVE", 4) != 0) return false;
+	bool fmt = false;
+	while (file.read(buf, 8) == 8)
+	{
+		uint32_t size = le32(buf + 4);
+		uint32_t next = file.position() + size + (size & 1);	// chunks are word aligned
+		if (memcmp(buf, "fmt ", 4) == 0)
+		{
+			if (size < 16 || file.read(buf, 16) != 16) return false;
+			uint16_t format = buf[0] | (buf[1] << 8);
+			*channels = buf[2];
+			*rate = le32(buf + 4);
+			*bits = buf[14];
+			if (format != 1 || *channels < 1 || *channels > 2 || (*bits != 8 && *bits != 16) || !*rate) return false;
+			fmt = true;
+		}
+		else if (memcmp(buf, "data", 4) == 0)
+		{
+			*dataSize = size;
+			return fmt;
+		}
+		if (!file.seek(next)) return false;
+	}
+	return false;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Drop the least recently used sample, its voices are stopped before the memory is freed
+ */
+static void voiceEvict()
+{
+	size_t lru = 0;
+	for (size_t i = 1; i < voiceSamples.size(); i++)
+		if (voiceSamples[i].lastUse < voiceSamples[lru].lastUse) lru = i;
+	audioStopVoices(voiceSamples[lru].pcm);
+	voiceBytes -= voiceSamples[lru].frames * voiceSamples[lru].channels * sizeof(int16_t);
+	free(voiceSamples[lru].pcm);
+	free(voiceSamples[lru].path);
+	voiceSamples.erase(voiceSamples.begin() + lru);
+}
+// ---------------------------------------------------------------
+// cached sample of the path, loaded on the first use
+static voiceSample_t *voiceGet(const char *path)
+{
+	uint32_t hash = fnv1a(path);
+	for (auto &sample : voiceSamples)
+		if (sample.nameHash == hash && strcmp(sample.path, path) == 0) return &sample;
+
+	File file = SD.open(path);
+	if (!file) return nullptr;
+	uint8_t channels = 0, bits = 0;
+	uint32_t rate = 0, dataSize = 0;
+	if (!readWavHeader(file, &channels, &rate, &bits, &dataSize))
+	{
+		file.close();
+		Serial.println("Voice: not a PCM WAV file: " + String(path));
+		return nullptr;
+	}
+	dataSize = min(dataSize, (uint32_t)(file.size() - file.position()));	// truncated files
+	uint32_t frames = dataSize / (channels * bits / 8);
+	uint32_t bytes = frames * channels * sizeof(int16_t);
+	if (frames < 2 || bytes > VOICE_CACHE_BYTES)
+	{
+		file.close();
+		Serial.println("Voice: " + String(path) + " does not fit the sample cache");
+		return nullptr;
+	}
+	while (!voiceSamples.empty() && voiceBytes + bytes > VOICE_CACHE_BYTES) voiceEvict();
+
+	int16_t *pcm = (int16_t *)malloc(bytes);
+	char *name = strdup(path);
+	if (!pcm || !name)
+	{
+		free(pcm);
+		free(name);
+		file.close();
+		Serial.println("Voice: out of memory");
+		return nullptr;
+	}
+	uint32_t samples = frames * channels;
+	if (bits == 16)
+	{
+		file.read((uint8_t *)pcm, bytes);
+	}
+	else
+	{
+		// 8 bit unsigned, read into the upper half and widen in place from the front
+		uint8_t *raw = (uint8_t *)pcm + samples;
+		file.read(raw, samples);
+		for (uint32_t i = 0; i < samples; i++) pcm[i] = (raw[i] - 128) << 8;
+	}
+	file.close();
+
+	voiceSample_t sample = {};
+	sample.nameHash = hash;
+	sample.path = name;
+	sample.pcm = pcm;
+	sample.frames = frames;
+	sample.rate = rate;
+	sample.channels = channels;
+	voiceSamples.push_back(sample);
+	voiceBytes += bytes;
+	Serial.println("Voice: cached " + String(path) + ", " + String(frames) + " frames @ " + String(rate) + " Hz, " +
+				   String(voiceBytes) + " bytes used");
+	return &voiceSamples.back();
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Create the cache lock, call once before the first voice is loaded
+ */
+void voiceInit()
+{
+	if (voiceMutex) return;
+	voiceMutex = xSemaphoreCreateMutex();
+	if (!voiceMutex)
+	{
+		log_e("voice mutex is not initialized");
+		while (true);
+	}
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Get a sample from the cache, load it from the SD card if needed
+ *
+ * @param path full path of the WAV file
+ * @return the sample, nullptr if the file can not be played as a voice
+ */
+const voiceSample_t *voiceLoad(const char *path)
+{
+	xSemaphoreTake(voiceMutex, portMAX_DELAY);
+	const voiceSample_t *sample = voiceGet(path);
+	xSemaphoreGive(voiceMutex);
+	return sample;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Trigger a sample, overlapping the previous triggers
+ *
+ * @param path full path of the WAV file
+ * @param speed playback speed and pitch, 1.0 = native
+ * @return voice number, -1 if it could not be played
+ */
+int8_t voicePlay(const char *path, float speed)
+{
+	xSemaphoreTake(voiceMutex, portMAX_DELAY);
+	int8_t voice = -1;
+	voiceSample_t *sample = voiceGet(path);
+	if (sample)
+	{
+		sample->lastUse = ++voiceTriggers;
+		voice = audioPlayVoice(sample->pcm, sample->frames, sample->channels, sample->rate, speed);
+	}
+	xSemaphoreGive(voiceMutex);
+	return voice;
+}
+// ---------------------------------------------------------------
+/**
+ * @brief Stop all voices and free the cached samples, ie. when the SD content changed
+ */
+void voiceClearCache()
+{
+	if (!voiceMutex) return;	// nothing was ever cached
+	xSemaphoreTake(voiceMutex, portMAX_DELAY);
+	if (!voiceSamples.empty())
+	{
+		audioStopVoices();
+		for (auto &sample : voiceSamples)
+		{
+			free(sample.pcm);
+			free(sample.path);
+		}
+		voiceSamples.clear();
+		voiceBytes = 0;
+	}
+	xSemaphoreGive(voiceMutex);
+}
+// ---------------------------------------------------------------
+uint32_t voiceCacheBytes()
+{
+	return voiceBytes;
+}
+// ---------------------------------------------------------------
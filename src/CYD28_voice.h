@@ -0,0 +1,38 @@
+#ifndef _CYD28_VOICE_H_
+#define _CYD28_VOICE_H_
+
+#include <Arduino.h>
+
+/**
+ * @brief Sound effect samples: WAV files loaded once from the SD card into RAM and
+ * 		played as voices of the audio task at any speed, several at the same time.
+ * 		Least recently used samples are dropped when VOICE_CACHE_BYTES is exceeded,
+ * 		their voices are stopped first.
+ *
+ * Supported: PCM WAV, 8 or 16 bit, mono or stereo, any sample rate.
+ * The pointer returned by voiceLoad() is valid until the next call.
+ */
+
+#define VOICE_CACHE_BYTES (64 * 1024)	// RAM for cached samples
+
+/**
+ * @brief One cached sample
+ */
+typedef struct
+{
+	uint32_t nameHash;		// hash of the path, lookup key
+	char *path;				// the path itself, a hash match is confirmed against it
+	int16_t *pcm;			// interleaved 16 bit samples
+	uint32_t frames;		// samples per channel
+	uint32_t rate;			// sample rate
+	uint32_t lastUse;		// play count at the last trigger, for LRU eviction
+	uint8_t channels;
+} voiceSample_t;
+
+void voiceInit();
+const voiceSample_t *voiceLoad(const char *path);
+int8_t voicePlay(const char *path, float speed = 1.0f);
+void voiceClearCache();
+uint32_t voiceCacheBytes();
+
+#endif // _CYD28_VOICE_H_
@@ -0,0 +1,412 @@
+/*
+ * CYD Soundboard - decoder throughput benchmark
+ *
+ * Decodes every clip of bench/corpus with CYD_Audio and reports frames/s,
+ * real-time factor, peak heap and the worst single decoder call per clip,
+ * then checks them against the checked-in baseline of the platform.
+ *
+ *   host:   pio run -e bench_native && .pio/build/bench_native/program [--update]
+ *           (run from the project root, it is mounted as the SD card)
+ *   target: copy bench/ to the SD card as /bench, pio run -e bench_esp32 -t upload
+ *
+ * Output is CSV on the serial port / stdout:
+ *   result,<clip>,<codec>,<status>,<rate>,<channels>,<frames>,<frames/s>,<rtf>,<peak heap>,<worst us>
+ *   check,<clip>,<metric>,<baseline>,<now>,<verdict>
+ *   summary,<platform>,<clips>,<regressions>,<baseline>
+ * rtf is decoder time / audio time: below 1 the decoder keeps up with playback.
+ * Each clip is decoded BENCH_RUNS times, throughput and worst call are the medians.
+ * A clip whose decoded length is off its entry in bench/corpus/lengths.csv by more
+ * than BENCH_LENGTH_SLACK_MS gets the status "truncated" or "too_long" instead of "ok".
+ * The baseline column of the summary is "compared", "written" (--update) or
+ * "missing": without a baseline nothing is checked, the results are written as the
+ * first one. On the CYD that file is /bench/baseline_esp32.csv on the SD card, copy
+ * it to bench/ in the repository.
+ *
+ * The decoded audio is dropped in audio_process_extern(), so the clips decode as
+ * fast as the CPU allows on both platforms. The host emulates 4 MB PSRAM (unless
+ * CYD_NATIVE_PSRAM_KB is set) because FLAC and Vorbis refuse to start without it;
+ * on the CYD, which has none, they are reported as unsupported.
+ */
+
+#include <Arduino.h>
+#include <SD.h>
+#include <vector>
+#include <algorithm>
+#include "CYD_Audio.h"
+
+#define SD_CS 5
+#define SD_MOUNT_POINT "/sd"
+#define BENCH_DIR "/bench"
+#define BENCH_CORPUS_DIR BENCH_DIR "/corpus"
+#ifdef CYD_NATIVE
+#define BENCH_PLATFORM "native"
+#else
+#define BENCH_PLATFORM "esp32"
+#endif
+#define BENCH_BASELINE_FILE BENCH_DIR "/baseline_" BENCH_PLATFORM ".csv"
+#define BENCH_LENGTHS_FILE BENCH_CORPUS_DIR "/lengths.csv"
+#define BENCH_CSV_HEADER "clip,codec,status,rate,channels,frames,frames_per_s,rtf,peak_heap,worst_frame_us"
+
+#ifndef BENCH_RUNS
+#define BENCH_RUNS 5                    // decodes per clip, the median counts
+#endif
+#ifndef BENCH_REGRESSION_PCT
+#define BENCH_REGRESSION_PCT 10         // fewer frames/s or more heap than this fails the check
+#endif
+#ifndef BENCH_WORST_FRAME_PCT
+#define BENCH_WORST_FRAME_PCT 50        // the worst single call is noisier, own threshold (0 = report only)
+#endif
+#ifndef BENCH_LENGTH_SLACK_MS
+#define BENCH_LENGTH_SLACK_MS 100       // encoder delay and padding a decoder may pass on
+#endif
+#ifndef BENCH_UPDATE_BASELINE
+#define BENCH_UPDATE_BASELINE 0         // 1 = write the results as the new baseline
+#endif
+#define BENCH_CLIP_TIMEOUT_MS 60000
+#define BENCH_TASK_STACK 10000          // words, as the audio task: the decoders run on it
+
+CYD_Audio audio;
+
+struct BenchResult {
+    String clip;
+    String codec;
+    String status;                      // ok, unsupported (does not start), error (no audio decoded),
+                                        // truncated / too_long (decoded length is off the known one)
+    uint32_t rate = 0;
+    uint8_t channels = 0;
+    uint64_t frames = 0;
+    float framesPerSec = 0;
+    float rtf = 0;
+    uint32_t peakHeap = 0;
+    float worstFrameUs = 0;
+};
+
+uint32_t idleHeap = 0;                  // free heap before the first clip, peak heap is taken against it
+std::vector<std::pair<String, uint32_t>> clipLengths;   // frames of each clip at its own rate, from BENCH_LENGTHS_FILE
+bool updateBaseline = BENCH_UPDATE_BASELINE;
+
+/*
+ * Decoded audio is not played, the benchmark measures the decoders alone
+ */
+void audio_process_extern(int16_t *buff, uint16_t len, bool *continueI2S)
+{
+    *continueI2S = false;
+}
+
+/*
+ * Decode one clip to the end and take its numbers from the decoder statistics of CYD_Audio
+ */
+BenchResult decodeClip(const String &path)
+{
+    BenchResult result;
+    result.clip = path.substring(path.lastIndexOf('/') + 1);
+    result.status = "unsupported";
+    uint32_t minHeap = ESP.getFreeHeap();
+    if (!audio.connecttoFS(SD, path.c_str())) return result;
+
+    uint32_t start = millis();
+    while (audio.isRunning() && millis() - start < BENCH_CLIP_TIMEOUT_MS) {
+        result.codec = audio.getCodecname();
+        result.rate = audio.getSampleRate();
+        result.channels = audio.getChannels();
+        minHeap = min(minHeap, ESP.getFreeHeap());
+        audio.loop();
+    }
+    if (audio.isRunning()) audio.stopSong();
+
+    const CYD_Audio::decodeStats_t &stats = audio.getDecodeStats();
+    float mhz = ESP.getCpuFreqMHz();
+    result.frames = stats.frames;
+    result.peakHeap = idleHeap > minHeap ? idleHeap - minHeap : 0;
+    if (!stats.frames || !stats.cycles || !result.rate) {
+        result.status = "error";
+        result.rate = 0;                // never got past the header, the rate is the default one
+        result.channels = 0;
+        return result;
+    }
+    float decodeSec = stats.cycles / (mhz * 1000000.0f);
+    result.status = "ok";
+    result.framesPerSec = stats.frames / decodeSec;
+    result.rtf = decodeSec / ((float)stats.frames / result.rate);
+    result.worstFrameUs = stats.worstCycles / mhz;
+    return result;
+}
+
+/*
+ * Known lengths of the corpus clips, one "clip,frames" row each
+ */
+void loadLengths()
+{
+    clipLengths.clear();
+    File file = SD.open(BENCH_LENGTHS_FILE);
+    if (!file) return;
+    while (file.available()) {
+        String line = file.readStringUntil('\n');
+        line.trim();
+        int comma = line.indexOf(',');
+        if (comma > 0 && line.substring(0, comma) != "clip") {
+            clipLengths.push_back({line.substring(0, comma), (uint32_t)line.substring(comma + 1).toInt()});
+        }
+    }
+    file.close();
+}
+
+/*
+ * Mark a decoded clip whose length is off the known one, clips without an entry are not checked
+ */
+void checkLength(BenchResult &r)
+{
+    auto known = std::find_if(clipLengths.begin(), clipLengths.end(), [&r](const std::pair<String, uint32_t> &l) { return l.first == r.clip; });
+    if (known == clipLengths.end() || r.status != "ok") return;
+    uint64_t slack = (uint64_t)r.rate * BENCH_LENGTH_SLACK_MS / 1000;
+    if (r.frames + slack < known->second) r.status = "truncated";
+    else if (r.frames > known->second + slack) r.status = "too_long";
+}
+
+/*
+ * Median of BENCH_RUNS decodes for the throughput and the worst call, the largest heap.
+ * A run that fails ends the series, its result is the clip's result.
+ */
+BenchResult benchClip(const String &path)
+{
+    std::vector<BenchResult> runs;
+    uint32_t peakHeap = 0;
+    for (int run = 0; run < BENCH_RUNS; run++) {
+        BenchResult next = decodeClip(path);
+        peakHeap = max(peakHeap, next.peakHeap);
+        if (next.status != "ok") {
+            next.peakHeap = peakHeap;
+            return next;
+        }
+        runs.push_back(next);
+    }
+    std::vector<float> worst;
+    for (const BenchResult &r : runs) worst.push_back(r.worstFrameUs);
+    std::sort(worst.begin(), worst.end());
+    std::sort(runs.begin(), runs.end(), [](const BenchResult &a, const BenchResult &b) { return a.framesPerSec < b.framesPerSec; });
+    BenchResult median = runs[runs.size() / 2];
+    median.peakHeap = peakHeap;
+    median.worstFrameUs = worst[worst.size() / 2];
+    checkLength(median);
+    return median;
+}
+
+/*
+ * One result as a CSV row, the same columns as the baseline file
+ */
+String toCsv(const BenchResult &r)
+{
+    return r.clip + "," + r.codec + "," + r.status + "," + String(r.rate) + "," + String(r.channels) + "," +
+           String((unsigned long)r.frames) + "," + String(r.framesPerSec, 0) + "," + String(r.rtf, 4) + "," +
+           String(r.peakHeap) + "," + String(r.worstFrameUs, 1);
+}
+
+/*
+ * Parse a baseline row, false for the header or a malformed line
+ */
+bool fromCsv(const String &line, BenchResult &r)
+{
+    String fields[10];
+    int from = 0;
+    for (int i = 0; i < 10; i++) {
+        int comma = line.indexOf(',', from);
+        if (comma < 0 && i < 9) return false;
+        fields[i] = comma < 0 ? line.substring(from) : line.substring(from, comma);
+        from = comma + 1;
+    }
+    if (fields[0] == "clip") return false;
+    r.clip = fields[0];
+    r.codec = fields[1];
+    r.status = fields[2];
+    r.rate = fields[3].toInt();
+    r.channels = fields[4].toInt();
+    r.frames = fields[5].toInt();
+    r.framesPerSec = fields[6].toFloat();
+    r.rtf = fields[7].toFloat();
+    r.peakHeap = fields[8].toInt();
+    r.worstFrameUs = fields[9].toFloat();
+    return true;
+}
+
+/*
+ * Baseline of this platform from the SD card, empty if there is none yet
+ */
+std::vector<BenchResult> loadBaseline()
+{
+    std::vector<BenchResult> baseline;
+    File file = SD.open(BENCH_BASELINE_FILE);
+    if (!file) return baseline;
+    while (file.available()) {
+        String line = file.readStringUntil('\n');
+        line.trim();
+        BenchResult r;
+        if (fromCsv(line, r)) baseline.push_back(r);
+    }
+    file.close();
+    return baseline;
+}
+
+/*
+ * Write the results as the baseline of this platform
+ */
+bool saveBaseline(const std::vector<BenchResult> &results)
+{
+    File file = SD.open(BENCH_BASELINE_FILE, FILE_WRITE);
+    if (!file) return false;
+    file.println(BENCH_CSV_HEADER);
+    for (const BenchResult &r : results) file.println(toCsv(r));
+    file.close();
+    return true;
+}
+
+/*
+ * Print one comparison, true if it is a regression
+ */
+bool checkMetric(const String &clip, const char *metric, float baseline, float now, bool higherIsBetter, int thresholdPct)
+{
+    float limit = higherIsBetter ? baseline * (100 - thresholdPct) / 100 : baseline * (100 + thresholdPct) / 100;
+    bool regression = thresholdPct > 0 && (higherIsBetter ? now < limit : now > limit);
+    Serial.println("check," + clip + "," + metric + "," + String(baseline, 1) + "," + String(now, 1) + "," +
+                   (regression ? "REGRESSION" : thresholdPct > 0 ? "ok" : "info"));
+    return regression;
+}
+
+/*
+ * The clip produced audio, even if its length is wrong
+ */
+bool decodes(const String &status)
+{
+    return status != "unsupported" && status != "error";
+}
+
+/*
+ * Compare a clip with its baseline row: a clip that stopped decoding, got slower or
+ * needs more heap than the thresholds allow is a regression
+ */
+int checkClip(const BenchResult &r, const std::vector<BenchResult> &baseline)
+{
+    auto base = std::find_if(baseline.begin(), baseline.end(), [&r](const BenchResult &b) { return b.clip == r.clip; });
+    if (base == baseline.end()) {
+        Serial.println("check," + r.clip + ",status,,," + "NEW");
+        return 0;
+    }
+    if (base->status != "ok") {
+        // A known bad length is no regression as long as the clip still decodes
+        bool worse = decodes(base->status) && !decodes(r.status);
+        Serial.println("check," + r.clip + ",status," + base->status + "," + r.status + "," +
+                       (r.status == "ok" ? "IMPROVED" : worse ? "REGRESSION" : "ok"));
+        return worse;
+    }
+    if (r.status != "ok") {
+        Serial.println("check," + r.clip + ",status," + base->status + "," + r.status + ",REGRESSION");
+        return 1;
+    }
+    int regressions = 0;
+    regressions += checkMetric(r.clip, "frames_per_s", base->framesPerSec, r.framesPerSec, true, BENCH_REGRESSION_PCT);
+    regressions += checkMetric(r.clip, "peak_heap", base->peakHeap, r.peakHeap, false, BENCH_REGRESSION_PCT);
+    regressions += checkMetric(r.clip, "worst_frame_us", base->worstFrameUs, r.worstFrameUs, false, BENCH_WORST_FRAME_PCT);
+    return regressions;
+}
+
+/*
+ * Clips of the corpus directory in name order
+ */
+std::vector<String> listCorpus()
+{
+    std::vector<String> clips;
+    File dir = SD.open(BENCH_CORPUS_DIR);
+    if (!dir || !dir.isDirectory()) return clips;
+    File file;
+    while ((file = dir.openNextFile())) {
+        String name = file.name();
+        if (!file.isDirectory() && !name.endsWith(".py") && !name.endsWith(".csv")) {
+            clips.push_back(String(BENCH_CORPUS_DIR) + "/" + name.substring(name.lastIndexOf('/') + 1));
+        }
+        file.close();
+    }
+    std::sort(clips.begin(), clips.end());
+    return clips;
+}
+
+/*
+ * Benchmark the corpus and check it against the baseline
+ *
+ * @return number of regressions, -1 if there is nothing to benchmark
+ */
+int runBench()
+{
+    std::vector<String> clips = listCorpus();
+    if (clips.empty()) {
+        Serial.println("No clips in " + String(BENCH_CORPUS_DIR));
+        return -1;
+    }
+    loadLengths();
+    audio.begin(true, I2S_DAC_CHANNEL_LEFT_EN);
+    idleHeap = ESP.getFreeHeap();
+
+    std::vector<BenchResult> results;
+    Serial.println("result," BENCH_CSV_HEADER);
+    for (const String &clip : clips) {
+        results.push_back(benchClip(clip));
+        Serial.println("result," + toCsv(results.back()));
+    }
+
+    std::vector<BenchResult> baseline = loadBaseline();
+    int regressions = 0;
+    const char *baselineState = "compared";
+    if (baseline.empty() || updateBaseline) {
+        baselineState = baseline.empty() ? "missing" : "written";
+        if (baseline.empty()) Serial.println("No baseline in " BENCH_BASELINE_FILE ", nothing was checked");
+        Serial.println(String(saveBaseline(results) ? "Baseline written to " : "Can't write ") + BENCH_BASELINE_FILE);
+    }
+    else {
+        for (const BenchResult &r : results) regressions += checkClip(r, baseline);
+    }
+    Serial.println("summary," BENCH_PLATFORM "," + String((unsigned)results.size()) + "," + String(regressions) + "," + baselineState);
+    return regressions;
+}
+
+#ifdef CYD_NATIVE
+
+#ifndef PIO_UNIT_TESTING  // test_build_src of env:native, a test brings its own main()
+int main(int argc, char **argv)
+{
+    setenv("CYD_NATIVE_PSRAM_KB", "4096", 0);
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--update")) updateBaseline = true;
+    }
+    if (!SD.begin()) return 2;
+    int regressions = runBench();
+    return regressions < 0 ? 2 : regressions > 0 ? 1 : 0;
+}
+#endif
+
+#else
+
+SPIClass sdSPI = SPIClass(VSPI);
+
+/*
+ * The benchmark gets a task with the stack of the audio task, loopTask is too small for the decoders
+ */
+void benchTask(void *parameter)
+{
+    runBench();
+    vTaskDelete(NULL);
+}
+
+void setup()
+{
+    Serial.begin(115200);
+    if (!SD.begin(SD_CS, sdSPI, 80000000, SD_MOUNT_POINT)) {
+        Serial.println("SD Card initialization failed");
+        return;
+    }
+    xTaskCreatePinnedToCore(benchTask, "bench", BENCH_TASK_STACK, NULL, 2, NULL, 0);
+}
+
+void loop()
+{
+    vTaskDelete(NULL);
+}
+
+#endif
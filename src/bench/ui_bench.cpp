@@ -0,0 +1,260 @@
+/*
+ * CYD Soundboard - headless UI render benchmark
+ *
+ * Runs the UI code of main.cpp on the host: the same display setup (TFT_eSPI is a
+ * framebuffer in memory there), the same main screen and the same library loading,
+ * then swipes through the pager with a scripted input device. Every library size runs
+ * in its own process, so the LVGL heap high-water mark of one size is not carried
+ * into the next.
+ *
+ *   pio run -e ui_bench_native && .pio/build/ui_bench_native/program [entries...]
+ *
+ * Output is CSV on stdout, one line per library size (default 12, 100, 500, 2000):
+ *   result,<entries>,<pages>,<library us>,<library heap>,<grid build us>,<grid refresh us>,
+ *          <lvgl heap max>,<objects per page>,<objects total>,
+ *          <full frame us>,<swipe frames>,<frame us avg>,<frame us max>
+ * library: config parse and card scan, grid build: the first publishLibrary() (creates
+ * the page objects), grid refresh: a second one (rebinds them, as after a bank switch).
+ * A frame is timed from refresh start to render ready, as DISPLAY_STATS_LOG does. A
+ * library of one page has nothing to swipe (the drag would click a button): 0 frames.
+ *
+ * LVGL time is simulated, one LV_DEF_REFR_PERIOD per frame, so the same frames are
+ * rendered on every run. Pointers are 8 bytes on the host: LVGL heap and object sizes
+ * are larger than on the ESP32, compare them between builds, not with the target.
+ */
+
+#include <Arduino.h>
+#include <SD.h>
+#include <lvgl.h>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "CYD28_library.h"
+
+#define UI_BENCH_DIR "/tmp/cyd_ui_bench"   // libraries are generated below, one folder per size
+#define UI_BENCH_SWIPES 3                  // the second swipe on recycles a page object
+#define UI_BENCH_SWIPE_STEPS 10            // finger moves per swipe, one per frame
+#define UI_BENCH_SETTLE_FRAMES 120         // upper bound for the scroll and snap animations
+#define UI_BENCH_CSV_HEADER "result,entries,pages,library_us,library_heap,grid_build_us,grid_refresh_us," \
+                            "lvgl_heap_max,objects_per_page,objects_total," \
+                            "full_frame_us,swipe_frames,frame_us_avg,frame_us_max"
+
+// UI of main.cpp
+extern lv_indev_t *indev;
+extern lv_obj_t *file_list;
+extern int pagerPageCount;
+void initializeDisplay();
+void create_main_screen();
+void readConfigFile();
+void scanSDCard();
+void publishLibrary(bool final);
+
+const int defaultSizes[] = {12, 100, 500, 2000};
+const char *colorNames[] = {"red", "green", "blue", "yellow", "orange", "purple", "#336699", "0xF0E68C"};
+
+uint32_t simulatedMs = 0;               // LVGL tick, advanced frame by frame
+
+// Scripted input device: the point and state read by LVGL
+lv_point_t touchPoint = {0, 0};
+bool touchPressed = false;
+
+// Frame timing, from the display events
+uint32_t refrStartUs = 0;
+uint32_t frameCount = 0;
+uint64_t frameSumUs = 0;
+uint32_t frameMaxUs = 0;
+
+/*
+ * LVGL tick source
+ */
+uint32_t simulated_tick() {
+    return simulatedMs;
+}
+
+/*
+ * Scripted input device read callback
+ */
+void scripted_touch_read(lv_indev_t *indev, lv_indev_data_t *data) {
+    data->point = touchPoint;
+    data->state = touchPressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+}
+
+/*
+ * Time every rendered frame from refresh start, frames with nothing to draw are not counted
+ */
+void frame_timing_cb(lv_event_t *e) {
+    lv_event_code_t code = lv_event_get_code(e);
+    if (code == LV_EVENT_REFR_START) {
+        refrStartUs = micros();
+    } else if (code == LV_EVENT_RENDER_READY) {
+        uint32_t frameUs = micros() - refrStartUs;
+        frameCount++;
+        frameSumUs += frameUs;
+        frameMaxUs = max(frameMaxUs, frameUs);
+    }
+}
+
+/*
+ * One frame period: the input device is read, animations advance and the display refreshes
+ */
+void runFrame() {
+    simulatedMs += LV_DEF_REFR_PERIOD;
+    lv_timer_handler();
+}
+
+/*
+ * Objects in a subtree, the root included
+ */
+uint32_t countObjects(lv_obj_t *obj) {
+    uint32_t count = 1;
+    for (uint32_t i = 0; i < lv_obj_get_child_count(obj); i++) {
+        count += countObjects(lv_obj_get_child(obj, i));
+    }
+    return count;
+}
+
+/*
+ * Write a bank folder with a config and empty clips: three of four entries configured
+ * in one of a few colours, the rest plain MP3 files
+ */
+bool writeLibrary(const String &dir, int entries) {
+    mkdir(UI_BENCH_DIR, 0755);
+    mkdir(dir.c_str(), 0755);
+    FILE *config = fopen((dir + "/soundboard.conf").c_str(), "w");
+    if (!config) return false;
+    fprintf(config, "VOLUME=12\n");
+    for (int i = 0; i < entries; i++) {
+        String name = "clip" + String(i) + ".mp3";
+        if (i % 4 != 3) {
+            fprintf(config, "%s|Clip %d|%s\n", name.c_str(), i, colorNames[i % (sizeof(colorNames) / sizeof(colorNames[0]))]);
+        }
+        FILE *clip = fopen((dir + "/" + name).c_str(), "w");
+        if (!clip) {
+            fclose(config);
+            return false;
+        }
+        fclose(clip);
+    }
+    fclose(config);
+    return true;
+}
+
+/*
+ * Drag one page width to the left and let go, then run frames until the scroll, the
+ * snap and the page recycling are done
+ */
+void swipe() {
+    touchPoint = {280, 120};
+    touchPressed = true;
+    runFrame();
+    for (int step = 1; step <= UI_BENCH_SWIPE_STEPS; step++) {
+        touchPoint.x = 280 - step * 240 / UI_BENCH_SWIPE_STEPS;
+        runFrame();
+    }
+    touchPressed = false;
+    runFrame();
+    for (int frame = 0; frame < UI_BENCH_SETTLE_FRAMES && lv_anim_count_running(); frame++) {
+        runFrame();
+    }
+    runFrame();  // Redraw after the last animation step
+}
+
+/*
+ * Build the UI for one library size and print its result line
+ */
+bool benchLibrary(int entries) {
+    String dir = UI_BENCH_DIR "/" + String(entries);
+    if (!writeLibrary(dir, entries) || !SD.begin(dir.c_str())) {
+        Serial.println("Can't create the library in " + dir);
+        return false;
+    }
+
+    initializeDisplay();
+    lv_tick_set_cb(simulated_tick);  // After lv_init(), which resets it
+    lv_indev_set_read_cb(indev, scripted_touch_read);
+    lv_indev_set_mode(indev, LV_INDEV_MODE_TIMER);
+    lv_display_add_event_cb(lv_display_get_default(), frame_timing_cb, LV_EVENT_ALL, nullptr);
+    create_main_screen();
+    runFrame();
+
+    // main.cpp logs every config line and file, keep the results readable
+    fflush(stdout);
+    int console = dup(STDOUT_FILENO);
+    int devNull = open("/dev/null", O_WRONLY);
+    dup2(devNull, STDOUT_FILENO);
+
+    uint32_t heapBefore = ESP.getFreeHeap();
+    uint32_t start = micros();
+    readConfigFile();
+    scanSDCard();
+    uint32_t libraryUs = micros() - start;
+    uint32_t libraryHeap = heapBefore - ESP.getFreeHeap();
+
+    start = micros();
+    publishLibrary(true);
+    uint32_t buildUs = micros() - start;
+    start = micros();
+    publishLibrary(true);
+    uint32_t refreshUs = micros() - start;
+
+    fflush(stdout);
+    dup2(console, STDOUT_FILENO);
+    close(devNull);
+    close(console);
+
+    // Everything on screen once, as at the end of the boot
+    start = micros();
+    lv_obj_invalidate(lv_screen_active());
+    lv_refr_now(NULL);
+    uint32_t fullFrameUs = micros() - start;
+
+    frameCount = 0;
+    frameSumUs = 0;
+    frameMaxUs = 0;
+    for (int i = 0; i < UI_BENCH_SWIPES && pagerPageCount > 1; i++) {
+        swipe();
+    }
+
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    uint32_t objectsPerPage = lv_obj_get_child_count(file_list) ? countObjects(lv_obj_get_child(file_list, 0)) : 0;
+    Serial.println("result," + String(libraryButtonCount()) + "," + String(pagerPageCount) + "," +
+                   String(libraryUs) + "," + String(libraryHeap) + "," + String(buildUs) + "," + String(refreshUs) + "," +
+                   String(mem.max_used) + "," +
+                   String(objectsPerPage) + "," + String(countObjects(lv_screen_active())) + "," +
+                   String(fullFrameUs) + "," + String(frameCount) + "," +
+                   String(frameCount ? (uint32_t)(frameSumUs / frameCount) : 0) + "," + String(frameMaxUs));
+    return true;
+}
+
+#ifndef PIO_UNIT_TESTING  // test_build_src of env:native, a test brings its own main()
+int main(int argc, char **argv) {
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; i++) {
+        if (atoi(argv[i]) > 0) sizes.push_back(atoi(argv[i]));
+    }
+    if (sizes.empty()) sizes.assign(defaultSizes, defaultSizes + sizeof(defaultSizes) / sizeof(defaultSizes[0]));
+
+    Serial.println(UI_BENCH_CSV_HEADER);
+    int failed = 0;
+    for (int entries : sizes) {
+        fflush(stdout);
+        pid_t pid = fork();
+        if (pid == 0) {
+            bool ok = benchLibrary(entries);
+            fflush(stdout);
+            _exit(ok ? 0 : 1);
+        }
+        int status = 0;
+        if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            Serial.println("error," + String(entries));
+            failed++;
+        }
+    }
+    // Globals of the firmware are never destroyed on the target, CYD_Audio's destructor would run on an engine that was never started
+    fflush(stdout);
+    _exit(failed ? 1 : 0);
+}
+#endif
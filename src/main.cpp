@@ -17,7 +17,14 @@
 #include <SD.h>
 #include <FS.h>
 #include <vector>
+#include <algorithm>
+#include <dirent.h>
+#include <sys/stat.h>
 #include "CYD28_audio.h"
+#include "CYD28_bank.h"
+#include "CYD28_display.h"
+#include "CYD28_library.h"
+#include "CYD28_voice.h"
 
 // Pin definitions for CYD hardware
 #define XPT2046_IRQ 36
@@ -26,14 +33,40 @@
 #define XPT2046_CLK 25
 #define XPT2046_CS 33
 #define SD_CS 5
+#define SD_MOUNT_POINT "/sd"
 
 // Configuration file name
 #define CONFIG_FILE "/soundboard.conf"
+#define LIBRARY_CACHE 1                          // Keep the parsed config and scan result in a binary cache file
+#define LIBRARY_CACHE_FILE "/soundboard.cache"
+#define LIBRARY_WATCH_INTERVAL_MS 3000           // Check for card changes and config edits (0 = never)
+#define LIBRARY_DIR_CHECK_EVERY 10               // List the bank directory on every n-th check only, the config is stat()ed on each
+#define BANK_BACK ".."                           // Entry leading from a folder bank to its parent
 
 // Display configuration
 #define TFT_HOR_RES   320
 #define TFT_VER_RES   240
 #define DRAW_BUF_SIZE (TFT_HOR_RES * TFT_VER_RES / 10 * (LV_COLOR_DEPTH / 8))
+#define DISPLAY_DMA 1         // Double buffered DMA flush (0 = single buffer, blocking flush)
+#define DISPLAY_STATS_LOG 0   // Print display FPS, redraw times, touch latency and LVGL load every second
+
+// LVGL task configuration - the audio task owns the other core (see CYD28_audio.h)
+#define LVGL_TASK_CORE 1          // Core running the UI
+#define LVGL_TASK_PRIORITY 1
+#define LVGL_TASK_STACK 8192      // Stack size in bytes
+#define LVGL_TICK_PERIOD_MS 1     // esp_timer tick period
+#define LVGL_TASK_MAX_SLEEP_MS 100 // Upper bound for the idle sleep
+#define TOUCH_IRQ_MODE 1          // Sample the touch only while PENIRQ reports the pen down (0 = LVGL polls it)
+#define TOUCH_SAMPLE_PERIOD_MS 10 // Sampling period while the pen is down
+
+// Boot task configuration - loads the library while the UI is already running
+#define BOOT_TASK_CORE LVGL_TASK_CORE  // The audio core is reserved for decoding and I2S
+#define BOOT_TASK_PRIORITY 1            // Below the audio task, shares the UI core with LVGL
+#define BOOT_TASK_STACK 8192            // Stack size in bytes
+#define BOOT_TIMELINE_MAX 12            // Boot stages recorded for the timeline
+#define AUDIO_READY_TIMEOUT_MS 2000     // Longest wait for the audio output at boot
+#define BANK_IDLE_POLL_MS 100           // Flash writes of the bank mirror wait for the audio to be idle
+#define BANK_IDLE_TIMEOUT_MS 3000       // ... this long at most, then the playback is stopped
 
 // Grid configuration - adjust these for performance tuning
 #define GRID_COLS 4        // Number of columns per grid (was 5)
@@ -41,17 +74,33 @@
 #define GRID_BUTTONS_MAX (GRID_COLS * GRID_ROWS)  // Maximum buttons per grid
 #define BUTTON_GAP 1       // Gap between buttons in pixels
 #define GRID_GAP 2         // Gap between grids in pixels
+#define PAGER_PAGES 3      // Page objects kept alive: the visible page and its neighbours
+#define BUTTON_STYLE_CACHE 1  // Shared style per configured colour (0 = local style properties on every button)
+#define SEARCH_BAR_HEIGHT 36  // Query field and buttons at the top of the search screen
+#define VU_METER 1            // Output level meter in the bottom left corner (0 = off)
+#define VU_METER_PERIOD_MS 33 // Meter refresh cap (~30 Hz)
+#define VU_METER_WIDTH 64     // Bar length at full scale in pixels
+#define VU_METER_HEIGHT 10    // Two bars, left channel on top
+#define VU_METER_IDLE_TICKS 30 // Silent refreshes before the meter timer pauses until the next play (~1 s)
 
 // Default volume setting (0-21 range)
 #define DEFAULT_VOLUME 12  // Default volume if not specified in config file
 
-// Structure to hold button configuration
-struct ButtonConfig {
-    String filename;
-    String label;
-    String color;
-    int order = 0;
-    bool found = false;  // Whether the MP3 file was found on SD card
+// Voice speed range accepted from the config file
+#define VOICE_SPEED_MIN 0.25f
+#define VOICE_SPEED_MAX 4.0f
+
+// Shared button style: background color plus a readable text color
+struct ButtonStyle {
+    uint32_t rgb;        // Background color 0xRRGGBB
+    bool whiteText;
+    lv_style_t style;
+};
+
+// Settings from the config file, stored in the library cache
+struct SoundboardSettings {
+    int volume;
+    bool bankMirror;
 };
 
 // Touch screen setup using software SPI to avoid conflicts
@@ -64,24 +113,68 @@ uint16_t touchScreenMinimumY = 20, touchScreenMaximumY = 219;
 // LVGL variables
 lv_indev_t *indev;        // Touch input device
 uint8_t *draw_buf;        // Display buffer
-uint32_t lastTick = 0;    // Timer for LVGL
+uint8_t *draw_buf2;       // Second display buffer (DMA flush)
+TaskHandle_t lvglTaskHandle = nullptr;    // Task running lv_timer_handler
+SemaphoreHandle_t lvglMutex = nullptr;    // Guards all LVGL calls made outside the LVGL task
+esp_timer_handle_t lvglTickTimer = nullptr;
+volatile uint32_t touchDownUs = 0;        // Time of the last pen down interrupt
+volatile bool touchSampling = false;      // A touch read is running, its own PENIRQ edges are ignored
+
+// Page object of the file browser and the shared styles attached to its buttons
+struct PagerGrid {
+    lv_obj_t* obj;
+    const lv_style_t* styles[GRID_BUTTONS_MAX];
+};
 
 // File browser variables
 lv_obj_t * file_list;     // Container for file buttons
+PagerGrid pagerGrids[PAGER_PAGES];        // Page objects in screen order
+int pagerGridCount = 0;                   // Page objects in use
+int pagerFirstPage = 0;                   // Library page shown by pagerGrids[0]
+int pagerPageCount = 0;                   // Pages needed for the whole library
+std::vector<ButtonStyle*> buttonStyles;   // Interned styles, one per distinct color, attached to buttons so never freed
+lv_style_t unconfiguredButtonStyle;       // Gray with white text
+
+// Search screen, created on first use and kept hidden afterwards
+lv_obj_t * searchScreen = nullptr;        // Overlay above the pager
+lv_obj_t * searchInput;                   // Query text area
+lv_obj_t * searchCount;                   // Number of matches
+lv_obj_t * searchKeyboard;
+PagerGrid searchGrid;                     // Temporary grid page with the results
+
+#if VU_METER
+// Level meter, invalidated only when a drawn bar length changes
+lv_obj_t * vuMeter = nullptr;
+uint8_t vuDrawn[4];                       // Drawn lengths in pixels: peak L, peak R, RMS L, RMS R
+lv_timer_t * vuTimer = nullptr;           // Paused while the output is silent, resumed by playMP3File()
+uint8_t vuSilentTicks = 0;
+#endif
 
-std::vector<ButtonConfig> buttonConfigs;  // Configured buttons
-std::vector<String> unconfiguredFiles;    // MP3 files not in config
+// Boot timeline: stage name and time since boot
+struct BootStage {
+    const char* name;
+    uint32_t ms;
+};
+BootStage bootStages[BOOT_TIMELINE_MAX];
+int bootStageCount = 0;
+lv_obj_t * bootLabel = nullptr;           // Shown until the first page is ready
 
 // Global configuration variables
 int configuredVolume = DEFAULT_VOLUME;    // Volume setting from config file
+bool bankMirrorEnabled = false;           // Play configured clips from the flash bank partition
 
 // Global SD card initialization flag
 bool sdCardInitialized = false;
+libraryCacheKey_t libraryKey = {};       // Config and bank directory the library was built from
+String currentBank = "";                  // Folder shown as the library, relative to the root ("" = root)
+String pendingBank = "";                  // Bank requested from the UI, guarded by the LVGL lock
+bool bankRequested = false;
+TaskHandle_t bootTaskHandle = NULL;       // Boot task, stays around to switch banks and watch the card
 SPIClass sdSPI = SPIClass(VSPI);
 
 // Audio player - now using CYD28_audio system
 bool audioInitialized = false;
-String currentlyPlaying = "";
+int currentlyPlaying = -1;                // Library entry being played, -1 if none
 
 #if LV_USE_LOG != 0
 void my_print( lv_log_level_t level, const char * buf )
@@ -97,9 +190,240 @@ void my_disp_flush(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map) {
     lv_disp_flush_ready(disp);
 }
 
+#if DISPLAY_STATS_LOG
+/* Display performance counters, printed once per second */
+static uint32_t refrStartUs = 0;
+static uint32_t statsStartMs = 0;
+static uint32_t frameCount = 0;
+static uint32_t redrawSumUs = 0;
+static uint32_t redrawMaxUs = 0;
+static uint32_t lvglBusyUs = 0;   // Time spent in lv_timer_handler
+static uint32_t touchStatsStartMs = 0;
+static uint32_t touchReadCount = 0;
+static uint32_t touchReadUs = 0;   // Time spent reading the touch controller
+static uint16_t touchSpreadMax = 0; // Largest raw sample spread of a read (jitter)
+static uint32_t dspStageCycles[CYD_DSP_STAGES]; // Audio pipeline cycles per stage at the last print
+#if VU_METER
+static uint32_t vuStatsStartMs = 0;
+static uint32_t vuUpdateUs = 0;     // Time spent in the meter timer
+static uint32_t vuRedraws = 0;      // Meter invalidations
+#endif
+
+static void display_stats_cb(lv_event_t *e) {
+    lv_event_code_t code = lv_event_get_code(e);
+
+    if (code == LV_EVENT_REFR_START) {
+        refrStartUs = micros();
+    } else if (code == LV_EVENT_RENDER_READY) {
+        // Something was rendered: one frame, timed from refresh start (layout + render + flush)
+        uint32_t redrawUs = micros() - refrStartUs;
+        frameCount++;
+        redrawSumUs += redrawUs;
+        if (redrawUs > redrawMaxUs) redrawMaxUs = redrawUs;
+
+        // First redraw after a pen down interrupt
+        if (touchDownUs) {
+            Serial.println("Touch to redraw: " + String(micros() - touchDownUs) + " us");
+            touchDownUs = 0;
+        }
+    } else if (code == LV_EVENT_REFR_READY && millis() - statsStartMs >= 1000) {
+        uint32_t elapsedMs = millis() - statsStartMs;
+        if (frameCount) {
+            Serial.println("Display: " + String(frameCount * 1000 / elapsedMs) + " fps, redraw avg " +
+                           String(redrawSumUs / frameCount) + " us, max " + String(redrawMaxUs) + " us");
+        }
+        Serial.println("LVGL task load: " + String(lvglBusyUs / (elapsedMs * 10)) + "%");
+        statsStartMs = millis();
+        frameCount = 0;
+        redrawSumUs = 0;
+        redrawMaxUs = 0;
+        lvglBusyUs = 0;
+    }
+}
+#endif
+
+/* Record a boot stage for the timeline */
+void bootMark(const char* name, uint32_t ms = millis()) {
+    if (bootStageCount < BOOT_TIMELINE_MAX) {
+        bootStages[bootStageCount++] = {name, ms};
+    }
+}
+
+/* Print the boot stages in the order they finished */
+void printBootTimeline() {
+    std::sort(bootStages, bootStages + bootStageCount,
+              [](const BootStage& a, const BootStage& b) { return a.ms < b.ms; });
+    Serial.println("Boot timeline:");
+    for (int i = 0; i < bootStageCount; i++) {
+        Serial.println("  " + String(bootStages[i].ms) + " ms  " + bootStages[i].name);
+    }
+}
+
+/* Serialize LVGL access, LVGL itself is not thread safe */
+void lvglLock() {
+    xSemaphoreTakeRecursive(lvglMutex, portMAX_DELAY);
+}
+
+void lvglUnlock() {
+    xSemaphoreGiveRecursive(lvglMutex);
+}
+
+/* Bank mirror flash guard: erases and writes turn the flash cache off and stall both cores,
+   so wait until nothing plays. Clips start from the UI under the LVGL lock, holding it keeps
+   them from starting until the flash operation is done. A loop or a long clip would hold
+   the boot task (boot completion, bank switches, card watch) forever, so it is stopped. */
+void bankFlashEnter() {
+    uint32_t start = millis();
+    for (;;) {
+        lvglLock();
+        if (!audioIsSounding()) return;
+        if (millis() - start >= BANK_IDLE_TIMEOUT_MS) {
+            audioStopSong();
+            audioStopVoices();
+            currentlyPlaying = -1;
+            Serial.println("Bank mirror: playback stopped for the flash write");
+            return;
+        }
+        lvglUnlock();
+        delay(BANK_IDLE_POLL_MS);
+    }
+}
+
+void bankFlashLeave() {
+    lvglUnlock();
+}
+
+/* esp_timer callback, drives the LVGL tick independently of the task scheduling */
+static void lvgl_tick_cb(void *arg) {
+    lv_tick_inc(LVGL_TICK_PERIOD_MS);
+}
+
+/* XPT2046 PENIRQ falling edge: wake the LVGL task to read the touch at once */
+static void IRAM_ATTR touch_irq_handler() {
+    // PENIRQ is disabled during a conversion and re-armed by the last command of a read
+    if (touchSampling) return;
+    BaseType_t higherPriorityTaskWoken = pdFALSE;
+    touchDownUs = (uint32_t)esp_timer_get_time();
+    if (lvglTaskHandle) {
+        vTaskNotifyGiveFromISR(lvglTaskHandle, &higherPriorityTaskWoken);
+    }
+    if (higherPriorityTaskWoken) portYIELD_FROM_ISR();
+}
+
+/* Read the touch and hand it to LVGL, returns true while the pen is down */
+static bool readTouch() {
+    touchSampling = true;
+    lv_indev_read(indev);
+    touchSampling = false;
+    return lv_indev_get_state(indev) == LV_INDEV_STATE_PRESSED;
+}
+
+/* LVGL task: run the timers, then sleep until the next one is due or a touch arrives.
+   With TOUCH_IRQ_MODE the touch is sampled only from pen down (interrupt) to release. */
+void lvglTask(void *parameter) {
+    bool penDown = false;
+    uint32_t lastSampleMs = 0;
+
+    while (true) {
+        lvglLock();
+#if DISPLAY_STATS_LOG
+        uint32_t busyStart = micros();
+#endif
+        uint32_t nextRunMs = lv_timer_handler();
+#if TOUCH_IRQ_MODE
+        if (penDown && millis() - lastSampleMs >= TOUCH_SAMPLE_PERIOD_MS) {
+            penDown = readTouch();
+            lastSampleMs = millis();
+        }
+#endif
+#if DISPLAY_STATS_LOG
+        lvglBusyUs += micros() - busyStart;
+#endif
+        lvglUnlock();
+
+        if (nextRunMs > LVGL_TASK_MAX_SLEEP_MS) nextRunMs = LVGL_TASK_MAX_SLEEP_MS;
+        if (penDown && nextRunMs > TOUCH_SAMPLE_PERIOD_MS) nextRunMs = TOUCH_SAMPLE_PERIOD_MS;
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(nextRunMs))) {
+            // Woken by the pen down interrupt, don't wait for the indev timer
+            lvglLock();
+            penDown = readTouch();
+            lastSampleMs = millis();
+            lvglUnlock();
+        }
+
+#if DISPLAY_STATS_LOG
+        // Printed here rather than on a redraw, so an idle screen reports its (zero) touch reads too
+        if (millis() - touchStatsStartMs >= 1000) {
+            Serial.println("Touch: " + String(touchReadCount) + " reads, " + String(touchReadUs) + " us sampling in " +
+                           String(millis() - touchStatsStartMs) + " ms, " +
+                           (touchReadCount ? String(touchReadUs / touchReadCount) : String("-")) + " us per read (" +
+                           String(XPT2046_SAMPLES) + " samples/axis), jitter " + String(touchSpreadMax) + " raw, " +
+                           String(touchscreen.getStats().rejected) + " rejected by pressure");
+
+            // Audio task time per output stage over the same interval
+            const char* stageNames[CYD_DSP_STAGES];
+            uint32_t stageCycles[CYD_DSP_STAGES];
+            uint8_t stageCount = audioGetDspStats(stageNames, stageCycles, CYD_DSP_STAGES);
+            String dspLine = "Audio DSP:";
+            for (uint8_t i = 0; i < stageCount; i++) {
+                dspLine += " " + String(stageNames[i]) + " " + String((stageCycles[i] - dspStageCycles[i]) / getCpuFrequencyMhz()) + " us";
+                dspStageCycles[i] = stageCycles[i];
+            }
+            Serial.println(dspLine);
+
+            touchStatsStartMs = millis();
+            touchReadCount = 0;
+            touchReadUs = 0;
+            touchSpreadMax = 0;
+        }
+#endif
+    }
+}
+
+/* Start the LVGL tick timer and task */
+void startLvglTask() {
+    const esp_timer_create_args_t tickTimerArgs = {
+        .callback = lvgl_tick_cb,
+        .arg = nullptr,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "lvgl_tick"
+    };
+    esp_timer_create(&tickTimerArgs, &lvglTickTimer);
+    esp_timer_start_periodic(lvglTickTimer, LVGL_TICK_PERIOD_MS * 1000);
+
+    xTaskCreatePinnedToCore(
+        lvglTask,              /* Function to implement the task */
+        "lvgl",                /* Name of the task */
+        LVGL_TASK_STACK,       /* Stack size in bytes */
+        NULL,                  /* Task input parameter */
+        LVGL_TASK_PRIORITY,    /* Priority of the task */
+        &lvglTaskHandle,       /* Task handle. */
+        LVGL_TASK_CORE         /* Core where the task should run */
+    );
+
+    pinMode(XPT2046_IRQ, INPUT);
+    attachInterrupt(digitalPinToInterrupt(XPT2046_IRQ), touch_irq_handler, FALLING);
+}
+
 /* Read touch input and convert to screen coordinates */
 void my_touchpad_read(lv_indev_t *indev, lv_indev_data_t *data) {
+#if DISPLAY_STATS_LOG
+    static bool wasPressed = false;
+    uint32_t readStart = micros();
+#endif
     TouchPoint p = touchscreen.getTouch();
+#if DISPLAY_STATS_LOG
+    touchReadCount++;
+    touchReadUs += micros() - readStart;
+    const TouchStats& touchStats = touchscreen.getStats();
+    if (p.zRaw > 0) {
+        touchSpreadMax = LV_MAX(touchSpreadMax, LV_MAX(touchStats.xSpread, touchStats.ySpread));
+    }
+    if (p.zRaw > 0 && !wasPressed && touchDownUs) {
+        Serial.println("Touch down to press event: " + String(micros() - touchDownUs) + " us");
+    }
+    wasPressed = p.zRaw > 0;
+#endif
 
     if (p.zRaw > 0) {  // Touch detected
         // Map raw touch coordinates to screen pixels
@@ -183,6 +507,58 @@ bool shouldUseWhiteText(const String& colorName) {
     return false;
 }
 
+/* Resolve the button color of a configured entry, each distinct color name is parsed only once */
+void resolveButtonColor(libraryEntry_t* entry, std::vector<int>& resolvedEntries) {
+    // Equal color names share one string handle
+    for (int index : resolvedEntries) {
+        const libraryEntry_t* resolved = libraryGetEntry(index);
+        if (resolved->color == entry->color) {
+            entry->rgb = resolved->rgb;
+            entry->whiteText = resolved->whiteText;
+            return;
+        }
+    }
+
+    String colorName = libraryString(entry->color);
+    entry->rgb = lv_color_to_u32(getColorFromName(colorName)) & 0xFFFFFF;
+    entry->whiteText = shouldUseWhiteText(colorName);
+    resolvedEntries.push_back(entry - libraryGetEntry(0));
+}
+
+/* Return the shared style handle for a resolved color, creating the style the first time it is seen */
+int internButtonStyle(uint32_t rgb, bool whiteText) {
+    for (size_t i = 0; i < buttonStyles.size(); i++) {
+        if (buttonStyles[i]->rgb == rgb && buttonStyles[i]->whiteText == whiteText) {
+            return i;
+        }
+    }
+
+    ButtonStyle* buttonStyle = new ButtonStyle();
+    buttonStyle->rgb = rgb;
+    buttonStyle->whiteText = whiteText;
+    lv_style_init(&buttonStyle->style);
+    lv_style_set_bg_color(&buttonStyle->style, lv_color_hex(rgb));
+    // Text color is inherited by the label
+    lv_style_set_text_color(&buttonStyle->style, whiteText ? lv_color_hex(0xFFFFFF) : lv_color_hex(0x000000));
+    buttonStyles.push_back(buttonStyle);
+    return buttonStyles.size() - 1;
+}
+
+/* Attach the shared styles to the configured library entries */
+void assignButtonStyles() {
+    for (int i = 0; i < libraryCount(); i++) {
+        libraryEntry_t* entry = libraryGetEntry(i);
+        if (entry->configured) {
+            entry->style = internButtonStyle(entry->rgb, entry->whiteText);
+        }
+    }
+}
+
+/* Shared style of a library entry */
+const lv_style_t* getButtonStyle(const libraryEntry_t* entry) {
+    return entry->style >= 0 ? &buttonStyles[entry->style]->style : &unconfiguredButtonStyle;
+}
+
 /* Initialize SD card once and keep it available */
 bool initializeSDCard() {
     if (sdCardInitialized) {
@@ -191,7 +567,7 @@ bool initializeSDCard() {
 
     // Try to initialize SD card multiple times
     for (int attempt = 0; attempt < 3; attempt++) {
-        if (SD.begin(SD_CS, sdSPI, 80000000)) {
+        if (SD.begin(SD_CS, sdSPI, 80000000, SD_MOUNT_POINT)) {
             sdCardInitialized = true;
             Serial.println("SD Card initialized successfully");
             return true;
@@ -204,25 +580,88 @@ bool initializeSDCard() {
     return false;
 }
 
-/* Read and parse configuration file */
-void readConfigFile() {
-    buttonConfigs.clear();
-    configuredVolume = DEFAULT_VOLUME; // Reset to default
+/* Directory of the current bank */
+String bankDirectory() {
+    return currentBank.isEmpty() ? String("/") : "/" + currentBank;
+}
 
-    // Initialize SD card if not already done
-    if (!initializeSDCard()) {
-        Serial.println("SD Card not available for config reading");
+/* Path of a file in the current bank */
+String bankPath(const char* name) {
+    return (currentBank.isEmpty() ? String("/") : "/" + currentBank + "/") + name;
+}
+
+/* Subdirectories shown as banks, hidden and system folders are left out */
+bool isBankFolder(const char* name) {
+    return name[0] != '.' && strcmp(name, "System Volume Information") != 0;
+}
+
+/* One button line of the configuration file */
+struct ConfigLine {
+    String filename;
+    String label;
+    String color;
+    uint16_t speed = 0;      // voice speed in 1/1000, 0 = plain clip
+    uint8_t pitchJitter = 0; // +-% per trigger
+    bool loop = false;       // clip repeats until its button is pressed again
+    uint32_t loopStart = 0;  // loop window in frames of the file
+    uint32_t loopEnd = 0;    // 0 = end of file
+};
+
+/* Voice field of a button line: speed factor, optionally ~ and a random +-% per trigger,
+   e.g. "1.5" or "1.0~8". WAV files with this field are played as overlapping voices. */
+void parseVoiceField(String field, ConfigLine& configLine) {
+    field.trim();
+    if (field.length() == 0) {
         return;
     }
+    int tilde = field.indexOf('~');
+    float speed = (tilde >= 0 ? field.substring(0, tilde) : field).toFloat();
+    if (speed < VOICE_SPEED_MIN || speed > VOICE_SPEED_MAX) {
+        Serial.println("Invalid voice speed: " + field + ", playing as a clip");
+        return;
+    }
+    configLine.speed = lroundf(speed * 1000);
+    if (tilde >= 0) {
+        configLine.pitchJitter = constrain(field.substring(tilde + 1).toInt(), 0, 50);
+    }
+}
 
-    File configFile = SD.open(CONFIG_FILE);
+/* Loop field of a button line: "loop" repeats the whole clip, "start-end" the frames from
+   start up to end at the sample rate of the file, "start-" up to the end of the file. */
+void parseLoopField(String field, ConfigLine& configLine) {
+    field.trim();
+    if (field.length() == 0) {
+        return;
+    }
+    if (field.equalsIgnoreCase("loop")) {
+        configLine.loop = true;
+        return;
+    }
+    int dash = field.indexOf('-');
+    long start = dash >= 0 ? field.substring(0, dash).toInt() : -1;
+    long end = dash >= 0 ? field.substring(dash + 1).toInt() : 0;
+    if (start < 0 || end < 0 || (end > 0 && end <= start)) {
+        Serial.println("Invalid loop points: " + field + ", playing once");
+        return;
+    }
+    configLine.loop = true;
+    configLine.loopStart = start;
+    configLine.loopEnd = end;
+}
+
+/* Read the configuration file into button lines and settings, false if there is none */
+bool parseConfigFile(std::vector<ConfigLine>& lines, SoundboardSettings& settings) {
+    settings.volume = DEFAULT_VOLUME; // Reset to default
+    settings.bankMirror = false;
+
+    // Every bank may have its own config, settings are only taken from the root config
+    File configFile = SD.open(bankPath(CONFIG_FILE + 1));
     if (!configFile) {
         Serial.println("Configuration file not found, using default settings");
-        return;
+        return false;
     }
 
     Serial.println("Reading configuration file...");
-    int order = 0;
 
     while (configFile.available()) {
         String line = configFile.readStringUntil('\n');
@@ -237,7 +676,7 @@ void readConfigFile() {
         if (line.startsWith("VOLUME=")) {
             int volume = line.substring(7).toInt();
             if (volume >= 0 && volume <= 21) {
-                configuredVolume = volume;
+                settings.volume = volume;
                 Serial.println("Volume configured to: " + String(volume) + "/21");
             } else {
                 Serial.println("Invalid volume value: " + String(volume) + ", using default");
@@ -245,35 +684,139 @@ void readConfigFile() {
             continue;
         }
 
-        // Parse button format: filename|label|color
+        // Check for flash bank mirror setting (format: BANK_MIRROR=1)
+        if (line.startsWith("BANK_MIRROR=")) {
+            settings.bankMirror = line.substring(12).toInt() != 0;
+            Serial.println("Flash bank mirror " + String(settings.bankMirror ? "enabled" : "disabled"));
+            continue;
+        }
+
+        // Parse button format: filename|label|color[|speed[~jitter][|loop]]
         int firstPipe = line.indexOf('|');
         int secondPipe = line.indexOf('|', firstPipe + 1);
 
         if (firstPipe > 0 && secondPipe > firstPipe) {
-            ButtonConfig config;
-            config.filename = line.substring(0, firstPipe);
-            config.label = line.substring(firstPipe + 1, secondPipe);
-            config.color = line.substring(secondPipe + 1);
-            config.order = order++;
-            config.found = false;
-
-            buttonConfigs.push_back(config);
-            Serial.println("Config: " + config.filename + " -> " + config.label + " (" + config.color + ")");
+            ConfigLine configLine;
+            configLine.filename = line.substring(0, firstPipe);
+            configLine.label = line.substring(firstPipe + 1, secondPipe);
+            int thirdPipe = line.indexOf('|', secondPipe + 1);
+            if (thirdPipe > secondPipe) {
+                configLine.color = line.substring(secondPipe + 1, thirdPipe);
+                int fourthPipe = line.indexOf('|', thirdPipe + 1);
+                if (fourthPipe > thirdPipe) {
+                    parseVoiceField(line.substring(thirdPipe + 1, fourthPipe), configLine);
+                    parseLoopField(line.substring(fourthPipe + 1), configLine);
+                } else {
+                    parseVoiceField(line.substring(thirdPipe + 1), configLine);
+                }
+            } else {
+                configLine.color = line.substring(secondPipe + 1);
+            }
+            Serial.println("Config: " + configLine.filename + " -> " + configLine.label + " (" + configLine.color + ")" +
+                           (configLine.speed ? " voice x" + String(configLine.speed / 1000.0f, 2) : "") +
+                           (configLine.loop ? " loop " + String(configLine.loopStart) + "-" + (configLine.loopEnd ? String(configLine.loopEnd) : "") : ""));
+            lines.push_back(configLine);
         }
     }
 
     configFile.close();
-    Serial.println("Configuration loaded: " + String(buttonConfigs.size()) + " entries, Volume: " + String(configuredVolume) + "/21");
+    return true;
 }
 
-/* Scan SD card root directory and populate file list */
-void scanSDCard() {
-    unconfiguredFiles.clear();
+/* Read and parse configuration file */
+void readConfigFile() {
+    // The UI may still show the previous bank
+    lvglLock();
+    libraryClear();
+    lvglUnlock();
+    if (currentBank.isEmpty()) {
+        configuredVolume = DEFAULT_VOLUME; // Reset to default
+        bankMirrorEnabled = false;
+    }
 
+    // Initialize SD card if not already done
+    if (!initializeSDCard()) {
+        Serial.println("SD Card not available for config reading");
+        return;
+    }
+
+    std::vector<ConfigLine> lines;
+    SoundboardSettings settings;
+    if (!parseConfigFile(lines, settings)) {
+        return;
+    }
+    if (currentBank.isEmpty()) {
+        configuredVolume = settings.volume;
+        bankMirrorEnabled = settings.bankMirror;
+    }
+
+    std::vector<int> resolvedEntries;  // First entry of every distinct color
+    lvglLock();
+    for (size_t i = 0; i < lines.size(); i++) {
+        int index = libraryAddConfig(lines[i].filename.c_str(), lines[i].label.c_str(), lines[i].color.c_str(), i);
+        librarySetVoice(index, lines[i].speed, lines[i].pitchJitter);
+        librarySetLoop(index, lines[i].loop, lines[i].loopStart, lines[i].loopEnd);
+        libraryEntry_t* entry = libraryGetEntry(index);
+        if (entry) {
+            resolveButtonColor(entry, resolvedEntries);
+        }
+    }
+    lvglUnlock();
+
+    Serial.println("Configuration loaded: " + String(libraryCount()) + " entries, " +
+                   String(resolvedEntries.size()) + " colors, Volume: " + String(configuredVolume) + "/21");
+}
+
+/* Apply an edited configuration file to the library in place, only entries whose line
+   changed get a new color. Returns the number of changed entries. */
+int reloadConfigFile() {
+    std::vector<ConfigLine> lines;
+    SoundboardSettings settings;
+    parseConfigFile(lines, settings);
+
+    int changes = 0;
+    std::vector<int> resolvedEntries;  // First changed entry of every distinct color
+    lvglLock();
+    libraryMarkClear();
+    for (size_t i = 0; i < lines.size(); i++) {
+        bool changed;
+        int index = libraryUpdateConfig(lines[i].filename.c_str(), lines[i].label.c_str(), lines[i].color.c_str(), i, &changed);
+        bool playback = librarySetVoice(index, lines[i].speed, lines[i].pitchJitter);
+        playback |= librarySetLoop(index, lines[i].loop, lines[i].loopStart, lines[i].loopEnd);
+        if (playback && !changed) {
+            changes++;  // Same button, only the playback changed
+        }
+        libraryEntry_t* entry = libraryGetEntry(index);
+        if (entry && changed) {
+            resolveButtonColor(entry, resolvedEntries);
+            changes++;
+        }
+    }
+    changes += libraryEndConfigUpdate();
+    lvglUnlock();
+
+    if (currentBank.isEmpty()) {
+        if (settings.volume != configuredVolume) {
+            configuredVolume = settings.volume;
+            audioSetVolume(configuredVolume);
+            Serial.println("Audio volume set to: " + String(configuredVolume) + "/21");
+        }
+        // Disabling takes effect right away, the mirror itself is only synced at boot
+        bankMirrorEnabled = settings.bankMirror;
+    }
+
+    Serial.println("Configuration reloaded: " + String(lines.size()) + " entries, " + String(changes) + " changed");
+    return changes;
+}
+
+/* Scan the directory of the current bank and add the files and folders to the library */
+void scanSDCard() {
     // Use already initialized SD card
     if (!sdCardInitialized) {
         Serial.println("SD Card not initialized!");
-        unconfiguredFiles.emplace_back("SD Card Error");
+        lvglLock();
+        libraryAddFile("SD Card Error");
+        lvglUnlock();
         return;
     }
 
@@ -281,67 +824,84 @@ void scanSDCard() {
     uint8_t cardType = SD.cardType();
     if (cardType == CARD_NONE) {
         Serial.println("No SD card attached");
-        unconfiguredFiles.emplace_back("No SD Card");
+        lvglLock();
+        libraryAddFile("No SD Card");
+        lvglUnlock();
         return;
     }
 
-    Serial.println("Scanning SD card for MP3 files...");
-
-    // Mark configured files as found and collect unconfigured MP3 files
-    for (auto& config : buttonConfigs) {
-        // Add delay between file checks to avoid rapid SD access
-        // delay(50);
+    Serial.println("Scanning " + bankDirectory() + " for MP3 files...");
 
-        if (SD.exists("/" + config.filename)) {
-            config.found = true;
-            Serial.println("Found configured file: " + config.filename);
-        } else {
-            Serial.println("Configured file not found: " + config.filename);
-        }
-    }
-
-    // Open root directory and scan for MP3 files
-    File root = SD.open("/");
+    // Open the bank directory and scan for MP3 files, subfolders are only listed
+    File root = SD.open(bankDirectory());
     if (!root) {
         Serial.println("Failed to open root directory");
-        unconfiguredFiles.emplace_back("Directory Error");
+        lvglLock();
+        libraryAddFile("Directory Error");
+        lvglUnlock();
         return;
     }
 
-    // Read all MP3 files in root directory
+    // One pass over the directory: configured files are marked found through the
+    // hash index, other MP3 files are added as unconfigured. The UI may already show
+    // the library, so each change is made under the LVGL lock.
+    int configuredFound = 0;
+    int unconfiguredCount = 0;
+    int folderCount = 0;
+    if (!currentBank.isEmpty()) {
+        lvglLock();
+        libraryAddFolder(BANK_BACK);
+        lvglUnlock();
+    }
     File file = root.openNextFile();
     while (file) {
-        if (!file.isDirectory()) {
+        if (file.isDirectory()) {
+            if (isBankFolder(file.name())) {
+                lvglLock();
+                libraryAddFolder(file.name());
+                lvglUnlock();
+                folderCount++;
+            }
+        } else {
             String fileName = String(file.name());
 
-            // Only process MP3 files
-            if (fileName.endsWith(".mp3") || fileName.endsWith(".MP3")) {
-                bool isConfigured = false;
-
-                // Check if file is in the configuration
-                for (const auto& config : buttonConfigs) {
-                    if (config.filename == fileName) {
-                        isConfigured = true;
-                        break;
-                    }
-                }
-
-                if (!isConfigured) {
-                    unconfiguredFiles.emplace_back(fileName);
-                    Serial.println("Found unconfigured MP3 file: " + fileName);
-                }
+            lvglLock();
+            bool configured = libraryMarkFound(fileName.c_str(), file.size());
+            bool added = !configured && (fileName.endsWith(".mp3") || fileName.endsWith(".MP3")); // Only process MP3 files
+            if (added) {
+                libraryAddFile(fileName.c_str(), file.size());
+            }
+            lvglUnlock();
+
+            if (configured) {
+                configuredFound++;
+                Serial.println("Found configured file: " + fileName);
+            } else if (added) {
+                unconfiguredCount++;
+                Serial.println("Found unconfigured MP3 file: " + fileName);
             }
         }
 
         file.close(); // Properly close each file
-        delay(10); // Small delay between file operations
         file = root.openNextFile();
     }
 
     root.close();
 
-    Serial.println("SD scan complete. Found " + String(buttonConfigs.size()) + " configured files, " +
-                   String(unconfiguredFiles.size()) + " unconfigured MP3 files");
+    lvglLock();
+    libraryCheckSequences();
+    lvglUnlock();
+
+    // Report configured files that are missing
+    for (int i = 0; i < libraryCount(); i++) {
+        const libraryEntry_t* entry = libraryGetEntry(i);
+        if (entry->configured && !entry->found) {
+            Serial.println("Configured file not found: " + String(libraryString(entry->filename)));
+        }
+    }
+
+    Serial.println("SD scan complete. Found " + String(configuredFound) + " configured files, " +
+                   String(unconfiguredCount) + " unconfigured MP3 files, " + String(folderCount) + " folders");
 }
 
 /* Initialize audio system */
@@ -350,15 +910,31 @@ bool initializeAudio() {
         return true;
     }
 
-    // Initialize the CYD28_audio system
+    // Initialize the CYD28_audio system and the sound effect cache
     audioInit();
+    voiceInit();
     audioInitialized = true;
     Serial.println("Audio system initialized successfully");
     return true;
 }
 
-/* Play MP3 file from SD card */
-void playMP3File(const String& filename) {
+#if VU_METER
+/* Restart the level meter polling, called with the LVGL lock held when a clip or voice starts */
+void vuMeterWake() {
+    vuSilentTicks = 0;
+    if (vuTimer) {
+        lv_timer_resume(vuTimer);
+    }
+}
+#endif
+
+/* Play the MP3 file of a library entry */
+void playMP3File(int entryIndex) {
+    const libraryEntry_t* entry = libraryGetEntry(entryIndex);
+    if (!entry) {
+        return;
+    }
+
     if (!audioInitialized) {
         if (!initializeAudio()) {
             Serial.println("Cannot play audio - initialization failed");
@@ -366,22 +942,66 @@ void playMP3File(const String& filename) {
         }
     }
 
+    // A looping clip runs until its button is pressed again
+    if (entry->loop && currentlyPlaying == entryIndex && audioIsPlaying()) {
+        audioStopSong();
+        currentlyPlaying = -1;
+        Serial.println("Loop stopped: " + String(libraryString(entry->filename)));
+        return;
+    }
+
+    // Construct full path, a sequence starts with its first file
+    String filename = libraryString(entry->filename);
+    int sep = filename.indexOf(LIBRARY_SEQUENCE_SEP);
+    String fullPath = bankPath((sep < 0 ? filename : filename.substring(0, sep)).c_str());
+
+    // Sound effects overlap the playing clip and each other
+    if (entry->speed) {
+        float speed = entry->speed / 1000.0f;
+        if (entry->pitchJitter) {
+            speed *= 1.0f + random(-entry->pitchJitter * 10, entry->pitchJitter * 10 + 1) / 1000.0f;
+        }
+        if (voicePlay(fullPath.c_str(), speed) >= 0) {
+#if VU_METER
+            vuMeterWake();
+#endif
+            Serial.println("Voice: " + filename + " x" + String(speed, 2));
+            return;
+        }
+        // Not a PCM WAV or too large for the cache, play it as a clip
+    }
+
     // Stop current playback if any
     if (audioIsPlaying()) {
         audioStopSong();
         Serial.println("Stopped current playback");
     }
 
-    // Construct full path
-    String fullPath = "/" + filename;
+    // Prefer the flash bank mirror (root clips only), fall back to the SD card.
+    // Sequences are queued on the SD card, so they start there as well.
+    uint32_t clipLength = 0;
+    const uint8_t* clip = bankMirrorEnabled && currentBank.isEmpty() && sep < 0 ? bankMapClip(filename, &clipLength) : nullptr;
 
-    // Play the selected file using CYD28_audio
-    if (audioConnecttoSD(fullPath.c_str())) {
-        currentlyPlaying = filename;
+    // Play the selected file using CYD28_audio, loop points apply to the next connect
+    if (entry->loop) {
+        audioSetLoop(entry->loopStart, entry->loopEnd);
+    }
+    if (clip ? audioConnecttoFlash(clip, clipLength, fullPath.c_str()) : audioConnecttoSD(fullPath.c_str())) {
+        // The rest of a sequence follows gaplessly
+        while (sep >= 0) {
+            int next = filename.indexOf(LIBRARY_SEQUENCE_SEP, sep + 1);
+            String part = next < 0 ? filename.substring(sep + 1) : filename.substring(sep + 1, next);
+            audioQueueSD(bankPath(part.c_str()).c_str());
+            sep = next;
+        }
+        currentlyPlaying = entryIndex;
+#if VU_METER
+        vuMeterWake();
+#endif
         Serial.println("Now playing: " + filename);
     } else {
         Serial.println("Failed to play: " + filename);
-        currentlyPlaying = "";
+        currentlyPlaying = -1;
     }
 }
 
@@ -389,28 +1009,54 @@ void playMP3File(const String& filename) {
 void stopAudio() {
     if (audioInitialized && audioIsPlaying()) {
         audioStopSong();
-        currentlyPlaying = "";
+        currentlyPlaying = -1;
         Serial.println("Audio playback stopped");
     }
 }
 
+/* Ask the boot task to open a folder of the current bank, or the parent for BANK_BACK.
+   Called from the UI with the LVGL lock held. */
+void requestBank(const char* folder) {
+    if (strcmp(folder, BANK_BACK) == 0) {
+        int slash = currentBank.lastIndexOf('/');
+        pendingBank = slash > 0 ? currentBank.substring(0, slash) : String("");
+    } else {
+        pendingBank = currentBank.isEmpty() ? String(folder) : currentBank + "/" + folder;
+    }
+    bankRequested = true;
+    if (bootTaskHandle) {
+        xTaskNotifyGive(bootTaskHandle);
+    }
+}
+
+/* Hide the search screen, the pager is shown again */
+void close_search() {
+    if (searchScreen) {
+        lv_obj_add_flag(searchScreen, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
 /* Handle button clicks on file list items */
 static void file_list_event_handler(lv_event_t * e) {
     lv_event_code_t code = lv_event_get_code(e);
     lv_obj_t * obj = lv_event_get_target_obj(e);
 
     if (code == LV_EVENT_CLICKED) {
-        // Get filename from user data
-        const char* filename = (const char*)lv_obj_get_user_data(obj);
-        if (filename) {
-            Serial.println("Selected file: " + String(filename));
-            playMP3File(String(filename));  // Play the selected MP3 file
+        // User data holds the library entry index + 1, nullptr for an empty cell
+        intptr_t entryIndex = (intptr_t)lv_obj_get_user_data(obj) - 1;
+        const libraryEntry_t* entry = libraryGetEntry(entryIndex);
+        if (entry && entry->folder) {
+            requestBank(libraryString(entry->filename));  // Open the folder, loaded by the boot task
+            close_search();
+        } else if (entry) {
+            Serial.println("Selected file: " + String(libraryString(entry->filename)));
+            playMP3File(entryIndex);  // Play the selected MP3 file
         }
     }
 }
 
-/* Create a configurable grid of buttons within a container */
-lv_obj_t* create_button_grid(lv_obj_t* parent, const std::vector<ButtonConfig>& configs, const std::vector<String>& unconfigured, int start_index) {
+/* Create an empty grid page holding a fixed pool of buttons */
+lv_obj_t* create_button_grid(lv_obj_t* parent) {
     // Create grid container with full screen height
     lv_obj_t* grid = lv_obj_create(parent);
     lv_obj_set_size(grid, TFT_HOR_RES - 10, TFT_VER_RES - 10); // Use full screen size minus small margin
@@ -437,116 +1083,772 @@ lv_obj_t* create_button_grid(lv_obj_t* parent, const std::vector<ButtonConfig>&
     lv_obj_set_grid_dsc_array(grid, col_dsc, row_dsc);
     lv_obj_set_layout(grid, LV_LAYOUT_GRID);
 
-    // Combine configured and unconfigured files
-    std::vector<std::pair<String, String>> all_files; // filename, label pairs
+    // One button with a label per cell, contents are bound later by bind_button_grid()
+    for (int slot = 0; slot < GRID_BUTTONS_MAX; slot++) {
+        lv_obj_t* btn = lv_button_create(grid);
+        lv_obj_set_grid_cell(btn, LV_GRID_ALIGN_STRETCH, slot % GRID_COLS, 1, LV_GRID_ALIGN_STRETCH, slot / GRID_COLS, 1);
+        lv_obj_add_event_cb(btn, file_list_event_handler, LV_EVENT_CLICKED, nullptr); // Only listen for clicks
+        lv_obj_add_flag(btn, LV_OBJ_FLAG_HIDDEN);
 
-    // Add configured files first (in order)
-    for (const auto& config : configs) {
-        if (config.found) {
-            all_files.emplace_back(config.filename, config.label);
-        }
+        lv_obj_t* label = lv_label_create(btn);
+        lv_obj_center(label);
+    }
+
+    return grid;
+}
+
+/* Show a library entry on a pooled button: style, label and entry index, -1 hides the button */
+void bind_button(lv_obj_t* btn, const lv_style_t** boundStyle, int entryIndex) {
+    lv_obj_t* label = lv_obj_get_child(btn, 0);
+    const libraryEntry_t* entry = libraryGetEntry(entryIndex);
+
+    if (!entry) {
+        // Past the end of the library, keep the cell empty
+        lv_obj_add_flag(btn, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_set_user_data(btn, nullptr);
+        return;
     }
 
-    // Add unconfigured files
-    for (const auto& fileName : unconfigured) {
-        String displayName = fileName;
-        if (displayName.endsWith(".mp3") || displayName.endsWith(".MP3")) {
-            displayName = displayName.substring(0, displayName.length() - 4);
+#if BUTTON_STYLE_CACHE
+    // Swap the shared style, nothing is parsed or allocated here
+    const lv_style_t* style = getButtonStyle(entry);
+    if (*boundStyle != style) {
+        if (!*boundStyle || !lv_obj_replace_style(btn, *boundStyle, style, LV_PART_MAIN)) {
+            lv_obj_add_style(btn, style, LV_PART_MAIN);
         }
-        all_files.emplace_back(fileName, displayName);
+        *boundStyle = style;
     }
+#else
+    if (entry->configured) {
+        // Use configured color, text color based on background brightness
+        lv_obj_set_style_bg_color(btn, lv_color_hex(entry->rgb), LV_PART_MAIN);
+        lv_obj_set_style_text_color(label, entry->whiteText ?
+            lv_color_hex(0xFFFFFF) : lv_color_hex(0x000000), LV_PART_MAIN);
+    } else {
+        // Use default styling for unconfigured files
+        lv_obj_set_style_bg_color(btn, lv_color_hex(0x808080), LV_PART_MAIN);  // Gray
+        lv_obj_set_style_text_color(label, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
+    }
+#endif
 
-    // Create buttons for this grid (limited by GRID_BUTTONS_MAX)
-    int buttons_created = 0;
-    for (int i = start_index; i < all_files.size() && buttons_created < GRID_BUTTONS_MAX; i++, buttons_created++) {
-        int row = buttons_created / GRID_COLS;
-        int col = buttons_created % GRID_COLS;
+    if (!entry->folder) {
+        lv_label_set_text(label, libraryString(entry->label));
+    } else if (strcmp(libraryString(entry->filename), BANK_BACK) == 0) {
+        lv_label_set_text(label, LV_SYMBOL_LEFT " Back");
+    } else {
+        lv_label_set_text_fmt(label, LV_SYMBOL_DIRECTORY " %s", libraryString(entry->label));
+    }
 
-        lv_obj_t* btn = lv_button_create(grid);
-        lv_obj_set_grid_cell(btn, LV_GRID_ALIGN_STRETCH, col, 1, LV_GRID_ALIGN_STRETCH, row, 1);
-        lv_obj_add_event_cb(btn, file_list_event_handler, LV_EVENT_CLICKED, nullptr); // Only listen for clicks
+    // Store the entry index in user data, the audio path looks the file up by index
+    lv_obj_set_user_data(btn, (void*)(intptr_t)(entryIndex + 1));
+    lv_obj_remove_flag(btn, LV_OBJ_FLAG_HIDDEN);
+}
 
-        // Find button configuration for styling
-        ButtonConfig* config = nullptr;
-        for (auto& cfg : buttonConfigs) {
-            if (cfg.filename == all_files[i].first) {
-                config = &cfg;
-                break;
-            }
+/* Show a library page in a grid: rebind label, style and file name of every pooled button */
+void bind_button_grid(PagerGrid& grid, int page) {
+    for (int slot = 0; slot < GRID_BUTTONS_MAX; slot++) {
+        bind_button(lv_obj_get_child(grid.obj, slot), &grid.styles[slot], libraryAt(page, slot));
+    }
+}
+
+/* Keep the page objects centred around the visible page once scrolling has settled */
+static void pager_scroll_event_handler(lv_event_t * e) {
+    static bool shifting = false;
+
+    // The snap animation is still running, it sends its own SCROLL_END when done
+    if (shifting || lv_anim_get(file_list, NULL)) return;
+
+    // Find the page object closest to the centre of the screen
+    lv_area_t listArea;
+    lv_obj_get_coords(file_list, &listArea);
+    int32_t centerX = (listArea.x1 + listArea.x2) / 2;
+    int visibleSlot = 0;
+    int32_t bestDistance = INT32_MAX;
+    for (int i = 0; i < pagerGridCount; i++) {
+        lv_area_t gridArea;
+        lv_obj_get_coords(pagerGrids[i].obj, &gridArea);
+        int32_t distance = LV_ABS((gridArea.x1 + gridArea.x2) / 2 - centerX);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            visibleSlot = i;
         }
+    }
+
+    // Wanted window: the visible page in the middle, clamped at both ends of the library
+    int firstPage = LV_CLAMP(0, pagerFirstPage + visibleSlot - 1, pagerPageCount - pagerGridCount);
+    int32_t pitch = lv_obj_get_width(pagerGrids[0].obj) + GRID_GAP;
+
+    shifting = true;
+    while (pagerFirstPage < firstPage) {
+        // Moving forward: recycle the leftmost page object as the new right neighbour
+        PagerGrid grid = pagerGrids[0];
+        for (int i = 0; i < pagerGridCount - 1; i++) pagerGrids[i] = pagerGrids[i + 1];
+        pagerFirstPage++;
+        pagerGrids[pagerGridCount - 1] = grid;
+        bind_button_grid(pagerGrids[pagerGridCount - 1], pagerFirstPage + pagerGridCount - 1);
+        lv_obj_move_to_index(grid.obj, -1);
+        lv_obj_update_layout(file_list);
+        lv_obj_scroll_by(file_list, pitch, 0, LV_ANIM_OFF); // Content moved left by one page
+    }
+    while (pagerFirstPage > firstPage) {
+        // Moving back: recycle the rightmost page object as the new left neighbour
+        PagerGrid grid = pagerGrids[pagerGridCount - 1];
+        for (int i = pagerGridCount - 1; i > 0; i--) pagerGrids[i] = pagerGrids[i - 1];
+        pagerFirstPage--;
+        pagerGrids[0] = grid;
+        bind_button_grid(pagerGrids[0], pagerFirstPage);
+        lv_obj_move_to_index(grid.obj, 0);
+        lv_obj_update_layout(file_list);
+        lv_obj_scroll_by(file_list, -pitch, 0, LV_ANIM_OFF); // Content moved right by one page
+    }
+    shifting = false;
+}
+
+/* Create the page objects and show the first pages of the library */
+void create_pager(lv_obj_t* parent) {
+    pagerPageCount = libraryPageCount();
+
+    lv_style_init(&unconfiguredButtonStyle);
+    lv_style_set_bg_color(&unconfiguredButtonStyle, lv_color_hex(0x808080));  // Gray
+    lv_style_set_text_color(&unconfiguredButtonStyle, lv_color_hex(0xFFFFFF));
+
+    lv_mem_monitor_t memBefore, memAfter;
+    lv_mem_monitor(&memBefore);
+    uint32_t bindUs = 0;
+
+    pagerGridCount = LV_MIN(pagerPageCount, PAGER_PAGES);
+    pagerFirstPage = 0;
+    for (int i = 0; i < pagerGridCount; i++) {
+        pagerGrids[i].obj = create_button_grid(parent); // Grid is automatically added to the flex container
+        memset(pagerGrids[i].styles, 0, sizeof(pagerGrids[i].styles));
+        uint32_t bindStart = micros();
+        bind_button_grid(pagerGrids[i], i);
+        bindUs += micros() - bindStart;
+    }
+
+    lv_mem_monitor(&memAfter);
+    int buttons = pagerGridCount * GRID_BUTTONS_MAX;
+    Serial.println(String("Button styles: ") + (BUTTON_STYLE_CACHE ? "shared" : "local") + ", LVGL heap " +
+                   String((memBefore.free_size - memAfter.free_size) / buttons) + " bytes per button, page bind " +
+                   String(bindUs / pagerGridCount) + " us");
+
+    lv_obj_add_event_cb(parent, pager_scroll_event_handler, LV_EVENT_SCROLL_END, nullptr);
+}
+
+/* Rebind the pager after the library layout changed, the visible page is kept if it still exists */
+void refresh_pager() {
+    pagerPageCount = libraryPageCount();
+    int gridCount = LV_MIN(pagerPageCount, PAGER_PAGES);
+
+    while (pagerGridCount < gridCount) {
+        pagerGrids[pagerGridCount].obj = create_button_grid(file_list);
+        memset(pagerGrids[pagerGridCount].styles, 0, sizeof(pagerGrids[pagerGridCount].styles));
+        pagerGridCount++;
+    }
+    while (pagerGridCount > gridCount) {
+        pagerGridCount--;
+        lv_obj_delete(pagerGrids[pagerGridCount].obj);
+    }
+
+    pagerFirstPage = LV_CLAMP(0, pagerFirstPage, pagerPageCount - pagerGridCount);
+    for (int i = 0; i < pagerGridCount; i++) {
+        bind_button_grid(pagerGrids[i], pagerFirstPage + i);
+    }
+}
+
+/* Run the query of the search screen and show the first matches in its grid */
+void update_search() {
+    if (!searchScreen || lv_obj_has_flag(searchScreen, LV_OBJ_FLAG_HIDDEN)) {
+        return;
+    }
+
+    const char* query = lv_textarea_get_text(searchInput);
+    int results[GRID_BUTTONS_MAX];
+    uint32_t start = micros();
+    int found = librarySearch(query, results, GRID_BUTTONS_MAX);
+    uint32_t searchUs = micros() - start;
+    for (int slot = 0; slot < GRID_BUTTONS_MAX; slot++) {
+        bind_button(lv_obj_get_child(searchGrid.obj, slot), &searchGrid.styles[slot], slot < found ? results[slot] : -1);
+    }
+
+    if (*query == 0) {
+        lv_label_set_text(searchCount, "");
+    } else {
+        // The search stops after one page, more matches show as "12+"
+        lv_label_set_text_fmt(searchCount, found > GRID_BUTTONS_MAX ? "%d+" : "%d", LV_MIN(found, GRID_BUTTONS_MAX));
+        Serial.println("Search \"" + String(query) + "\": " + String(found) + " matches in " + String(searchUs) +
+                       " us, bound in " + String(micros() - start - searchUs) + " us");
+    }
+}
+
+/* Size the result grid to the space left by the keyboard */
+void show_search_keyboard(bool show) {
+    if (show) {
+        lv_obj_remove_flag(searchKeyboard, LV_OBJ_FLAG_HIDDEN);
+    } else {
+        lv_obj_add_flag(searchKeyboard, LV_OBJ_FLAG_HIDDEN);
+    }
+    int32_t keyboardHeight = show ? lv_obj_get_height(searchKeyboard) : 0;
+    lv_obj_set_height(searchGrid.obj, TFT_VER_RES - SEARCH_BAR_HEIGHT - keyboardHeight);
+}
+
+static void search_event_handler(lv_event_t * e) {
+    lv_event_code_t code = lv_event_get_code(e);
+    lv_obj_t * obj = lv_event_get_target_obj(e);
 
-        if (config) {
-            // Use configured color
-            lv_color_t btnColor = getColorFromName(config->color);
-            lv_obj_set_style_bg_color(btn, btnColor, LV_PART_MAIN);
+    if (obj == searchInput && code == LV_EVENT_VALUE_CHANGED) {
+        update_search();  // Every keystroke
+    } else if (obj == searchInput && code == LV_EVENT_CLICKED) {
+        show_search_keyboard(true);
+    } else if (obj == searchKeyboard && code == LV_EVENT_READY) {
+        show_search_keyboard(false);  // Results on the whole screen
+    } else if (code == LV_EVENT_CANCEL || code == LV_EVENT_CLICKED) {
+        close_search();  // Keyboard close key or the close button
+    }
+}
 
-            // Set text color based on background brightness
-            lv_color_t textColor = shouldUseWhiteText(config->color) ?
-                lv_color_hex(0xFFFFFF) : lv_color_hex(0x000000);
+/* Create the search screen: query field, a temporary result grid and the keyboard */
+void create_search(lv_obj_t* parent) {
+    searchScreen = lv_obj_create(parent);
+    lv_obj_set_size(searchScreen, TFT_HOR_RES, TFT_VER_RES);
+    lv_obj_set_style_pad_all(searchScreen, 0, 0);
+    lv_obj_set_style_radius(searchScreen, 0, 0);
+    lv_obj_remove_flag(searchScreen, LV_OBJ_FLAG_SCROLLABLE);
+
+    searchInput = lv_textarea_create(searchScreen);
+    lv_textarea_set_one_line(searchInput, true);
+    lv_textarea_set_placeholder_text(searchInput, "Search");
+    lv_obj_set_size(searchInput, TFT_HOR_RES - 2 * SEARCH_BAR_HEIGHT - 4, SEARCH_BAR_HEIGHT);
+    lv_obj_align(searchInput, LV_ALIGN_TOP_LEFT, 0, 0);
+    lv_obj_add_event_cb(searchInput, search_event_handler, LV_EVENT_VALUE_CHANGED, nullptr);
+    lv_obj_add_event_cb(searchInput, search_event_handler, LV_EVENT_CLICKED, nullptr);
+
+    searchCount = lv_label_create(searchScreen);
+    lv_label_set_text(searchCount, "");
+    lv_obj_align(searchCount, LV_ALIGN_TOP_RIGHT, -SEARCH_BAR_HEIGHT - 4, 10);
+
+    lv_obj_t* closeButton = lv_button_create(searchScreen);
+    lv_obj_set_size(closeButton, SEARCH_BAR_HEIGHT, SEARCH_BAR_HEIGHT);
+    lv_obj_align(closeButton, LV_ALIGN_TOP_RIGHT, 0, 0);
+    lv_obj_add_event_cb(closeButton, search_event_handler, LV_EVENT_CLICKED, nullptr);
+    lv_obj_t* closeLabel = lv_label_create(closeButton);
+    lv_label_set_text(closeLabel, LV_SYMBOL_CLOSE);
+    lv_obj_center(closeLabel);
+
+    // Same pooled buttons and click handler as the pager, results play like any page
+    searchGrid.obj = create_button_grid(searchScreen);
+    memset(searchGrid.styles, 0, sizeof(searchGrid.styles));
+    lv_obj_set_width(searchGrid.obj, TFT_HOR_RES);
+    lv_obj_align(searchGrid.obj, LV_ALIGN_TOP_MID, 0, SEARCH_BAR_HEIGHT);
+
+    searchKeyboard = lv_keyboard_create(searchScreen);
+    lv_keyboard_set_textarea(searchKeyboard, searchInput);
+    lv_obj_add_event_cb(searchKeyboard, search_event_handler, LV_EVENT_READY, nullptr);
+    lv_obj_add_event_cb(searchKeyboard, search_event_handler, LV_EVENT_CANCEL, nullptr);
+    lv_obj_update_layout(searchScreen);
+}
 
-            lv_obj_t* label = lv_label_create(btn);
-            lv_label_set_text(label, config->label.c_str());
-            lv_obj_center(label);
-            lv_obj_set_style_text_color(label, textColor, LV_PART_MAIN);
+/* Open the search screen, the index is built here rather than on the first keystroke */
+static void open_search_event_handler(lv_event_t * e) {
+    if (!searchScreen) {
+        create_search(lv_screen_active());
+    }
+    lv_obj_remove_flag(searchScreen, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_move_foreground(searchScreen);
+    show_search_keyboard(true);
+    librarySearch("", nullptr, 0);
+    update_search();
+}
 
-            // Store filename in user data - use the persistent string from buttonConfigs
-            lv_obj_set_user_data(btn, (void*)config->filename.c_str());
+#if VU_METER
+/* Draw the level meter: an RMS bar and a peak tick per channel */
+static void vu_meter_draw_cb(lv_event_t * e) {
+    lv_layer_t* layer = lv_event_get_layer(e);
+    lv_area_t coords;
+    lv_obj_get_coords(vuMeter, &coords);
+
+    lv_draw_rect_dsc_t dsc;
+    lv_draw_rect_dsc_init(&dsc);
+    for (int ch = 0; ch < 2; ch++) {
+        lv_area_t bar;
+        bar.y1 = coords.y1 + ch * (VU_METER_HEIGHT / 2);
+        bar.y2 = bar.y1 + VU_METER_HEIGHT / 2 - 2;
+        if (vuDrawn[2 + ch]) {
+            bar.x1 = coords.x1;
+            bar.x2 = coords.x1 + vuDrawn[2 + ch] - 1;
+            dsc.bg_color = lv_palette_main(LV_PALETTE_GREEN);
+            lv_draw_rect(layer, &dsc, &bar);
+        }
+        if (vuDrawn[ch]) {
+            bar.x2 = coords.x1 + vuDrawn[ch] - 1;
+            bar.x1 = bar.x2 > coords.x1 ? bar.x2 - 1 : coords.x1;
+            dsc.bg_color = lv_palette_main(vuDrawn[ch] >= VU_METER_WIDTH - 1 ? LV_PALETTE_RED : LV_PALETTE_YELLOW);
+            lv_draw_rect(layer, &dsc, &bar);
+        }
+    }
+}
+
+/* Poll the levels published by the audio task, redraw only if a bar moved by a pixel.
+   Hidden while the output is silent so it never covers a button needlessly, the timer
+   pauses once nothing plays. */
+static void vu_meter_timer_cb(lv_timer_t * timer) {
+#if DISPLAY_STATS_LOG
+    uint32_t start = micros();
+#endif
+    uint32_t levels = audioGetLevels();
+    uint8_t lengths[4];
+    for (int i = 0; i < 4; i++) {
+        lengths[i] = ((levels >> (24 - 8 * i)) & 0xFF) * VU_METER_WIDTH / 256;
+    }
+    if (memcmp(lengths, vuDrawn, sizeof(lengths))) {
+        bool wasSilent = !(vuDrawn[0] | vuDrawn[1] | vuDrawn[2] | vuDrawn[3]);
+        bool silent = !(lengths[0] | lengths[1] | lengths[2] | lengths[3]);
+        memcpy(vuDrawn, lengths, sizeof(lengths));
+        if (silent) {
+            lv_obj_add_flag(vuMeter, LV_OBJ_FLAG_HIDDEN);
+        } else if (wasSilent) {
+            lv_obj_remove_flag(vuMeter, LV_OBJ_FLAG_HIDDEN);
         } else {
-            // Use default styling for unconfigured files
-            lv_obj_set_style_bg_color(btn, lv_color_hex(0x808080), LV_PART_MAIN);  // Gray
-
-            lv_obj_t* label = lv_label_create(btn);
-            lv_label_set_text(label, all_files[i].second.c_str());
-            lv_obj_center(label);
-            lv_obj_set_style_text_color(label, lv_color_hex(0xFFFFFF), LV_PART_MAIN);
-
-            // For unconfigured files, we need to find the persistent string from unconfiguredFiles vector
-            // Find the original string in the unconfiguredFiles vector
-            const char* persistent_filename = nullptr;
-            for (const auto& unconfiguredFile : unconfigured) {
-                if (unconfiguredFile == all_files[i].first) {
-                    persistent_filename = unconfiguredFile.c_str();
-                    break;
-                }
-            }
-            lv_obj_set_user_data(btn, (void*)persistent_filename);
+            lv_obj_invalidate(vuMeter);
+        }
+#if DISPLAY_STATS_LOG
+        vuRedraws++;
+#endif
+    }
+    if (lengths[0] | lengths[1] | lengths[2] | lengths[3]) {
+        vuSilentTicks = 0;
+    } else if (++vuSilentTicks >= VU_METER_IDLE_TICKS) {
+        // A quiet passage of a playing clip keeps polling. The audio task publishes whether it
+        // plays next to the levels, the meter never sends it a message.
+        vuSilentTicks = 0;
+        if (!audioGetSounding()) {
+            lv_timer_pause(timer);
         }
     }
+#if DISPLAY_STATS_LOG
+    vuUpdateUs += micros() - start;
+    if (millis() - vuStatsStartMs >= 1000) {
+        Serial.println("VU meter: " + String(vuRedraws) + " redraws, " + String(vuUpdateUs) + " us UI in " +
+                       String(millis() - vuStatsStartMs) + " ms");
+        vuStatsStartMs = millis();
+        vuUpdateUs = 0;
+        vuRedraws = 0;
+    }
+#endif
+}
 
-    return grid;
+/* Create the level meter above the pager, it never takes input */
+void create_vu_meter(lv_obj_t* parent) {
+    vuMeter = lv_obj_create(parent);
+    lv_obj_remove_style_all(vuMeter);
+    lv_obj_set_size(vuMeter, VU_METER_WIDTH, VU_METER_HEIGHT);
+    lv_obj_align(vuMeter, LV_ALIGN_BOTTOM_LEFT, 4, -4);
+    lv_obj_set_style_bg_color(vuMeter, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(vuMeter, LV_OPA_50, 0);
+    lv_obj_remove_flag(vuMeter, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_remove_flag(vuMeter, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_flag(vuMeter, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_add_event_cb(vuMeter, vu_meter_draw_cb, LV_EVENT_DRAW_MAIN, nullptr);
+    memset(vuDrawn, 0, sizeof(vuDrawn));
+    vuSilentTicks = 0;
+    vuTimer = lv_timer_create(vu_meter_timer_cb, VU_METER_PERIOD_MS, nullptr);
+    if (audioInitialized) {
+        audioSetLevelMeter(true);
+    }
 }
+#endif
 
-void setup() {
-    Serial.begin(115200);
-    Serial.println("CYD Soundboard starting...");
+/* Describe the config file and the directory of the current bank, a cached library is valid while these match */
+bool getLibraryCacheKey(libraryCacheKey_t* key) {
+    memset(key, 0, sizeof(*key));
 
-    // Initialize touch screen (uses software SPI)
-    touchscreen.begin();
+    File configFile = SD.open(bankPath(CONFIG_FILE + 1));
+    if (configFile) {
+        key->configSize = configFile.size();
+        key->configMtime = configFile.getLastWrite();
+        configFile.close();
+    }
 
-    // Initialize LVGL graphics library
-    lv_init();
-    draw_buf = new uint8_t[DRAW_BUF_SIZE];
-    lv_display_t *disp = lv_tft_espi_create(TFT_HOR_RES, TFT_VER_RES, draw_buf, DRAW_BUF_SIZE);
+    // Hash the names and types in the bank directory, readdir() does not open the files
+    DIR* dir = opendir((SD_MOUNT_POINT + bankDirectory()).c_str());
+    if (!dir) {
+        return false;
+    }
+    uint32_t hash = 2166136261u;
+    struct dirent* dirEntry;
+    while ((dirEntry = readdir(dir)) != nullptr) {
+        if (strcmp(dirEntry->d_name, LIBRARY_CACHE_FILE + 1) == 0) {
+            continue;  // The cache itself
+        }
+        for (const char* c = dirEntry->d_name; *c; c++) {
+            hash = (hash ^ (uint8_t)*c) * 16777619u;
+        }
+        hash = (hash ^ dirEntry->d_type) * 16777619u;
+    }
+    closedir(dir);
+    key->rootHash = hash;
+    return true;
+}
 
-    // Setup touch input device
-    indev = lv_indev_create();
-    lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
-    lv_indev_set_read_cb(indev, my_touchpad_read);
+/* Hand the library to the UI: lay out the buttons and show them. Until the SD scan is
+   complete (final == false) configured buttons are shown before their file was checked. */
+void publishLibrary(bool final) {
+    lvglLock();
+    uint32_t start = millis();
+    libraryLayout(GRID_BUTTONS_MAX, !final);
+    assignButtonStyles();
+
+    if (bootLabel) {
+        lv_obj_delete(bootLabel);
+        bootLabel = nullptr;
+    }
+    if (pagerGridCount == 0) {
+        create_pager(file_list);
+    } else {
+        refresh_pager();
+    }
+    update_search();  // Results refer to button positions of the old layout
+    lvglUnlock();
 
-    // Read configuration file
+    Serial.println("Grid pager: " + String(pagerPageCount) + " pages for " + String(libraryButtonCount()) + " files, " +
+                   String(pagerGridCount) + " page objects, updated in " + String(millis() - start) + " ms");
+}
+
+/* Build the library: from the cache file when config and root directory are unchanged,
+   otherwise by parsing the config and scanning the card */
+void loadLibrary() {
+    uint32_t start = millis();
+    libraryCacheKey_t cacheKey;
+    SoundboardSettings settings;
+    bool keyValid = initializeSDCard() && SD.cardType() != CARD_NONE && getLibraryCacheKey(&cacheKey);
+    bool cacheUsable = LIBRARY_CACHE && keyValid;
+    if (keyValid) {
+        libraryKey = cacheKey;  // Compared against by watchLibrary()
+    }
+
+    // Every bank keeps its own cache file next to its clips
+    String cacheFile = bankPath(LIBRARY_CACHE_FILE + 1);
+    lvglLock();
+    bool cached = cacheUsable && libraryLoadCache(cacheFile.c_str(), &cacheKey, &settings, sizeof(settings));
+    lvglUnlock();
+    if (cached) {
+        if (currentBank.isEmpty()) {
+            configuredVolume = settings.volume;
+            bankMirrorEnabled = settings.bankMirror;
+        }
+        publishLibrary(true);
+        bootMark("library from cache, first page");
+        Serial.println("Library loaded from cache in " + String(millis() - start) + " ms (warm boot), Volume: " +
+                       String(configuredVolume) + "/21");
+        return;
+    }
+
+    // Read configuration file, the configured buttons are shown right away
     readConfigFile();
+    publishLibrary(false);
+    bootMark("config, first page");
 
     // Scan SD card for files
     scanSDCard();
+    publishLibrary(true);
+    bootMark("SD scan, all pages");
+    Serial.println("Library built from config and SD scan in " + String(millis() - start) + " ms (cold boot)");
+
+    if (cacheUsable) {
+        settings.volume = configuredVolume;
+        settings.bankMirror = bankMirrorEnabled;
+        if (!librarySaveCache(cacheFile.c_str(), &cacheKey, &settings, sizeof(settings))) {
+            Serial.println("Could not write library cache " + cacheFile);
+        }
+    }
+}
 
-    // Initialize audio system
-    initializeAudio();
+/* Switch the library to another bank: only that folder is read (or its cache file),
+   the size of the other banks does not matter */
+void openBank(const String& bank) {
+    uint32_t start = millis();
+    lvglLock();
+    // A loop only stops from its own button, which the new bank does not show
+    const libraryEntry_t* playing = currentlyPlaying >= 0 ? libraryGetEntry(currentlyPlaying) : nullptr;
+    if (playing && playing->loop && audioInitialized) {
+        audioStopSong();
+        Serial.println("Loop stopped: " + String(libraryString(playing->filename)));
+    }
+    currentBank = bank;
+    currentlyPlaying = -1;  // Entry indices refer to the new bank from here on
+    pagerFirstPage = 0;
+    lvglUnlock();
+
+    loadLibrary();
+
+    lvglLock();
+    lv_obj_scroll_to_x(file_list, 0, LV_ANIM_OFF);
+    lvglUnlock();
+    Serial.println("Bank " + bankDirectory() + " opened in " + String(millis() - start) + " ms, " +
+                   String(libraryButtonCount()) + " buttons");
+}
 
-    // Set volume from configuration
-    delay(100); // Allow time for audio system to initialize
-    audioSetVolume(configuredVolume);
-    Serial.println("Audio volume set to: " + String(configuredVolume) + "/21");
+/* Bring the library up to date with the bank directory. Only new files and configured
+   files that reappeared are opened, everything else is matched by name through the index.
+   Returns the number of changed entries. */
+int rescanBankDirectory() {
+    int changes = 0;
+    lvglLock();
+    libraryMarkClear();
+    lvglUnlock();
+
+    DIR* dir = sdCardInitialized ? opendir((SD_MOUNT_POINT + bankDirectory()).c_str()) : nullptr;
+    if (!dir) {
+        // Card gone: unconfigured files disappear, configured buttons are hidden
+        lvglLock();
+        if (libraryMarkSeen("No SD Card") < 0) {
+            libraryAddFile("No SD Card");
+            changes++;
+        }
+        changes += librarySweepUnseen();
+        changes += libraryCheckSequences();
+        lvglUnlock();
+        return changes;
+    }
+
+    lvglLock();
+    libraryMarkSeen(BANK_BACK);  // readdir() does not list it
+    lvglUnlock();
+
+    struct dirent* dirEntry;
+    while ((dirEntry = readdir(dir)) != nullptr) {
+        if (dirEntry->d_type == DT_DIR) {
+            if (!isBankFolder(dirEntry->d_name)) {
+                continue;
+            }
+            lvglLock();
+            if (libraryMarkSeen(dirEntry->d_name) < 0) {
+                libraryAddFolder(dirEntry->d_name);
+                changes++;
+            }
+            lvglUnlock();
+            continue;
+        }
+        String fileName = String(dirEntry->d_name);
+
+        lvglLock();
+        int seen = libraryMarkSeen(fileName.c_str());
+        lvglUnlock();
+        bool isMP3 = fileName.endsWith(".mp3") || fileName.endsWith(".MP3");
+        if (seen == 0 || (seen < 0 && !isMP3)) {
+            continue;  // Known and unchanged, or not a clip
+        }
+
+        struct stat st;
+        uint32_t size = stat((SD_MOUNT_POINT + bankPath(fileName.c_str())).c_str(), &st) == 0 ? st.st_size : 0;
+        lvglLock();
+        if (seen > 0) {
+            libraryMarkFound(fileName.c_str(), size);
+            Serial.println("Found configured file: " + fileName);
+        } else {
+            libraryAddFile(fileName.c_str(), size);
+            Serial.println("Found unconfigured MP3 file: " + fileName);
+        }
+        lvglUnlock();
+        changes++;
+    }
+    closedir(dir);
 
+    lvglLock();
+    changes += librarySweepUnseen();
+    changes += libraryCheckSequences();
+    lvglUnlock();
+    return changes;
+}
+
+/* Update the library after the card or the config changed. Entries keep their index, so
+   the visible page and the playing clip stay as they are. */
+void rescanLibrary(bool configChanged) {
+    uint32_t start = millis();
+    int changes = 0;
+    voiceClearCache();  // Cached samples may have been edited
+    if (configChanged) {
+        changes += reloadConfigFile();
+    }
+    changes += rescanBankDirectory();
+    if (changes > 0) {
+        publishLibrary(true);
+    }
+    Serial.println("Library rescan: " + String(changes) + " entries changed in " + String(millis() - start) + " ms");
+}
+
+/* Poll for card insertion or removal and for edits of the config file or bank directory */
+void watchLibrary() {
+    if (!sdCardInitialized) {
+        if (!SD.begin(SD_CS, sdSPI, 80000000, SD_MOUNT_POINT)) {
+            return;
+        }
+        sdCardInitialized = true;
+        Serial.println("SD card inserted");
+        openBank("");
+        return;
+    }
+
+    // Cheap check first: a stat of the config file, or of the bank directory if there is none,
+    // fails once the card is pulled and shows config edits. Listing the directory for added
+    // or removed clips waits for every LIBRARY_DIR_CHECK_EVERY-th check.
+    static uint32_t watchCount = 0;
+    struct stat st;
+    String configPath = SD_MOUNT_POINT + bankPath(CONFIG_FILE + 1);
+    bool unchanged = libraryKey.configSize ?
+        stat(configPath.c_str(), &st) == 0 && (uint32_t)st.st_size == libraryKey.configSize &&
+            (uint32_t)st.st_mtime == libraryKey.configMtime :
+        stat((SD_MOUNT_POINT + bankDirectory()).c_str(), &st) == 0 && stat(configPath.c_str(), &st) != 0;
+    if (unchanged && ++watchCount % LIBRARY_DIR_CHECK_EVERY != 0) {
+        return;
+    }
+
+    libraryCacheKey_t key;
+    bool keyValid = SD.cardType() != CARD_NONE && getLibraryCacheKey(&key);
+    if (!keyValid && !currentBank.isEmpty()) {
+        // The folder is gone, fall back to the root (which fails as well if the card was pulled)
+        Serial.println("Bank " + bankDirectory() + " not found");
+        openBank("");
+        return;
+    }
+    if (!keyValid) {
+        Serial.println("SD card removed");
+        // Nothing may read the unmounted volume: the playing clip, queued sequence parts, cached voices
+        lvglLock();
+        if (audioInitialized) {
+            audioStopSong();
+        }
+        currentlyPlaying = -1;
+        lvglUnlock();
+        voiceClearCache();
+        SD.end();
+        sdCardInitialized = false;
+        rescanLibrary(false);
+        return;
+    }
+    if (memcmp(&key, &libraryKey, sizeof(key)) == 0) {
+        return;
+    }
+
+    bool configChanged = key.configSize != libraryKey.configSize || key.configMtime != libraryKey.configMtime;
+    libraryKey = key;
+    rescanLibrary(configChanged);
+
+    if (LIBRARY_CACHE) {
+        SoundboardSettings settings;
+        settings.volume = configuredVolume;
+        settings.bankMirror = bankMirrorEnabled;
+        String cacheFile = bankPath(LIBRARY_CACHE_FILE + 1);
+        lvglLock();
+        bool saved = librarySaveCache(cacheFile.c_str(), &libraryKey, &settings, sizeof(settings));
+        lvglUnlock();
+        if (!saved) {
+            Serial.println("Could not write library cache " + cacheFile);
+        }
+    }
+}
+
+/* Boot task: everything after the UI shell, in parallel with the UI and the audio start */
+void bootTask(void *parameter) {
+    // Config and SD scan, or their cached result - publishes the first page as soon as possible
+    loadLibrary();
+
+    // Audio was started in setup() and signals when its output is running
+    if (audioWaitReady(AUDIO_READY_TIMEOUT_MS)) {
+        bootMark("audio ready", audioReadyTime());
+        audioSetVolume(configuredVolume);
+        Serial.println("Audio volume set to: " + String(configuredVolume) + "/21");
+    } else {
+        Serial.println("Audio not ready after " + String(AUDIO_READY_TIMEOUT_MS) + " ms");
+    }
+
+    // Mirror the configured clips into flash, only changed files are copied
+    bankSetFlashGuard(bankFlashEnter, bankFlashLeave);
+    if (bankMirrorEnabled && bankInit()) {
+        std::vector<String> bankFiles;
+        lvglLock();
+        for (int i = 0; i < libraryCount(); i++) {
+            const libraryEntry_t* entry = libraryGetEntry(i);
+            if (entry->configured && entry->found) bankFiles.push_back(libraryString(entry->filename));
+        }
+        lvglUnlock();
+        if (!bankSync(bankFiles)) {
+            Serial.println("Flash bank mirror not available, playing from SD card");
+        }
+        bootMark("bank mirror");
+    }
+
+#if DISPLAY_STATS_LOG
+    // Time one complete redraw of the first page
+    lvglLock();
+    uint32_t redrawStart = micros();
+    lv_obj_invalidate(lv_screen_active());
+    lv_refr_now(NULL);
+    Serial.println("Full screen redraw: " + String(micros() - redrawStart) + " us");
+    lvglUnlock();
+#endif
+
+    bootMark("boot complete");
+    printBootTimeline();
+
+    // Stay around to open banks selected in the UI and to pick up card changes and config edits
+    for (;;) {
+        bool notified = ulTaskNotifyTake(pdTRUE, LIBRARY_WATCH_INTERVAL_MS ?
+                                         pdMS_TO_TICKS(LIBRARY_WATCH_INTERVAL_MS) : portMAX_DELAY) > 0;
+        lvglLock();
+        bool switchBank = notified && bankRequested;
+        String bank = pendingBank;
+        bankRequested = false;
+        lvglUnlock();
+
+        if (switchBank) {
+            openBank(bank);
+        } else if (LIBRARY_WATCH_INTERVAL_MS) {
+            watchLibrary();
+        }
+    }
+}
+
+/* Initialize LVGL with the TFT as display and the touch controller as input device */
+void initializeDisplay() {
+    lvglMutex = xSemaphoreCreateRecursiveMutex();
+    lv_init();
+#if DISPLAY_DMA
+    // Two buffers in DMA capable memory: LVGL renders one while the other is sent to the display
+    draw_buf = (uint8_t *)heap_caps_malloc(DRAW_BUF_SIZE, MALLOC_CAP_DMA);
+    draw_buf2 = (uint8_t *)heap_caps_malloc(DRAW_BUF_SIZE, MALLOC_CAP_DMA);
+    bool dmaBuffers = draw_buf && draw_buf2;
+    if (!dmaBuffers) {
+        Serial.println("No DMA memory for two display buffers, using the blocking flush");
+        heap_caps_free(draw_buf);
+        heap_caps_free(draw_buf2);
+        draw_buf2 = nullptr;
+    }
+#else
+    bool dmaBuffers = false;
+#endif
+    if (dmaBuffers) {
+        displayCreateDma(TFT_HOR_RES, TFT_VER_RES, draw_buf, draw_buf2, DRAW_BUF_SIZE);
+    } else {
+        draw_buf = new uint8_t[DRAW_BUF_SIZE];
+        lv_tft_espi_create(TFT_HOR_RES, TFT_VER_RES, draw_buf, DRAW_BUF_SIZE);
+    }
+#if DISPLAY_STATS_LOG
+    lv_display_add_event_cb(lv_display_get_default(), display_stats_cb, LV_EVENT_ALL, nullptr);
+#endif
+
+    // Setup touch input device
+    indev = lv_indev_create();
+    lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(indev, my_touchpad_read);
+#if TOUCH_IRQ_MODE
+    // No read timer: the LVGL task reads on PENIRQ and then until release
+    lv_indev_set_mode(indev, LV_INDEV_MODE_EVENT);
+#endif
+}
+
+/* Create the main screen: the pager container, the search button, the level meter and the boot label */
+void create_main_screen() {
     // Create horizontal scrolling container for grids - now uses full screen height
     file_list = lv_obj_create(lv_screen_active());
     lv_obj_set_size(file_list, TFT_HOR_RES, TFT_VER_RES); // Use full screen size
@@ -564,35 +1866,63 @@ void setup() {
     lv_obj_set_style_pad_all(file_list, 0, 0);
     lv_obj_set_style_pad_gap(file_list, GRID_GAP, 0); // Use configurable gap between grids
 
-    // Calculate total files
-    int total_configured = 0;
-    for (const auto& config : buttonConfigs) {
-        if (config.found) total_configured++;
-    }
-    int total_files = total_configured + unconfiguredFiles.size();
+    // Search button floating above the pager
+    lv_obj_t* searchButton = lv_button_create(lv_screen_active());
+    lv_obj_set_size(searchButton, SEARCH_BAR_HEIGHT, SEARCH_BAR_HEIGHT);
+    lv_obj_align(searchButton, LV_ALIGN_BOTTOM_RIGHT, -4, -4);
+    lv_obj_set_style_bg_opa(searchButton, LV_OPA_70, 0);
+    lv_obj_add_event_cb(searchButton, open_search_event_handler, LV_EVENT_CLICKED, nullptr);
+    lv_obj_t* searchButtonLabel = lv_label_create(searchButton);
+    lv_label_set_text(searchButtonLabel, LV_SYMBOL_KEYBOARD);
+    lv_obj_center(searchButtonLabel);
+#if VU_METER
+    create_vu_meter(lv_screen_active());
+#endif
+
+    // Placeholder until the boot task publishes the first page
+    bootLabel = lv_label_create(file_list);
+    lv_label_set_text(bootLabel, "Loading...");
+}
+
+void setup() {
+    Serial.begin(115200);
+    Serial.println("CYD Soundboard starting...");
+
+    // Start the audio task first, it initializes its output on the other core
+    initializeAudio();
+
+    // Initialize touch screen (uses software SPI)
+    touchscreen.begin();
+
+    // Initialize LVGL graphics library, the display and the touch input
+    initializeDisplay();
+    bootMark("display");
 
-    // Create grids using configurable grid size
-    int num_grids = (total_files + GRID_BUTTONS_MAX - 1) / GRID_BUTTONS_MAX; // Ceiling division
+    // Pager, search button and level meter, the library is published into it later
+    create_main_screen();
 
     Serial.println("Grid config: " + String(GRID_COLS) + "x" + String(GRID_ROWS) +
                    " (" + String(GRID_BUTTONS_MAX) + " buttons per grid)");
-    Serial.println("Creating " + String(num_grids) + " grids for " + String(total_files) + " files");
 
-    for (int grid_index = 0; grid_index < num_grids; grid_index++) {
-        int start_index = grid_index * GRID_BUTTONS_MAX;
-        lv_obj_t* grid = create_button_grid(file_list, buttonConfigs, unconfiguredFiles, start_index);
-        // Grid is automatically added to the flex container
-    }
-
-    Serial.println("Setup complete!");
+    // From here on LVGL runs in its own task
+    startLvglTask();
+    bootMark("UI shell");
+
+    // Library, audio volume and flash mirror are set up in the background
+    xTaskCreatePinnedToCore(
+        bootTask,              /* Function to implement the task */
+        "boot",                /* Name of the task */
+        BOOT_TASK_STACK,       /* Stack size in bytes */
+        NULL,                  /* Task input parameter */
+        BOOT_TASK_PRIORITY,    /* Priority of the task */
+        &bootTaskHandle,       /* Task handle, bank switches are notified to it */
+        BOOT_TASK_CORE         /* Core where the task should run */
+    );
+
+    Serial.println("Setup complete in " + String(millis()) + " ms since boot");
 }
 
 void loop() {
-    // Update LVGL timing and process UI events
-    lv_tick_inc(millis() - lastTick);
-    lastTick = millis();
-    lv_timer_handler();
-
-    // No need to process audio manually - CYD28_audio handles it in its own task
-    delay(5);
+    // Nothing to do - LVGL and CYD28_audio run in their own tasks
+    vTaskDelete(NULL);
 }
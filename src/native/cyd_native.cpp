@@ -0,0 +1,85 @@
+/*
+ * CYD Soundboard - host build of the audio engine
+ *
+ * Runs CYD_Audio, its decoders and the CYD28 audio task on Linux on top of the
+ * CYD_Native shim (pio run -e native). The SD card is a host directory, the
+ * I2S output a WAV file or nothing, paced like the DMA buffers of the target.
+ *
+ *   CYD_SD_ROOT=clips CYD_I2S_WAV=out.wav .pio/build/native/program /bell.mp3 /door.wav
+ *
+ * Environment:
+ * - CYD_SD_ROOT       directory mounted as the SD card, default the working directory
+ * - CYD_I2S_WAV       file that records the I2S output, default none
+ * - CYD_I2S_REALTIME  0 = no DMA clock, decode as fast as the host can
+ */
+
+#include <Arduino.h>
+#include <SD.h>
+#include <driver/i2s.h>
+#include "CYD28_audio.h"
+
+#define NATIVE_START_TIMEOUT_MS 2000    // a clip that is not playing by then failed to open
+#define NATIVE_DSP_STAGES 8
+
+/*
+ * Messages of CYD_Audio, on the target they go to the serial monitor as well
+ */
+void audio_info(const char *info)
+{
+    Serial.println("info: " + String(info));
+}
+
+/*
+ * Play one file to the end and report how long it took against the audio it produced
+ */
+bool playFile(const char *path)
+{
+    uint64_t framesBefore = cydNativeI2SFrames(I2S_NUM_0);
+    uint32_t start = millis();
+    if (!audioConnecttoSD(path)) {
+        Serial.println("Can't play " + String(path));
+        return false;
+    }
+    while (!audioIsPlaying() && millis() - start < NATIVE_START_TIMEOUT_MS) delay(1);
+    while (audioIsPlaying()) delay(10);
+    uint32_t elapsed = millis() - start;
+    uint64_t frames = cydNativeI2SFrames(I2S_NUM_0) - framesBefore;
+    Serial.println(String(path) + ": " + String((unsigned long)frames) + " frames in " + String(elapsed) + " ms, " +
+                   String(frames * 1000.0 / AUDIO_OUTPUT_RATE / max(elapsed, 1u), 2) + "x real time");
+    return true;
+}
+
+/*
+ * CPU time of every output pipeline stage, host cycles scaled to a 240 MHz core
+ */
+void printDspStats()
+{
+    const char *names[NATIVE_DSP_STAGES];
+    uint32_t cycles[NATIVE_DSP_STAGES];
+    uint8_t n = audioGetDspStats(names, cycles, NATIVE_DSP_STAGES);
+    for (uint8_t i = 0; i < n; i++) {
+        Serial.println("DSP " + String(names[i]) + ": " + String(cycles[i]) + " cycles");
+    }
+}
+
+#ifndef PIO_UNIT_TESTING  // pio test -e native builds this env with the tests in test/, they bring their own main()
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        Serial.println("usage: " + String(argv[0]) + " /file.mp3 [/file2.wav ...]");
+        return 1;
+    }
+    if (!SD.begin()) return 1;
+    audioInit();
+    if (!audioWaitReady(NATIVE_START_TIMEOUT_MS)) {
+        Serial.println("Audio task did not start");
+        return 1;
+    }
+    int failed = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!playFile(argv[i])) failed++;
+    }
+    printDspStats();
+    return failed ? 2 : 0;
+}
+#endif
@@ -0,0 +1,25 @@
+/*
+ * CYD Soundboard - end of a host test program (pio test -e native)
+ *
+ * test_build_src links CYD28_audio.cpp into every test, and with it the global
+ * CYD_Audio `audio`. The firmware never destroys it, exit() would: on an engine that
+ * was never started the destructor works on buffers that were never allocated and
+ * crashes, on a started one it frees them under the running audio task. The tests
+ * end with _exit() instead, after the Unity report is out.
+ */
+
+#ifndef _NATIVE_EXIT_H_
+#define _NATIVE_EXIT_H_
+
+#include <stdio.h>
+#include <unistd.h>
+
+/*
+ * Leave the test program without running the destructors of the globals
+ */
+[[noreturn]] inline void nativeTestExit(int failures) {
+    fflush(stdout);
+    _exit(failures);
+}
+
+#endif // _NATIVE_EXIT_H_
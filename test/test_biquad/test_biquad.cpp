@@ -0,0 +1,137 @@
+/*
+ * CYD Soundboard - biquad EQ stage on the host (pio test -e native)
+ *
+ * Runs steps and tones through CYD_biquad with RBJ cookbook low and high pass
+ * coefficients and checks the gain at DC and at the Nyquist frequency.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "CYD_DSP.h"
+#include "../native_exit.h"
+
+#define TEST_RATE 44100
+#define TEST_STEP 10000
+
+/*
+ * RBJ cookbook low or high pass, normalized to the naming of CYD_biquad::setStage()
+ */
+void setPass(CYD_biquad &eq, uint8_t stage, bool highPass, float f0, float q) {
+    double w0 = TWO_PI * f0 / TEST_RATE;
+    double alpha = sin(w0) / (2.0 * q);
+    double c = cos(w0);
+    double n = 1.0 + alpha;
+    double b0 = highPass ? (1.0 + c) / 2.0 : (1.0 - c) / 2.0;
+    double b1 = highPass ? -(1.0 + c) : 1.0 - c;
+    eq.setStage(stage, b0 / n, b1 / n, b0 / n, -2.0 * c / n, (1.0 - alpha) / n);
+}
+
+/*
+ * Run blocks of a constant stereo word, returns the last output word
+ */
+int32_t runConstant(CYD_biquad &eq, int16_t l, int16_t r, uint32_t samples) {
+    int32_t buf[CYD_DSP_BLOCK];
+    for (uint32_t n = 0; n < samples; n += CYD_DSP_BLOCK) {
+        for (int i = 0; i < CYD_DSP_BLOCK; i++) buf[i] = pack_16b_16b(l, r);
+        eq.process(buf, CYD_DSP_BLOCK);
+    }
+    return buf[CYD_DSP_BLOCK - 1];
+}
+
+/*
+ * Largest left sample of an alternating +-amplitude signal (Nyquist) after settling
+ */
+int16_t nyquistLevel(CYD_biquad &eq, int16_t amplitude) {
+    int32_t buf[CYD_DSP_BLOCK];
+    int16_t level = 0;
+    for (int block = 0; block < 100; block++) {
+        for (int i = 0; i < CYD_DSP_BLOCK; i++) {
+            int16_t s = i & 1 ? -amplitude : amplitude;
+            buf[i] = pack_16b_16b(s, s);
+        }
+        eq.process(buf, CYD_DSP_BLOCK);
+        if (block < 50) continue;
+        for (int i = 0; i < CYD_DSP_BLOCK; i++) level = max(level, (int16_t)abs((int16_t)(buf[i] >> 16)));
+    }
+    return level;
+}
+
+void setUp() {}
+void tearDown() {}
+
+/*
+ * With no stage set the block is not touched
+ */
+void test_bypass() {
+    CYD_biquad eq;
+    TEST_ASSERT_FALSE(eq.active());
+    int32_t buf[4] = {(int32_t)pack_16b_16b(1, -1), (int32_t)pack_16b_16b(-32768, 32767), 0, 12345};
+    int32_t ref[4];
+    memcpy(ref, buf, sizeof(buf));
+    eq.process(buf, 4);
+    TEST_ASSERT_EQUAL_INT32_ARRAY(ref, buf, 4);
+
+    setPass(eq, 0, false, 1000, 0.707f);
+    TEST_ASSERT_TRUE(eq.active());
+    eq.bypassStage(0);
+    TEST_ASSERT_FALSE(eq.active());
+}
+
+/*
+ * A low pass step response settles at the step: unity DC gain, each channel on its own
+ */
+void test_lowpass_step() {
+    CYD_biquad eq;
+    setPass(eq, 0, false, 1000, 0.707f);
+    int32_t out = runConstant(eq, TEST_STEP, 0, TEST_RATE / 10);
+    TEST_ASSERT_INT16_WITHIN(1, TEST_STEP, (int16_t)(out >> 16));
+    TEST_ASSERT_EQUAL_INT16(0, (int16_t)(out & 0xFFFF));
+    TEST_ASSERT_LESS_THAN_INT16(TEST_STEP / 100, nyquistLevel(eq, TEST_STEP));
+}
+
+/*
+ * The low cut passes Nyquist and removes DC completely: at a corner this low the
+ * error feedback has to keep the truncation bias from being amplified by the poles
+ */
+void test_highpass_step() {
+    CYD_biquad eq;
+    setPass(eq, 0, true, 20, 0.707f);
+    int32_t out = runConstant(eq, TEST_STEP, -TEST_STEP, 2 * TEST_RATE);
+    TEST_ASSERT_INT16_WITHIN(1, 0, (int16_t)(out >> 16));
+    TEST_ASSERT_INT16_WITHIN(1, 0, (int16_t)(out & 0xFFFF));
+    TEST_ASSERT_INT16_WITHIN(TEST_STEP / 100, TEST_STEP, nyquistLevel(eq, TEST_STEP));
+}
+
+/*
+ * Stages run as a cascade: low pass and high pass make a band pass with no DC and no
+ * Nyquist
+ */
+void test_cascade() {
+    CYD_biquad eq;
+    setPass(eq, 0, true, 100, 0.707f);
+    setPass(eq, 2, false, 5000, 0.707f);
+    int32_t out = runConstant(eq, TEST_STEP, TEST_STEP, TEST_RATE);
+    TEST_ASSERT_INT16_WITHIN(1, 0, (int16_t)(out >> 16));
+    TEST_ASSERT_LESS_THAN_INT16(TEST_STEP / 100, nyquistLevel(eq, TEST_STEP));
+}
+
+/*
+ * A stage with gain that overshoots full scale saturates
+ */
+void test_saturation() {
+    CYD_biquad eq;
+    eq.setStage(0, 1.0f, 0, 0, 0, 0, 4.0f);
+    int32_t out = runConstant(eq, 16000, -16000, CYD_DSP_BLOCK);
+    TEST_ASSERT_EQUAL_INT16(32767, (int16_t)(out >> 16));
+    TEST_ASSERT_EQUAL_INT16(-32768, (int16_t)(out & 0xFFFF));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bypass);
+    RUN_TEST(test_lowpass_step);
+    RUN_TEST(test_highpass_step);
+    RUN_TEST(test_cascade);
+    RUN_TEST(test_saturation);
+    nativeTestExit(UNITY_END());
+}
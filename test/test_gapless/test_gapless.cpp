@@ -0,0 +1,90 @@
+/*
+ * CYD Soundboard - gapless sequences on the host (pio test -e native)
+ *
+ * Plays decoder benchmark clips back to back through the CYD28 audio task with the
+ * simulated DMA clock running in real time. The switch to the next file (header,
+ * decoder init) happens at the end of the current one, the DMA buffers have to
+ * cover it.
+ */
+
+#include <Arduino.h>
+#include <SD.h>
+#include <driver/i2s.h>
+#include <unity.h>
+#include <sys/stat.h>
+#include "CYD28_audio.h"
+#include "../native_exit.h"
+
+#define TEST_SD_ROOT "/tmp/cyd_test_gapless"
+#define TEST_CORPUS_DIR "bench/corpus"  // decoder benchmark clips, relative to the project
+#define TEST_CLIP_MS 3000
+#define TEST_TIMEOUT_MS 5000
+#define TEST_FILL_MS 500        // well past the DMA buffer length
+
+/*
+ * Copy a benchmark clip onto the test card
+ */
+bool copyCorpusClip(const char *name)
+{
+    FILE *in = fopen((String(TEST_CORPUS_DIR "/") + name).c_str(), "rb");
+    if (!in) return false;
+    FILE *out = fopen((String(TEST_SD_ROOT "/") + name).c_str(), "wb");
+    char buf[4096];
+    size_t n;
+    while (out && (n = fread(buf, 1, sizeof(buf), in)) > 0) fwrite(buf, 1, n, out);
+    fclose(in);
+    if (!out) return false;
+    fclose(out);
+    return true;
+}
+
+/*
+ * Play the clips as one sequence, DMA statistics from the first file on
+ */
+void playSequence(const char *const *names, int count, cydNativeI2SStats_t *stats)
+{
+    for (int i = 0; i < count; i++) {
+        if (!copyCorpusClip(names[i])) TEST_IGNORE_MESSAGE("no decoder benchmark corpus");
+    }
+    uint64_t before = cydNativeI2SFrames(I2S_NUM_0);
+    TEST_ASSERT_TRUE(audioConnecttoSD((String("/") + names[0]).c_str()));
+    for (int i = 1; i < count; i++) TEST_ASSERT_TRUE(audioQueueSD(names[i]));
+
+    // The DMA buffers start empty, the transitions count once they have filled
+    uint32_t start = millis();
+    while (cydNativeI2SFrames(I2S_NUM_0) == before && millis() - start < TEST_TIMEOUT_MS) delay(1);
+    delay(TEST_FILL_MS);
+    cydNativeI2SResetStats(I2S_NUM_0);
+    while (audioIsPlaying() && millis() - start < count * (TEST_CLIP_MS + TEST_TIMEOUT_MS)) delay(5);
+    cydNativeI2SGetStats(I2S_NUM_0, stats);
+    TEST_ASSERT_UINT32_WITHIN(count * AUDIO_OUTPUT_RATE / 10, count * AUDIO_OUTPUT_RATE * TEST_CLIP_MS / 1000,
+                              (uint32_t)(cydNativeI2SFrames(I2S_NUM_0) - before));
+}
+
+void setUp() {}
+void tearDown() {}
+
+/*
+ * Transitions between codecs and to the same codec never let the DMA buffers run dry
+ */
+void test_no_underrun() {
+    const char *const names[] = {"mp3_128k_stereo_44k.mp3", "opus_96k_stereo_48k.opus", "opus_96k_stereo_48k.opus",
+                                 "vorbis_q4_stereo_44k.ogg", "aac_lc_128k_stereo_44k.aac"};
+    cydNativeI2SStats_t stats;
+    playSequence(names, sizeof(names) / sizeof(names[0]), &stats);
+    TEST_PRINTF("DMA low water %u ms", stats.lowWaterMs);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.underruns);
+}
+
+int main(int argc, char **argv) {
+    setenv("CYD_I2S_REALTIME", "1", 1);
+    setenv("CYD_NATIVE_PSRAM_KB", "4096", 0);   // Vorbis refuses to start without PSRAM
+    mkdir(TEST_SD_ROOT, 0755);
+    if (!SD.begin(TEST_SD_ROOT)) return 1;
+    audioInit();
+    if (!audioWaitReady(TEST_TIMEOUT_MS)) return 1;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_no_underrun);
+    nativeTestExit(UNITY_END());
+}
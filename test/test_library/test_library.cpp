@@ -0,0 +1,116 @@
+/*
+ * CYD Soundboard - library model on the host (pio test -e native)
+ *
+ * Builds libraries with CYD28_library, saves them to the binary cache in a host
+ * directory mounted as the SD card and loads them back.
+ */
+
+#include <Arduino.h>
+#include <SD.h>
+#include <unity.h>
+#include <sys/stat.h>
+#include "CYD28_library.h"
+#include "../native_exit.h"
+
+#define TEST_SD_ROOT "/tmp/cyd_test_library"
+#define TEST_CACHE "/test.cache"
+#define TEST_FILES 100         // more strings than the first intern table holds
+#define TEST_SLOTS 12
+
+const libraryCacheKey_t testKey = {123, 456, 789};
+
+/*
+ * Library of configured clips and unconfigured files, laid out like after a scan
+ */
+void buildLibrary() {
+    libraryClear();
+    for (int i = 0; i < TEST_FILES; i++) {
+        String name = "clip" + String(i) + ".mp3";
+        if (i % 2) {
+            libraryAddConfig(name.c_str(), ("Clip " + String(i)).c_str(), "red", i);
+            libraryMarkFound(name.c_str(), 1000 + i);
+        } else {
+            libraryAddFile(name.c_str(), 1000 + i);
+        }
+    }
+    libraryLayout(TEST_SLOTS);
+}
+
+/*
+ * Round trip through the cache file
+ */
+void saveAndLoad() {
+    uint8_t settings = 7;
+    TEST_ASSERT_TRUE(librarySaveCache(TEST_CACHE, &testKey, &settings, sizeof(settings)));
+    libraryClear();
+    settings = 0;
+    TEST_ASSERT_TRUE(libraryLoadCache(TEST_CACHE, &testKey, &settings, sizeof(settings)));
+    TEST_ASSERT_EQUAL_UINT8(7, settings);
+}
+
+void setUp() {
+    libraryClear();
+}
+
+void tearDown() {}
+
+/*
+ * Identical strings share one copy in the arena
+ */
+void test_strings_shared() {
+    buildLibrary();
+    int a = libraryFind("clip1.mp3");
+    int b = libraryFind("clip3.mp3");
+    TEST_ASSERT_TRUE(a >= 0 && b >= 0);
+    TEST_ASSERT_EQUAL_UINT32(libraryGetEntry(a)->color, libraryGetEntry(b)->color);
+    TEST_ASSERT_EQUAL_STRING("red", libraryString(libraryGetEntry(a)->color));
+    TEST_ASSERT_GREATER_THAN_UINT32(0, libraryGetStats()->stringsShared);
+}
+
+/*
+ * A cached library has the same entries and buttons as the one it was saved from
+ */
+void test_cache_round_trip() {
+    buildLibrary();
+    uint16_t buttons = libraryButtonCount();
+    saveAndLoad();
+    libraryLayout(TEST_SLOTS);
+    TEST_ASSERT_EQUAL_UINT16(buttons, libraryButtonCount());
+    int index = libraryFind("clip41.mp3");
+    TEST_ASSERT_TRUE(index >= 0);
+    TEST_ASSERT_EQUAL_STRING("Clip 41", libraryString(libraryGetEntry(index)->label));
+    TEST_ASSERT_EQUAL_UINT32(1041, libraryGetEntry(index)->size);
+}
+
+/*
+ * Strings added after a cache load (card watch, config reload) rebuild the intern table
+ * from the arena, it must be sized for every string in there
+ */
+void test_intern_after_cache_load() {
+    buildLibrary();
+    saveAndLoad();
+    libraryMarkClear();
+    TEST_ASSERT_TRUE(libraryAddFile("new.mp3", 1) >= 0);
+    bool changed = false;
+    TEST_ASSERT_TRUE(libraryUpdateConfig("clip5.mp3", "Renamed", "blue", 5, &changed) >= 0);
+    TEST_ASSERT_TRUE(changed);
+    libraryLayout(TEST_SLOTS);
+
+    TEST_ASSERT_TRUE(libraryFind("new.mp3") >= 0);
+    TEST_ASSERT_EQUAL_STRING("Renamed", libraryString(libraryGetEntry(libraryFind("clip5.mp3"))->label));
+    // Strings of the cache are found again: same handles, the entry is unchanged
+    libraryMarkClear();
+    libraryUpdateConfig("clip7.mp3", "Clip 7", "red", 7, &changed);
+    TEST_ASSERT_FALSE(changed);
+}
+
+int main(int argc, char **argv) {
+    mkdir(TEST_SD_ROOT, 0755);
+    if (!SD.begin(TEST_SD_ROOT)) return 1;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_strings_shared);
+    RUN_TEST(test_cache_round_trip);
+    RUN_TEST(test_intern_after_cache_load);
+    nativeTestExit(UNITY_END());
+}
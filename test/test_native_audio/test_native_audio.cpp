@@ -0,0 +1,180 @@
+/*
+ * CYD Soundboard - audio engine on the host (pio test -e native)
+ *
+ * Plays generated WAV clips through the CYD28 audio task and the CYD_Native I2S
+ * sink and checks how much audio comes out. The DMA clock is off, clips decode as
+ * fast as the host can.
+ */
+
+#include <Arduino.h>
+#include <SD.h>
+#include <driver/i2s.h>
+#include <unity.h>
+#include <sys/stat.h>
+#include "CYD28_audio.h"
+#include "../native_exit.h"
+
+#define TEST_SD_ROOT "/tmp/cyd_test_native_audio"
+#define TEST_TIMEOUT_MS 5000
+#define TEST_CLIP_MS 500
+#define TEST_TAIL_FRAMES 1024   // the internal DAC bias fades out after the last sample, about 12 ms
+#define TEST_CORPUS_DIR "bench/corpus"  // decoder benchmark clips, relative to the project
+#define TEST_CORPUS_CLIP_MS 3000
+#define TEST_SEQUENCE_CLIPS 10
+#define TEST_HEAP_SLACK 1024    // host heap noise between two runs, a leak costs about that per transition
+
+/*
+ * Write a 16 bit PCM WAV holding a 1 kHz tone at half scale
+ */
+bool writeToneWav(const char *name, uint32_t rate, uint8_t channels, uint32_t frames)
+{
+    FILE *f = fopen((String(TEST_SD_ROOT "/") + name).c_str(), "wb");
+    if (!f) return false;
+    uint32_t dataBytes = frames * channels * 2;
+    uint32_t header[11];
+    memcpy(&header[0], "RIFF", 4);
+    header[1] = 36 + dataBytes;
+    memcpy(&header[2], "WAVEfmt ", 8);
+    header[4] = 16;
+    header[5] = 1 | (channels << 16);
+    header[6] = rate;
+    header[7] = rate * channels * 2;
+    header[8] = (channels * 2) | (16 << 16);
+    memcpy(&header[9], "data", 4);
+    header[10] = dataBytes;
+    fwrite(header, 1, sizeof(header), f);
+    for (uint32_t i = 0; i < frames; i++) {
+        int16_t sample = lrintf(16384.0f * sinf(TWO_PI * 1000.0f * i / rate));
+        for (uint8_t c = 0; c < channels; c++) fwrite(&sample, 2, 1, f);
+    }
+    fclose(f);
+    return true;
+}
+
+/*
+ * Play a clip to the end, output frames written to I2S meanwhile
+ */
+uint64_t playToEnd(const char *path)
+{
+    uint64_t before = cydNativeI2SFrames(I2S_NUM_0);
+    if (!audioConnecttoSD(path)) return 0;
+    uint32_t start = millis();
+    while (!audioIsPlaying() && millis() - start < TEST_TIMEOUT_MS) delay(1);
+    while (audioIsPlaying() && millis() - start < TEST_TIMEOUT_MS) delay(5);
+    return cydNativeI2SFrames(I2S_NUM_0) - before;
+}
+
+/*
+ * Copy a benchmark clip onto the test card
+ */
+bool copyCorpusClip(const char *name)
+{
+    FILE *in = fopen((String(TEST_CORPUS_DIR "/") + name).c_str(), "rb");
+    if (!in) return false;
+    FILE *out = fopen((String(TEST_SD_ROOT "/") + name).c_str(), "wb");
+    char buf[4096];
+    size_t n;
+    while (out && (n = fread(buf, 1, sizeof(buf), in)) > 0) fwrite(buf, 1, n, out);
+    fclose(in);
+    if (!out) return false;
+    fclose(out);
+    return true;
+}
+
+/*
+ * Play a clip count times in a row as one gapless sequence, output frames written
+ */
+uint64_t playSequence(const char *path, int count)
+{
+    uint64_t before = cydNativeI2SFrames(I2S_NUM_0);
+    if (!audioConnecttoSD(path)) return 0;
+    for (int i = 1; i < count; i++) audioQueueSD(path);
+    uint32_t start = millis();
+    while (!audioIsPlaying() && millis() - start < TEST_TIMEOUT_MS) delay(1);
+    while (audioIsPlaying() && millis() - start < count * TEST_TIMEOUT_MS) delay(5);
+    return cydNativeI2SFrames(I2S_NUM_0) - before;
+}
+
+void setUp() {}
+void tearDown() {}
+
+/*
+ * Output frames of a clip: its length at the output rate, a partial last block may
+ * be dropped, the bias fade-out follows
+ */
+void assertPlayed(uint32_t expected, uint64_t played) {
+    TEST_ASSERT_GREATER_OR_EQUAL_UINT32(expected - CYDAUDIO_DAC_BUF_SIZE, (uint32_t)played);
+    TEST_ASSERT_LESS_OR_EQUAL_UINT32(expected + TEST_TAIL_FRAMES, (uint32_t)played);
+}
+
+/*
+ * A clip at the output rate comes out at its length
+ */
+void test_clip_at_output_rate() {
+    uint32_t frames = AUDIO_OUTPUT_RATE * TEST_CLIP_MS / 1000;
+    TEST_ASSERT_TRUE(writeToneWav("stereo44.wav", AUDIO_OUTPUT_RATE, 2, frames));
+    assertPlayed(frames, playToEnd("/stereo44.wav"));
+}
+
+/*
+ * A mono clip at half the output rate is resampled to the same duration
+ */
+void test_clip_resampled() {
+    uint32_t frames = 22050 * TEST_CLIP_MS / 1000;
+    uint32_t expected = AUDIO_OUTPUT_RATE * TEST_CLIP_MS / 1000;
+    TEST_ASSERT_TRUE(writeToneWav("mono22.wav", 22050, 1, frames));
+    assertPlayed(expected, playToEnd("/mono22.wav"));
+}
+
+/*
+ * A file that is not on the card fails to open and plays nothing
+ */
+void test_missing_clip() {
+    TEST_ASSERT_FALSE(audioConnecttoSD("/missing.wav"));
+    TEST_ASSERT_FALSE(audioIsPlaying());
+}
+
+/*
+ * A gapless transition to the same codec leaves no decoder buffers behind: the
+ * sequence plays in full and a second run of it ends with about the heap of the first
+ */
+void assertSequenceHeap(const char *name) {
+    if (!copyCorpusClip(name)) TEST_IGNORE_MESSAGE("no decoder benchmark corpus");
+    String path = String("/") + name;
+    // encoder delay and padding add a few frames per clip
+    uint32_t expected = TEST_SEQUENCE_CLIPS * AUDIO_OUTPUT_RATE * TEST_CORPUS_CLIP_MS / 1000;
+    TEST_ASSERT_UINT32_WITHIN(expected / 20, expected, (uint32_t)playSequence(path.c_str(), TEST_SEQUENCE_CLIPS));
+    uint32_t heap = ESP.getFreeHeap();
+    playSequence(path.c_str(), TEST_SEQUENCE_CLIPS);
+    TEST_ASSERT_UINT32_WITHIN(TEST_HEAP_SLACK, heap, ESP.getFreeHeap());
+}
+
+void test_sequence_heap_mp3() {
+    assertSequenceHeap("mp3_48k_mono_22k.mp3");
+}
+
+void test_sequence_heap_opus() {
+    assertSequenceHeap("opus_32k_mono_48k.opus");
+}
+
+void test_sequence_heap_vorbis() {
+    assertSequenceHeap("vorbis_q4_stereo_44k.ogg");
+}
+
+int main(int argc, char **argv) {
+    setenv("CYD_I2S_REALTIME", "0", 1);
+    setenv("CYD_NATIVE_PSRAM_KB", "4096", 0);   // Vorbis refuses to start without PSRAM
+    mkdir(TEST_SD_ROOT, 0755);
+    if (!SD.begin(TEST_SD_ROOT)) return 1;
+    audioInit();
+    if (!audioWaitReady(TEST_TIMEOUT_MS)) return 1;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_clip_at_output_rate);
+    RUN_TEST(test_clip_resampled);
+    RUN_TEST(test_missing_clip);
+    RUN_TEST(test_sequence_heap_mp3);
+    RUN_TEST(test_sequence_heap_opus);
+    RUN_TEST(test_sequence_heap_vorbis);
+    nativeTestExit(UNITY_END());
+}
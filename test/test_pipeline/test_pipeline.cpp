@@ -0,0 +1,209 @@
+/*
+ * CYD Soundboard - DSP pipeline on the host (pio test -e native)
+ *
+ * Builds CYD_pipeline chains from test stages and the stock gain, limiter and
+ * mixer stages and checks stage order, bypass and the limiter ceiling.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "CYD_DSP.h"
+#include "../native_exit.h"
+
+#define TEST_RATE 44100
+
+/*
+ * Stage doing one arithmetic step on the left channel, the order of two of them shows
+ */
+class TestStage : public CYD_dspStage
+{
+public:
+    TestStage(int16_t mul, int16_t add) : mul(mul), add(add) {}
+    const char *name() { return "test"; }
+    void process(int32_t *buf, uint16_t sz) {
+        for (uint16_t i = 0; i < sz; i++) buf[i] = pack_16b_16b((int16_t)(buf[i] >> 16) * mul + add, buf[i]);
+    }
+    void reset() { resets++; }
+    void setSampleRate(uint32_t rate) { this->rate = rate; }
+    int resets = 0;
+    uint32_t rate = 0;
+private:
+    int16_t mul, add;
+};
+
+/*
+ * Mixer source adding a constant to both channels
+ */
+class TestSource : public CYD_mixSource
+{
+public:
+    TestSource(int16_t level) : level(level) {}
+    void mix(int32_t *buf, uint16_t sz) {
+        for (uint16_t i = 0; i < sz; i++) buf[i] = mix_16b_16b(buf[i], level, level);
+    }
+private:
+    int16_t level;
+};
+
+/*
+ * Left channel of a one word block of left sample l through the pipeline
+ */
+int16_t runOne(CYD_pipeline &pipeline, int16_t l) {
+    int32_t word = pack_16b_16b(l, 0);
+    pipeline.process(&word, 1);
+    return word >> 16;
+}
+
+/*
+ * Largest sample of either channel in a block
+ */
+int32_t blockPeak(const int32_t *buf, uint16_t sz) {
+    int32_t peak = 0;
+    for (uint16_t i = 0; i < sz; i++) {
+        peak = max(peak, (int32_t)abs((int16_t)(buf[i] >> 16)));
+        peak = max(peak, (int32_t)abs((int16_t)(buf[i] & 0xFFFF)));
+    }
+    return peak;
+}
+
+void setUp() {}
+void tearDown() {}
+
+/*
+ * Stages run in chain order, insert() places them and remove() takes them out
+ */
+void test_order() {
+    CYD_pipeline pipeline;
+    TestStage twice(2, 0), plusOne(1, 1);
+    TEST_ASSERT_TRUE(pipeline.insert(&twice));
+    TEST_ASSERT_TRUE(pipeline.insert(&plusOne));
+    TEST_ASSERT_EQUAL_INT16(21, runOne(pipeline, 10));       // (10 * 2) + 1
+
+    TEST_ASSERT_TRUE(pipeline.remove(&plusOne));
+    TEST_ASSERT_TRUE(pipeline.insert(&plusOne, 0));
+    TEST_ASSERT_EQUAL_PTR(&plusOne, pipeline.stage(0));
+    TEST_ASSERT_EQUAL_INT16(22, runOne(pipeline, 10));       // (10 + 1) * 2
+
+    TEST_ASSERT_FALSE(pipeline.insert(&twice));              // already in the chain
+    TEST_ASSERT_EQUAL_UINT8(2, pipeline.count());
+    TEST_ASSERT_TRUE(pipeline.remove(&twice));
+    TEST_ASSERT_FALSE(pipeline.remove(&twice));
+    TEST_ASSERT_NULL(pipeline.stage(1));
+}
+
+/*
+ * The chain holds CYD_DSP_STAGES stages
+ */
+void test_full() {
+    CYD_pipeline pipeline;
+    TestStage stages[CYD_DSP_STAGES + 1] = {
+        {1, 1}, {1, 1}, {1, 1}, {1, 1}, {1, 1}, {1, 1}, {1, 1}, {1, 1}, {1, 1}};
+    for (int i = 0; i < CYD_DSP_STAGES; i++) {
+        TEST_ASSERT_TRUE(pipeline.insert(&stages[i]));
+    }
+    TEST_ASSERT_FALSE(pipeline.insert(&stages[CYD_DSP_STAGES]));
+    TEST_ASSERT_EQUAL_INT16(CYD_DSP_STAGES, runOne(pipeline, 0));
+}
+
+/*
+ * A disabled stage is skipped, reset and the rate still reach it
+ */
+void test_disabled() {
+    CYD_pipeline pipeline;
+    TestStage twice(2, 0), plusOne(1, 1);
+    pipeline.insert(&twice);
+    pipeline.insert(&plusOne);
+    twice.enabled = false;
+    TEST_ASSERT_EQUAL_INT16(11, runOne(pipeline, 10));
+    TEST_ASSERT_EQUAL_UINT32(0, twice.cycles);
+    pipeline.reset();
+    pipeline.setSampleRate(48000);
+    TEST_ASSERT_EQUAL_INT(1, twice.resets);
+    TEST_ASSERT_EQUAL_UINT32(48000, twice.rate);
+    TEST_ASSERT_EQUAL_UINT32(48000, plusOne.rate);
+}
+
+/*
+ * A full scale block comes out at the limiter threshold at most, with no overshoot at
+ * its start, and the gain returns to unity once the level drops
+ */
+void test_limiter() {
+    CYD_pipeline pipeline;
+    CYD_limiter limiter;
+    limiter.setSampleRate(TEST_RATE);
+    pipeline.insert(&limiter);
+
+    int32_t buf[CYD_DSP_BLOCK];
+    for (int i = 0; i < CYD_DSP_BLOCK; i++) buf[i] = pack_16b_16b(i & 1 ? 32767 : 1000, -32768);
+    pipeline.process(buf, CYD_DSP_BLOCK);
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(CYD_LIMITER_THRESHOLD, blockPeak(buf, CYD_DSP_BLOCK));
+    TEST_ASSERT_GREATER_THAN_INT32(CYD_LIMITER_THRESHOLD - 100, blockPeak(buf, CYD_DSP_BLOCK));
+    TEST_ASSERT_LESS_THAN_UINT32(0x10000, limiter.getGain());
+
+    // Quiet blocks for ten release constants
+    for (uint32_t n = 0; n < TEST_RATE * CYD_LIMITER_RELEASE_MS / 100; n += CYD_DSP_BLOCK) {
+        for (int i = 0; i < CYD_DSP_BLOCK; i++) buf[i] = pack_16b_16b(10000, -10000);
+        pipeline.process(buf, CYD_DSP_BLOCK);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0x10000, limiter.getGain());
+    TEST_ASSERT_EQUAL_INT32((int32_t)pack_16b_16b(10000, -10000), buf[CYD_DSP_BLOCK - 1]);
+}
+
+/*
+ * A gain change ramps over one block, the next block has the new gain throughout
+ */
+void test_gain_ramp() {
+    CYD_pipeline pipeline;
+    CYD_gain gain;
+    pipeline.insert(&gain);
+    gain.setGain(0.5f);
+
+    int32_t buf[CYD_DSP_BLOCK];
+    for (int i = 0; i < CYD_DSP_BLOCK; i++) buf[i] = pack_16b_16b(16000, -16000);
+    pipeline.process(buf, CYD_DSP_BLOCK);
+    TEST_ASSERT_INT16_WITHIN(200, 16000, (int16_t)(buf[0] >> 16));
+    TEST_ASSERT_INT16_WITHIN(2, 8000, (int16_t)(buf[CYD_DSP_BLOCK - 1] >> 16));
+    TEST_ASSERT_INT16_WITHIN(2, -8000, (int16_t)(buf[CYD_DSP_BLOCK - 1] & 0xFFFF));
+
+    for (int i = 0; i < CYD_DSP_BLOCK; i++) buf[i] = pack_16b_16b(16000, -16000);
+    pipeline.process(buf, CYD_DSP_BLOCK);
+    TEST_ASSERT_INT16_WITHIN(2, 8000, (int16_t)(buf[0] >> 16));
+}
+
+/*
+ * The mixer adds its sources into the block, a limiter behind it catches the sum
+ */
+void test_mixer_limiter() {
+    CYD_pipeline pipeline;
+    CYD_mixer mixer;
+    CYD_limiter limiter;
+    TestSource a(12000), b(12000);
+    pipeline.insert(&mixer);
+    pipeline.insert(&limiter);
+    TEST_ASSERT_TRUE(mixer.addSource(&a));
+    TEST_ASSERT_TRUE(mixer.addSource(&b));
+
+    int32_t buf[CYD_DSP_BLOCK];
+    for (int i = 0; i < CYD_DSP_BLOCK; i++) buf[i] = pack_16b_16b(12000, 0);
+    pipeline.process(buf, CYD_DSP_BLOCK);
+    TEST_ASSERT_LESS_OR_EQUAL_INT32(CYD_LIMITER_THRESHOLD, (int16_t)(buf[0] >> 16));
+    TEST_ASSERT_INT16_WITHIN(2, 24000 * CYD_LIMITER_THRESHOLD / 32767, (int16_t)(buf[0] & 0xFFFF));
+
+    TEST_ASSERT_TRUE(mixer.removeSource(&b));
+    TEST_ASSERT_FALSE(mixer.removeSource(&b));
+    limiter.reset();
+    for (int i = 0; i < CYD_DSP_BLOCK; i++) buf[i] = 0;
+    pipeline.process(buf, CYD_DSP_BLOCK);
+    TEST_ASSERT_EQUAL_INT32((int32_t)pack_16b_16b(12000, 12000), buf[0]);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_order);
+    RUN_TEST(test_full);
+    RUN_TEST(test_disabled);
+    RUN_TEST(test_limiter);
+    RUN_TEST(test_gain_ramp);
+    RUN_TEST(test_mixer_limiter);
+    nativeTestExit(UNITY_END());
+}
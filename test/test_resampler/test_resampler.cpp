@@ -0,0 +1,148 @@
+/*
+ * CYD Soundboard - sample rate converter on the host (pio test -e native)
+ *
+ * Streams DC and tones through CYD_resampler like the audio task does (fill the
+ * FIFO, read a block) and checks the gain and the output length.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include <vector>
+#include "CYD_DSP.h"
+#include "../native_exit.h"
+
+#define TEST_OUT_RATE 44100
+
+/*
+ * Convert inFrames of a tone (hz = 0: DC) at the given level, output words are appended
+ */
+void stream(CYD_resampler &rs, uint32_t inRate, float hz, int16_t level, uint32_t inFrames, std::vector<int32_t> &out) {
+    int32_t block[CYD_DSP_BLOCK];
+    uint32_t written = 0;
+    while (true) {
+        uint16_t space;
+        int32_t *in = rs.writeBuffer(&space);
+        space = min((uint32_t)space, inFrames - written);
+        for (uint16_t i = 0; i < space; i++, written++) {
+            int16_t s = hz ? lrintf(level * sinf(TWO_PI * hz * written / inRate)) : level;
+            in[i] = pack_16b_16b(s, -s);
+        }
+        rs.commit(space);
+        uint16_t n = rs.read(block, CYD_DSP_BLOCK);
+        out.insert(out.end(), block, block + n);
+        if (!n && written == inFrames) break;
+    }
+}
+
+/*
+ * RMS of the left channel from the given word on
+ */
+float rmsLeft(const std::vector<int32_t> &out, size_t from) {
+    double sum = 0;
+    for (size_t i = from; i < out.size(); i++) {
+        double s = (int16_t)(out[i] >> 16);
+        sum += s * s;
+    }
+    return sqrt(sum / (out.size() - from));
+}
+
+/*
+ * DC comes out at its level once the FIR has filled, on both channels
+ */
+void assertDcGain(uint32_t inRate, bool polyphase) {
+    CYD_resampler rs;
+    rs.setRates(inRate, TEST_OUT_RATE, polyphase);
+    TEST_ASSERT_TRUE(rs.active());
+    std::vector<int32_t> out;
+    stream(rs, inRate, 0, 10000, inRate / 10, out);
+    for (size_t i = CYD_RESAMPLER_TAPS * 4; i < out.size(); i++) {
+        TEST_ASSERT_INT16_WITHIN(3, 10000, (int16_t)(out[i] >> 16));
+        TEST_ASSERT_INT16_WITHIN(3, -10000, (int16_t)(out[i] & 0xFFFF));
+    }
+}
+
+/*
+ * The output lasts as long as the input: frames scaled by the rate ratio, the FIR
+ * keeps back the last few input samples
+ */
+void assertLength(uint32_t inRate, bool polyphase) {
+    CYD_resampler rs;
+    rs.setRates(inRate, TEST_OUT_RATE, polyphase);
+    std::vector<int32_t> out;
+    stream(rs, inRate, 1000, 16000, inRate, out);
+    TEST_ASSERT_INT32_WITHIN(CYD_RESAMPLER_TAPS * 4, TEST_OUT_RATE, (int32_t)out.size());
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_dc_upsample() {
+    assertDcGain(22050, true);
+    assertDcGain(22050, false);
+}
+
+void test_dc_downsample() {
+    assertDcGain(48000, true);
+    assertDcGain(48000, false);
+}
+
+void test_length() {
+    assertLength(22050, true);
+    assertLength(16000, true);
+    assertLength(48000, true);
+    assertLength(22050, false);
+}
+
+/*
+ * Equal rates need no conversion, the audio task bypasses the resampler
+ */
+void test_bypass() {
+    CYD_resampler rs;
+    rs.setRates(TEST_OUT_RATE, TEST_OUT_RATE);
+    TEST_ASSERT_FALSE(rs.active());
+}
+
+/*
+ * A tone in the pass band keeps its level
+ */
+void test_passband() {
+    CYD_resampler rs;
+    rs.setRates(22050, TEST_OUT_RATE);
+    std::vector<int32_t> out;
+    stream(rs, 22050, 1000, 16000, 22050, out);
+    TEST_ASSERT_FLOAT_WITHIN(16000 * 0.01f, 16000 / sqrtf(2), rmsLeft(out, 1000));
+}
+
+/*
+ * Level of a tone converted from 96 kHz
+ */
+float aliasLevel(float hz, bool polyphase) {
+    CYD_resampler rs;
+    rs.setRates(96000, TEST_OUT_RATE, polyphase);
+    std::vector<int32_t> out;
+    stream(rs, 96000, hz, 16000, 96000, out);
+    return rmsLeft(out, 1000);
+}
+
+/*
+ * Downsampling attenuates a tone above the output Nyquist frequency instead of folding
+ * it back into the audio band. Eight taps give a wide transition band: near the band
+ * edge the FIR beats linear interpolation, further out it removes the tone.
+ */
+void test_antialias() {
+    float full = 16000 / sqrtf(2);
+    TEST_ASSERT_LESS_THAN_INT(lrintf(aliasLevel(30000, false) / 3), lrintf(aliasLevel(30000, true)));
+    TEST_ASSERT_LESS_THAN_INT(lrintf(full / 4), lrintf(aliasLevel(30000, true)));
+    TEST_ASSERT_LESS_THAN_INT(lrintf(full / 10), lrintf(aliasLevel(40000, true)));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_dc_upsample);
+    RUN_TEST(test_dc_downsample);
+    RUN_TEST(test_length);
+    RUN_TEST(test_bypass);
+    RUN_TEST(test_passband);
+    RUN_TEST(test_antialias);
+    nativeTestExit(UNITY_END());
+}
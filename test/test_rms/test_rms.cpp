@@ -0,0 +1,181 @@
+/*
+ * CYD Soundboard - output level detector on the host (pio test -e native)
+ *
+ * Feeds sine, noise and silence blocks through CYD_rms and checks the RMS,
+ * the peak and the peak hold against their expected values.
+ */
+
+#include <Arduino.h>
+#include <unity.h>
+#include "CYD_DSP.h"
+#include "../native_exit.h"
+
+#define TEST_RATE 44100
+#define TEST_BLOCK 64
+#define TEST_SINE_HZ 441            // 100 samples per period, one of them on the crest
+#define TEST_FULL_SCALE 32767
+
+uint32_t phase = 0;                 // sample position of the sine
+uint32_t noiseSeed = 1;
+
+/*
+ * Stereo block of a sine, the same level on both channels
+ */
+void sineBlock(int32_t *buf, int16_t amplitude) {
+    for (int i = 0; i < TEST_BLOCK; i++, phase++) {
+        int16_t s = lrintf(amplitude * sinf(TWO_PI * TEST_SINE_HZ * phase / TEST_RATE));
+        buf[i] = pack_16b_16b(s, s);
+    }
+}
+
+/*
+ * Stereo block of uniform white noise in -amplitude..amplitude
+ */
+void noiseBlock(int32_t *buf, int16_t amplitude) {
+    for (int i = 0; i < TEST_BLOCK; i++) {
+        noiseSeed = noiseSeed * 1664525u + 1013904223u;
+        int16_t l = (int32_t)((noiseSeed >> 16) % (2 * amplitude + 1)) - amplitude;
+        noiseSeed = noiseSeed * 1664525u + 1013904223u;
+        int16_t r = (int32_t)((noiseSeed >> 16) % (2 * amplitude + 1)) - amplitude;
+        buf[i] = pack_16b_16b(l, r);
+    }
+}
+
+/*
+ * Run ms of sine (amplitude > 0), noise (amplitude < 0) or silence through the meter
+ */
+void feed(CYD_rms &rms, int16_t amplitude, uint32_t ms) {
+    int32_t buf[TEST_BLOCK];
+    for (uint32_t n = 0; n < TEST_RATE * ms / 1000; n += TEST_BLOCK) {
+        if (amplitude > 0) {
+            sineBlock(buf, amplitude);
+        } else if (amplitude < 0) {
+            noiseBlock(buf, -amplitude);
+        } else {
+            memset(buf, 0, sizeof(buf));
+        }
+        rms.process(buf, TEST_BLOCK);
+    }
+}
+
+uint32_t rmsLeft(CYD_rms &rms) {
+    uint32_t r, l;
+    rms.getLast(&r, &l);
+    return l;
+}
+
+uint32_t peakLeft(CYD_rms &rms) {
+    uint32_t r, l;
+    rms.getPeak(&r, &l);
+    return l;
+}
+
+void setUp() {
+    phase = 0;
+    noiseSeed = 1;
+}
+
+void tearDown() {}
+
+/*
+ * A full scale sine settles at amplitude / sqrt(2) on both channels, the peak is the crest
+ */
+void test_sine() {
+    CYD_rms rms(TEST_BLOCK);
+    feed(rms, TEST_FULL_SCALE, 500);
+    uint32_t r, l;
+    rms.getLast(&r, &l);
+    TEST_ASSERT_UINT32_WITHIN(TEST_FULL_SCALE / 100, 23170, l);
+    TEST_ASSERT_UINT32_WITHIN(TEST_FULL_SCALE / 100, 23170, r);
+    rms.getPeak(&r, &l);
+    TEST_ASSERT_EQUAL_UINT32(TEST_FULL_SCALE, l);
+    TEST_ASSERT_EQUAL_UINT32(TEST_FULL_SCALE, r);
+    TEST_ASSERT_EQUAL_UINT32(255, rms.getLevels8() >> 24);
+}
+
+/*
+ * The RMS rises with the attack constant: about 63 % of the mean square after one
+ */
+void test_attack() {
+    CYD_rms rms(TEST_BLOCK);
+    feed(rms, TEST_FULL_SCALE, CYD_RMS_ATTACK_MS);
+    uint32_t level = rmsLeft(rms);
+    TEST_ASSERT_UINT32_WITHIN(1500, lrintf(23170 * sqrtf(0.632f)), level);
+    // The peak needs no time
+    TEST_ASSERT_EQUAL_UINT32(TEST_FULL_SCALE, peakLeft(rms));
+}
+
+/*
+ * Uniform noise has an RMS of amplitude / sqrt(3)
+ */
+void test_noise() {
+    CYD_rms rms(TEST_BLOCK);
+    feed(rms, -16384, 1000);
+    uint32_t r, l;
+    rms.getLast(&r, &l);
+    TEST_ASSERT_UINT32_WITHIN(16384 / 20, 9459, l);
+    TEST_ASSERT_UINT32_WITHIN(16384 / 20, 9459, r);
+    rms.getPeak(&r, &l);
+    TEST_ASSERT_UINT32_WITHIN(200, 16384, l);
+    TEST_ASSERT_UINT32_WITHIN(200, 16384, r);
+}
+
+/*
+ * Silence reads zero, with no level before it
+ */
+void test_silence() {
+    CYD_rms rms(TEST_BLOCK);
+    feed(rms, 0, 500);
+    uint32_t r, l;
+    rms.getLast(&r, &l);
+    TEST_ASSERT_EQUAL_UINT32(0, l);
+    TEST_ASSERT_EQUAL_UINT32(0, r);
+    rms.getPeak(&r, &l);
+    TEST_ASSERT_EQUAL_UINT32(0, l);
+    TEST_ASSERT_EQUAL_UINT32(0, r);
+    TEST_ASSERT_EQUAL_UINT32(0, rms.getLevels8());
+}
+
+/*
+ * After the sine stops the RMS falls with the release constant (the mean square does,
+ * its root at half the rate), the peak holds for the hold time and then falls the same way
+ */
+void test_peak_hold() {
+    CYD_rms rms(TEST_BLOCK);
+    feed(rms, TEST_FULL_SCALE, 100);
+    feed(rms, 0, CYD_RMS_HOLD_MS - 50);
+    TEST_ASSERT_EQUAL_UINT32(TEST_FULL_SCALE, peakLeft(rms));
+    TEST_ASSERT_UINT32_WITHIN(500, lrintf(23170 * expf(-(CYD_RMS_HOLD_MS - 50) / (2.0f * CYD_RMS_RELEASE_MS))),
+                              rmsLeft(rms));
+    feed(rms, 0, 50 + CYD_RMS_RELEASE_MS);
+    // One release constant: the Q16 peak is at about 37 %
+    TEST_ASSERT_UINT32_WITHIN(2000, lrintf(TEST_FULL_SCALE * 0.368f), peakLeft(rms));
+    feed(rms, 0, 10 * CYD_RMS_RELEASE_MS);
+    TEST_ASSERT_LESS_THAN_UINT32(10, peakLeft(rms));
+}
+
+/*
+ * A new peak during the hold restarts it
+ */
+void test_hold_restart() {
+    CYD_rms rms(TEST_BLOCK);
+    rms.setBallistics(CYD_RMS_ATTACK_MS, CYD_RMS_RELEASE_MS, 200);
+    feed(rms, 16384, 50);
+    feed(rms, 0, 150);
+    feed(rms, TEST_FULL_SCALE, 20);
+    feed(rms, 0, 150);
+    TEST_ASSERT_EQUAL_UINT32(TEST_FULL_SCALE, peakLeft(rms));
+    feed(rms, 0, 100);
+    TEST_ASSERT_LESS_THAN_UINT32(TEST_FULL_SCALE, peakLeft(rms));
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sine);
+    RUN_TEST(test_attack);
+    RUN_TEST(test_noise);
+    RUN_TEST(test_silence);
+    RUN_TEST(test_peak_hold);
+    RUN_TEST(test_hold_restart);
+    nativeTestExit(UNITY_END());
+}
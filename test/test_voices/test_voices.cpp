@@ -0,0 +1,191 @@
+/*
+ * CYD Soundboard - sound effect voices on the host (pio test -e native)
+ *
+ * Mixes CYD_voices into blocks and checks the rate, voice stealing and
+ * saturation, then loads WAV files through the CYD28_voice sample cache.
+ */
+
+#include <Arduino.h>
+#include <SD.h>
+#include <unity.h>
+#include <sys/stat.h>
+#include "CYD_DSP.h"
+#include "CYD28_voice.h"
+#include "../native_exit.h"
+
+#define TEST_SD_ROOT "/tmp/cyd_test_voices"
+#define TEST_FRAMES 101
+
+int16_t ramp[TEST_FRAMES];                // 0, 100, 200, ... mono
+int16_t loud[TEST_FRAMES * 2];            // full scale stereo
+
+/*
+ * Output samples until the voices stop, the last block is mixed into buf
+ */
+uint32_t mixToEnd(CYD_voices &voices, int32_t *buf) {
+    uint32_t samples = 0;
+    while (voices.active() && samples < 100000) {
+        memset(buf, 0, CYD_DSP_BLOCK * sizeof(int32_t));
+        voices.mix(buf, CYD_DSP_BLOCK);
+        samples += CYD_DSP_BLOCK;
+    }
+    return samples;
+}
+
+/*
+ * Write a PCM WAV file, 8 or 16 bit
+ */
+bool writeWav(const char *name, uint8_t channels, uint8_t bits, uint32_t frames) {
+    FILE *f = fopen((String(TEST_SD_ROOT "/") + name).c_str(), "wb");
+    if (!f) return false;
+    uint32_t dataBytes = frames * channels * bits / 8;
+    uint32_t header[11];
+    memcpy(&header[0], "RIFF", 4);
+    header[1] = 36 + dataBytes;
+    memcpy(&header[2], "WAVEfmt ", 8);
+    header[4] = 16;
+    header[5] = 1 | (channels << 16);
+    header[6] = 22050;
+    header[7] = 22050 * channels * bits / 8;
+    header[8] = (channels * bits / 8) | (bits << 16);
+    memcpy(&header[9], "data", 4);
+    header[10] = dataBytes;
+    fwrite(header, 1, sizeof(header), f);
+    for (uint32_t i = 0; i < frames * channels; i++) {
+        if (bits == 8) {
+            uint8_t sample = 128 + (i & 63);
+            fwrite(&sample, 1, 1, f);
+        } else {
+            int16_t sample = i * 10;
+            fwrite(&sample, 2, 1, f);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+void setUp() {}
+void tearDown() {}
+
+/*
+ * At unity speed a voice plays its frames once, the interpolation stops one frame early
+ */
+void test_unity_rate() {
+    CYD_voices voices;
+    int32_t buf[CYD_DSP_BLOCK] = {};
+    TEST_ASSERT_EQUAL_INT8(0, voices.play(ramp, TEST_FRAMES, 1, 0x10000, 0x8000));
+    voices.mix(buf, CYD_DSP_BLOCK);
+    // Left in the upper half, right in the lower, gain 0x8000 is unity (Q15)
+    TEST_ASSERT_EQUAL_INT16(ramp[10], (int16_t)(buf[10] >> 16));
+    TEST_ASSERT_EQUAL_INT16(ramp[10], (int16_t)(buf[10] & 0xFFFF));
+    TEST_ASSERT_TRUE(voices.active());
+    memset(buf, 0, sizeof(buf));
+    voices.mix(buf, CYD_DSP_BLOCK);
+    TEST_ASSERT_FALSE(voices.active());
+    // Frames 64..99 in the second block, silence after
+    TEST_ASSERT_EQUAL_INT16(ramp[99], (int16_t)(buf[TEST_FRAMES - 2 - CYD_DSP_BLOCK] >> 16));
+    TEST_ASSERT_EQUAL_INT32(0, buf[TEST_FRAMES - 1 - CYD_DSP_BLOCK]);
+}
+
+/*
+ * Half speed doubles the length and interpolates between the frames
+ */
+void test_half_rate() {
+    CYD_voices voices;
+    int32_t buf[CYD_DSP_BLOCK] = {};
+    voices.play(ramp, TEST_FRAMES, 1, 0x8000, 0x8000);
+    voices.mix(buf, CYD_DSP_BLOCK);
+    TEST_ASSERT_EQUAL_INT16(ramp[5], (int16_t)(buf[10] >> 16));
+    TEST_ASSERT_EQUAL_INT16((ramp[5] + ramp[6]) / 2, (int16_t)(buf[11] >> 16));
+    TEST_ASSERT_EQUAL_UINT32(4 * CYD_DSP_BLOCK, CYD_DSP_BLOCK + mixToEnd(voices, buf));
+}
+
+/*
+ * A trigger with every voice busy takes the one started first
+ */
+void test_steal_oldest() {
+    CYD_voices voices;
+    int16_t other[TEST_FRAMES] = {};
+    for (int v = 0; v < CYD_VOICES; v++) {
+        TEST_ASSERT_EQUAL_INT8(v, voices.play(v ? ramp : other, TEST_FRAMES, 1, 0x10000, 0x8000));
+    }
+    TEST_ASSERT_EQUAL_UINT8(CYD_VOICES, voices.active());
+    TEST_ASSERT_EQUAL_INT8(0, voices.play(ramp, TEST_FRAMES, 1, 0x10000, 0x8000));
+    TEST_ASSERT_EQUAL_INT8(1, voices.play(ramp, TEST_FRAMES, 1, 0x10000, 0x8000));
+    // No voice plays the stolen data any more, stopping it leaves the others
+    voices.stopSource(other);
+    TEST_ASSERT_EQUAL_UINT8(CYD_VOICES, voices.active());
+    voices.stopSource(ramp);
+    TEST_ASSERT_EQUAL_UINT8(0, voices.active());
+}
+
+/*
+ * Overlapping full scale voices saturate instead of wrapping around
+ */
+void test_saturation() {
+    CYD_voices voices;
+    int32_t buf[CYD_DSP_BLOCK] = {};
+    voices.play(loud, TEST_FRAMES, 2, 0x10000, 0x8000);
+    voices.play(loud, TEST_FRAMES, 2, 0x10000, 0x8000);
+    voices.mix(buf, CYD_DSP_BLOCK);
+    TEST_ASSERT_EQUAL_INT16(32767, (int16_t)(buf[0] >> 16));
+    TEST_ASSERT_EQUAL_INT16(-32768, (int16_t)(buf[0] & 0xFFFF));
+}
+
+/*
+ * Data that can not be played takes no voice
+ */
+void test_reject() {
+    CYD_voices voices;
+    TEST_ASSERT_EQUAL_INT8(-1, voices.play(ramp, 1, 1, 0x10000, 0x8000));
+    TEST_ASSERT_EQUAL_INT8(-1, voices.play(ramp, TEST_FRAMES, 3, 0x10000, 0x8000));
+    TEST_ASSERT_EQUAL_INT8(-1, voices.play(nullptr, TEST_FRAMES, 1, 0x10000, 0x8000));
+    TEST_ASSERT_EQUAL_UINT8(0, voices.active());
+}
+
+/*
+ * The cache loads a file once, a different path is a different sample
+ */
+void test_cache() {
+    TEST_ASSERT_TRUE(writeWav("a.wav", 1, 16, 500));
+    TEST_ASSERT_TRUE(writeWav("b.wav", 2, 8, 300));
+    const voiceSample_t *a = voiceLoad("/a.wav");
+    TEST_ASSERT_NOT_NULL(a);
+    TEST_ASSERT_EQUAL_UINT32(500, a->frames);
+    TEST_ASSERT_EQUAL_STRING("/a.wav", a->path);
+    TEST_ASSERT_EQUAL_INT16(10, a->pcm[1]);
+    uint32_t bytes = voiceCacheBytes();
+    TEST_ASSERT_EQUAL_PTR(a->pcm, voiceLoad("/a.wav")->pcm);
+    TEST_ASSERT_EQUAL_UINT32(bytes, voiceCacheBytes());
+
+    // 8 bit unsigned is widened to 16 bit signed
+    const voiceSample_t *b = voiceLoad("/b.wav");
+    TEST_ASSERT_NOT_NULL(b);
+    TEST_ASSERT_EQUAL_UINT8(2, b->channels);
+    TEST_ASSERT_EQUAL_UINT32(300, b->frames);
+    TEST_ASSERT_EQUAL_INT16(0, b->pcm[0]);
+    TEST_ASSERT_EQUAL_INT16(5 << 8, b->pcm[5]);
+    TEST_ASSERT_EQUAL_UINT32(bytes + 300 * 2 * sizeof(int16_t), voiceCacheBytes());
+
+    TEST_ASSERT_NULL(voiceLoad("/missing.wav"));
+}
+
+int main(int argc, char **argv) {
+    for (int i = 0; i < TEST_FRAMES; i++) {
+        ramp[i] = i * 100;
+        loud[2 * i] = 32767;
+        loud[2 * i + 1] = -32768;
+    }
+    mkdir(TEST_SD_ROOT, 0755);
+    if (!SD.begin(TEST_SD_ROOT)) return 1;
+    voiceInit();
+
+    UNITY_BEGIN();
+    RUN_TEST(test_unity_rate);
+    RUN_TEST(test_half_rate);
+    RUN_TEST(test_steal_oldest);
+    RUN_TEST(test_saturation);
+    RUN_TEST(test_reject);
+    RUN_TEST(test_cache);
+    nativeTestExit(UNITY_END());
+}